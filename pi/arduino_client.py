@@ -2,24 +2,97 @@ from __future__ import annotations
 
 import time
 from collections import deque
-from typing import Any
+from contextlib import contextmanager
+from dataclasses import dataclass
+from typing import Any, Callable, Iterator
 
-from pi.protocol import encode_compact_command
+from pi.dead_reckoning import pose_to_wire
+from pi.models import Pose, RouteSegment
+from pi.protocol import (
+    EMERGENCY_STOP_BYTE,
+    MAX_BATCH_COMMANDS,
+    SEQUENCE_MODULO,
+    encode_compact_batch,
+    encode_compact_command,
+    encode_route_steps,
+)
 from pi.serial_link import SerialJsonLink
 
 
+BAUD_SETTLE_S = 0.05
+BAUD_FALLBACK_TIMEOUT_S = 1.5
+CREDIT_MODULO = 0x10000
+# Kept free by everything except stop, so a stop always fits.
+STOP_RESERVE_BYTES = 16
+# A lost credit report must not wedge the link; after this long without
+# credit the client assumes the firmware has caught up.
+CREDIT_STALL_TIMEOUT_S = 1.0
+CRC_SUFFIX_BYTES = 5
+
+
+@dataclass(frozen=True)
+class PendingCommand:
+    names: tuple[str, ...]
+    sent_at_s: float
+
+
+class CreditWindow:
+    # Bytes sent but not yet read by the firmware, per its "rx_bytes" reports.
+    # Disabled until the ready event advertises "rx_window".
+    def __init__(self) -> None:
+        self.window: int | None = None
+        self._sent = 0
+        self._read = 0
+
+    def reset(self, window: int | None) -> None:
+        self.window = window
+        self._sent = 0
+        self._read = 0
+
+    def outstanding(self) -> int:
+        return (self._sent - self._read) % CREDIT_MODULO
+
+    def fits(self, length: int, reserve: int) -> bool:
+        if self.window is None:
+            return True
+        return self.outstanding() + length + reserve <= self.window
+
+    def on_sent(self, length: int) -> None:
+        self._sent = (self._sent + length) % CREDIT_MODULO
+
+    def on_report(self, rx_bytes: int) -> None:
+        # Reports on motion-priority acks can overtake older ones; a report
+        # that would grow the backlog is stale.
+        if (self._sent - rx_bytes) % CREDIT_MODULO <= self.outstanding():
+            self._read = rx_bytes % CREDIT_MODULO
+
+    def resync(self) -> None:
+        self._read = self._sent
+
+
 class ArduinoClient:
-    def __init__(self, link: SerialJsonLink) -> None:
+    def __init__(
+        self,
+        link: SerialJsonLink,
+        window: int = 4,
+        ack_timeout_s: float = 0.25,
+    ) -> None:
         self._link = link
+        self._window = max(1, window)
+        self._ack_timeout_s = ack_timeout_s
         self._last_lcd_lines = ["", "", "", ""]
-        self._pending_lcd_acks = 0
+        self._next_seq = 0
+        self._in_flight: dict[int, PendingCommand] = {}
         self._buffered_messages: deque[dict[str, Any]] = deque()
+        self._batch: list[tuple[str, tuple[Any, ...]]] | None = None
+        self._credit = CreditWindow()
 
     def open(self) -> None:
         self._link.open()
 
     def close(self) -> None:
         self._link.close()
+        self._in_flight.clear()
 
     def read_message(self) -> dict[str, Any] | None:
         if self._buffered_messages:
@@ -30,22 +103,55 @@ class ArduinoClient:
         return message
 
     def handle_message(self, message: dict[str, Any]) -> None:
-        if message.get("type") != "ack":
+        if message.get("type") == "event" and message.get("event") == "ready":
+            window = message.get("rx_window")
+            self._credit.reset(window if isinstance(window, int) else None)
             return
-        if message.get("command") == "lcd_set_line" and self._pending_lcd_acks > 0:
-            self._pending_lcd_acks -= 1
+        if message.get("type") not in {"ack", "error"}:
+            return
+        rx_bytes = message.get("rx_bytes")
+        if isinstance(rx_bytes, int):
+            self._credit.on_report(rx_bytes)
+        seq = message.get("seq")
+        if isinstance(seq, int):
+            self._in_flight.pop(seq, None)
+
+    def credit_outstanding(self) -> int:
+        return self._credit.outstanding()
+
+    def in_flight(self) -> int:
+        self._expire_stale()
+        return len(self._in_flight)
 
     def lcd_busy(self) -> bool:
-        return self._pending_lcd_acks > 0
+        self._expire_stale()
+        return any(
+            "lcd_set_line" in pending.names for pending in self._in_flight.values()
+        )
+
+    @contextmanager
+    def batch(self) -> Iterator[None]:
+        # Commands issued inside the block go out as one @B frame (split every
+        # MAX_BATCH_COMMANDS) with a single aggregated ack. stop is never held.
+        if self._batch is not None:
+            yield
+            return
+        self._batch = []
+        try:
+            yield
+        finally:
+            commands, self._batch = self._batch, None
+        for start in range(0, len(commands), MAX_BATCH_COMMANDS):
+            self._send_batch(commands[start : start + MAX_BATCH_COMMANDS])
 
     def ping(self) -> None:
-        self._link.send_raw_line(encode_compact_command("ping"), "@P")
+        self._send("ping")
 
     def rfid_reset(self) -> None:
-        self._link.send_raw_line(encode_compact_command("rfid_reset"), "@R")
+        self._send("rfid_reset")
 
     def get_state(self) -> None:
-        self._link.send_raw_line(encode_compact_command("get_state"), "@G")
+        self._send("get_state")
 
     def lcd_set(self, lines: list[str]) -> None:
         padded = list(lines[:4])
@@ -54,45 +160,219 @@ class ArduinoClient:
         for index, text in enumerate(padded):
             if self._last_lcd_lines[index] == text:
                 continue
-            debug_label = f"@L|{index}|{text}"
-            self._link.send_raw_line(
-                encode_compact_command("lcd_set_line", index, text), debug_label
-            )
+            self._send("lcd_set_line", index, text)
             self._last_lcd_lines[index] = text
-            self._pending_lcd_acks += 1
-            self._wait_for_lcd_ack(index)
 
     def lcd_clear(self) -> None:
-        self._link.send_raw_line(encode_compact_command("lcd_clear"), "@C")
+        self._send("lcd_clear")
         self._last_lcd_lines = ["", "", "", ""]
-        self._pending_lcd_acks = 0
 
     def lcd_demo(self) -> None:
-        self._link.send_raw_line(encode_compact_command("lcd_demo"), "@D")
+        self._send("lcd_demo")
 
     def servo_open(self, box: int) -> None:
-        self._link.send_raw_line(encode_compact_command("servo_open", box), f"@O|{box}")
+        self._send("servo_open", box)
 
     def servo_close(self, box: int) -> None:
-        self._link.send_raw_line(
-            encode_compact_command("servo_close", box), f"@X|{box}"
-        )
+        self._send("servo_close", box)
 
-    def move(self, action: str, duration_ms: int | None = None) -> None:
+    def move(
+        self, action: str, duration_ms: int | None = None, replace: bool = False
+    ) -> None:
+        # replace supersedes whatever is running instead of failing with
+        # drive_busy; see route().
+        if replace:
+            self._send("move", action, duration_ms or 0, 1)
+            return
         if duration_ms is None:
-            self._link.send_raw_line(
-                encode_compact_command("move", action), f"@M|{action}"
-            )
+            self._send("move", action)
             return
-        self._link.send_raw_line(
-            encode_compact_command("move", action, duration_ms),
-            f"@M|{action}|{duration_ms}",
-        )
+        self._send("move", action, duration_ms)
+
+    def route(self, steps: list[str | RouteSegment], replace: bool = False) -> None:
+        # The firmware runs the steps back to back and sends motion_done after
+        # each one with "remaining"; stop drops whatever is left. With replace
+        # the new steps take over at once, at speed if the running action is
+        # the same, and the ack reports the cut step ("superseded",
+        # "executed_ms", "planned_ms", "dropped") instead of a motion_done.
+        if replace:
+            self._send("route", encode_route_steps(steps), 1)
+            return
+        self._send("route", encode_route_steps(steps))
 
     def stop(self) -> None:
-        self._link.send_raw_line(encode_compact_command("stop"), "@T")
+        self._send("stop", wait_for_window=False)
+
+    def emergency_stop(self) -> None:
+        # A single reserved byte, outside any line and any batch: the firmware
+        # cuts the motors as soon as it reads it and replies with an "estop"
+        # event. Lines it had not dispatched yet are dropped unanswered, so
+        # nothing in flight is waited on any more.
+        self._link.send_control_byte(EMERGENCY_STOP_BYTE, "estop")
+        self._credit.on_sent(len(EMERGENCY_STOP_BYTE))
+        self._in_flight.clear()
+
+    def clear_emergency_stop(self) -> None:
+        # move and route are refused with "estop_latched" after an emergency
+        # stop until this arrives, so only send it once the stop is handled.
+        self._send("estop_clear")
+
+    def stats(self, task: int = 0) -> None:
+        # The ack carries one task's schedule and "count", the number of tasks.
+        self._send("stats", task)
+
+    def profile(self, phase: int = 0, reset: bool = False) -> None:
+        # One loop phase per ack, with "count" phases in total; reset clears
+        # that phase once its numbers are in the reply.
+        if reset:
+            self._send("profile", phase, 1)
+            return
+        self._send("profile", phase)
+
+    def calibration(self, key: str | int = 0, value: int | None = None) -> None:
+        # Reads one calibration field (by name or index), or sets it in RAM when
+        # a value is given. "save" writes the set to EEPROM and "defaults"
+        # restores the compiled-in values; both are refused while driving.
+        if value is None:
+            self._send("calibration", key)
+            return
+        self._send("calibration", key, value)
+
+    def drift_trim(self, action: str, drift_mm: int, run_mm: int) -> None:
+        # After a straight run of run_mm that ended drift_mm to the robot's left
+        # (negative: right), the firmware re-derives that action's wheel trims
+        # and acks them as "left"/"right". action is "forward" or "reverse".
+        self._send("calibration", f"{action}_drift", drift_mm, run_mm)
 
-    def _wait_for_lcd_ack(self, line_index: int, timeout_s: float = 0.25) -> bool:
+    def pose(self) -> None:
+        # The ack carries "pose": [x, y, heading, position_sd, heading_sd] in
+        # millicells and tenths of a degree; pi.dead_reckoning.parse_pose reads it.
+        self._send("pose")
+
+    def set_pose(self, pose: Pose) -> None:
+        # Restarts the firmware's dead reckoning from a known pose.
+        self._send("pose", *pose_to_wire(pose))
+
+    def apply_calibration(self, values: dict[str, int], save: bool = False) -> None:
+        with self.batch():
+            for key, value in values.items():
+                self.calibration(key, value)
+            if save:
+                self.calibration("save")
+
+    def negotiate_baud(
+        self, baud: int, ready: dict[str, Any], timeout_s: float = 0.4
+    ) -> bool:
+        # Both sides switch after the ack; a ping at the new rate confirms it.
+        # Without a pong both fall back: the firmware after its own timeout,
+        # which it reports with a baud_fallback event.
+        base = self._link.baudrate()
+        if baud == base or baud not in ready.get("bauds", []):
+            return False
+        reply = self._await_reply(
+            self._send("set_baud", baud, wait_for_window=False), timeout_s
+        )
+        if reply is None or reply.get("type") != "ack":
+            return False
+        time.sleep(BAUD_SETTLE_S)
+        self._link.set_baudrate(baud)
+        reply = self._await_reply(self._send("ping", wait_for_window=False), timeout_s)
+        if reply is not None and reply.get("type") == "ack":
+            return True
+        self._link.set_baudrate(base)
+        self._await_event("baud_fallback", BAUD_FALLBACK_TIMEOUT_S)
+        return False
+
+    def negotiate_link_mode(self, mode: str, ready: dict[str, Any]) -> bool:
+        # Firmware that predates binary mode advertises no "modes"; stay on JSON.
+        if mode == self._link.link_mode() or mode not in ready.get("modes", []):
+            return False
+        self._send("link_mode", mode, wait_for_window=False)
+        self._link.set_link_mode(mode)
+        return True
+
+    def _send(
+        self, name: str, *fields: Any, wait_for_window: bool = True
+    ) -> int | None:
+        if self._batch is not None and name != "stop":
+            self._batch.append((name, fields))
+            return None
+        if wait_for_window:
+            self._wait_for_window()
+        seq = self._take_seq()
+        payload = encode_compact_command(name, *fields, seq=seq)
+        self._transmit(payload, seq, (name,), reserve=name != "stop")
+        return seq
+
+    def _send_batch(self, commands: list[tuple[str, tuple[Any, ...]]]) -> None:
+        if len(commands) == 1:
+            name, fields = commands[0]
+            self._send(name, *fields)
+            return
+        self._wait_for_window()
+        seq = self._take_seq()
+        names = tuple(name for name, _ in commands)
+        self._transmit(encode_compact_batch(commands, seq=seq), seq, names)
+
+    def _take_seq(self) -> int:
+        seq = self._next_seq
+        self._next_seq = (self._next_seq + 1) % SEQUENCE_MODULO
+        return seq
+
+    def _transmit(
+        self, payload: bytes, seq: int, names: tuple[str, ...], reserve: bool = True
+    ) -> None:
+        length = len(payload)
+        if self._link.link_mode() == "binary":
+            length += CRC_SUFFIX_BYTES
+        self._wait_for_credit(length, STOP_RESERVE_BYTES if reserve else 0)
+        debug_label = payload.decode("utf-8").rstrip("\n")
+        self._link.send_raw_line(payload, debug_label)
+        self._credit.on_sent(length)
+        self._in_flight[seq] = PendingCommand(names, time.monotonic())
+
+    def _wait_for_credit(self, length: int, reserve: int) -> None:
+        deadline = time.monotonic() + CREDIT_STALL_TIMEOUT_S
+        while not self._credit.fits(length, reserve):
+            if time.monotonic() >= deadline:
+                self._credit.resync()
+                return
+            message = self._link.read_message()
+            if message is None:
+                time.sleep(0.005)
+                continue
+            self.handle_message(message)
+            self._buffered_messages.append(message)
+
+    def _wait_for_window(self) -> None:
+        while self.in_flight() >= self._window:
+            message = self._link.read_message()
+            if message is None:
+                time.sleep(0.005)
+                continue
+            self.handle_message(message)
+            self._buffered_messages.append(message)
+
+    def _await_reply(self, seq: int | None, timeout_s: float) -> dict[str, Any] | None:
+        def matches(message: dict[str, Any]) -> bool:
+            return message.get("type") in {"ack", "error"} and message.get("seq") == seq
+
+        return self._await(matches, timeout_s)
+
+    def _await_event(self, event: str, timeout_s: float) -> dict[str, Any] | None:
+        def matches(message: dict[str, Any]) -> bool:
+            return message.get("type") == "event" and message.get("event") == event
+
+        return self._await(matches, timeout_s)
+
+    def _await(
+        self, matches: Callable[[dict[str, Any]], bool], timeout_s: float
+    ) -> dict[str, Any] | None:
+        # Other messages are kept for read_message().
+        for message in self._buffered_messages:
+            if matches(message):
+                self._buffered_messages.remove(message)
+                return message
         deadline = time.monotonic() + timeout_s
         while time.monotonic() < deadline:
             message = self._link.read_message()
@@ -100,14 +380,13 @@ class ArduinoClient:
                 time.sleep(0.005)
                 continue
             self.handle_message(message)
-            if (
-                message.get("type") == "ack"
-                and message.get("command") == "lcd_set_line"
-                and message.get("line") == line_index
-            ):
-                return True
+            if matches(message):
+                return message
             self._buffered_messages.append(message)
+        return None
 
-        if self._pending_lcd_acks > 0:
-            self._pending_lcd_acks -= 1
-        return False
+    def _expire_stale(self) -> None:
+        now = time.monotonic()
+        for seq, pending in list(self._in_flight.items()):
+            if now - pending.sent_at_s >= self._ack_timeout_s:
+                del self._in_flight[seq]
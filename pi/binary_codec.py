@@ -0,0 +1,215 @@
+from __future__ import annotations
+
+import binascii
+from typing import Any
+
+# Decoder for the firmware's binary link mode (src/binary_frame.h). Frames are
+# COBS-encoded and end with 0x00; decoded, they yield the same dicts as the
+# JSON mode.
+
+# Must match SYMBOLS in src/binary_frame.cpp: a symbol's id is its position.
+SYMBOLS: tuple[str, ...] = (
+    "ack", "action", "angle", "arduino_bridge", "available", "batch", "batch_count",
+    "binary", "box", "busy", "closed", "code", "command", "count", "crc_mismatch",
+    "current", "custom", "debug_compact_rx", "debug_move_request",
+    "debug_rfid_read_failed", "debug_rfid_recovered", "drive_action", "drive_busy",
+    "duration_ms", "enabled", "error", "event", "expected", "field_count", "firmware",
+    "forward_cell", "get_state", "hold", "idle", "index", "invalid", "invalid_action",
+    "invalid_batch", "invalid_box", "invalid_json", "invalid_mode", "json", "key",
+    "key_event", "lcd_address", "lcd_available", "lcd_backlight", "lcd_clear",
+    "lcd_demo", "lcd_set", "lcd_set_line", "lcd_write_failed", "line",
+    "line_too_long", "link_mode", "locks", "message", "missing_fields",
+    "missing_opcode", "missing_type", "mode", "modes", "motion_done", "move", "ok",
+    "opcode", "open", "ping", "pressed", "raw", "ready", "released", "reverse_cell",
+    "rfid_reset", "rfid_scan", "rx_overflows", "seq", "servo_close", "servo_open",
+    "servo_set_angle", "state", "status", "stop", "switch_state", "switches", "text",
+    "turn_left", "turn_right", "tx_dropped", "tx_frame_overflow", "type", "uid",
+    "unknown", "unknown_command", "unknown_opcode", "unsupported_command",
+)  # fmt: skip
+
+SYMBOL_IDS = {name: index for index, name in enumerate(SYMBOLS)}
+
+TAG_STRING = 0xF0
+TAG_TRUE = 0xF1
+TAG_FALSE = 0xF2
+TAG_INT = 0xF3
+TAG_UINT = 0xF4
+TAG_ARRAY = 0xF5
+TAG_OBJECT = 0xF6
+TAG_END = 0xF7
+
+FRAME_DELIMITER = b"\x00"
+
+
+class BinaryFrameError(ValueError):
+    pass
+
+
+def crc16(data: bytes) -> int:
+    # crc_hqx is CRC-16 with poly 0x1021; init 0xFFFF makes it CCITT-FALSE.
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def crc_suffix(line: bytes) -> bytes:
+    return b"*%04X" % crc16(line)
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out.append(len(block) + 1)
+            out.extend(block)
+            block.clear()
+            continue
+        block.append(byte)
+        if len(block) == 0xFE:
+            out.append(0xFF)
+            out.extend(block)
+            block.clear()
+    out.append(len(block) + 1)
+    out.extend(block)
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        end = index + code
+        if code == 0 or end > len(data):
+            raise BinaryFrameError("Malformed COBS block")
+        out += data[index + 1 : end]
+        index = end
+        if code != 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(message: dict[str, Any]) -> bytes:
+    fields = dict(message)
+    payload = bytearray()
+    _put_text(payload, str(fields.pop("type")))
+    for key, value in fields.items():
+        _put_text(payload, key)
+        _put_value(payload, value)
+    crc = crc16(bytes(payload))
+    payload += bytes((crc >> 8, crc & 0xFF))
+    return cobs_encode(bytes(payload)) + FRAME_DELIMITER
+
+
+def decode_frame(frame: bytes) -> dict[str, Any]:
+    if frame.endswith(FRAME_DELIMITER):
+        frame = frame[:-1]
+    raw = cobs_decode(frame)
+    if len(raw) < 3:
+        raise BinaryFrameError("Frame too short")
+    payload, crc = raw[:-2], int.from_bytes(raw[-2:], "big")
+    if crc16(payload) != crc:
+        raise BinaryFrameError("Frame CRC mismatch")
+    reader = _Reader(payload)
+    message: dict[str, Any] = {"type": reader.text(reader.byte())}
+    while not reader.done():
+        key = reader.text(reader.byte())
+        message[key] = reader.value()
+    return message
+
+
+def _put_text(out: bytearray, text: str) -> None:
+    symbol = SYMBOL_IDS.get(text)
+    if symbol is not None:
+        out.append(symbol)
+        return
+    encoded = text.encode("utf-8")
+    out += bytes((TAG_STRING, len(encoded))) + encoded
+
+
+def _put_value(out: bytearray, value: Any) -> None:
+    if isinstance(value, bool):
+        out.append(TAG_TRUE if value else TAG_FALSE)
+    elif isinstance(value, int):
+        out.append(TAG_INT)
+        _put_varint(out, value * 2 if value >= 0 else -value * 2 - 1)
+    elif isinstance(value, list):
+        out.append(TAG_ARRAY)
+        for item in value:
+            _put_value(out, item)
+        out.append(TAG_END)
+    elif isinstance(value, dict):
+        out.append(TAG_OBJECT)
+        for key, item in value.items():
+            _put_text(out, key)
+            _put_value(out, item)
+        out.append(TAG_END)
+    else:
+        _put_text(out, str(value))
+
+
+def _put_varint(out: bytearray, number: int) -> None:
+    while number >= 0x80:
+        out.append((number & 0x7F) | 0x80)
+        number >>= 7
+    out.append(number)
+
+
+class _Reader:
+    def __init__(self, payload: bytes) -> None:
+        self._payload = payload
+        self._index = 0
+
+    def done(self) -> bool:
+        return self._index >= len(self._payload)
+
+    def byte(self) -> int:
+        if self.done():
+            raise BinaryFrameError("Truncated frame")
+        value = self._payload[self._index]
+        self._index += 1
+        return value
+
+    def text(self, lead: int) -> str:
+        if lead < len(SYMBOLS):
+            return SYMBOLS[lead]
+        if lead != TAG_STRING:
+            raise BinaryFrameError(f"Expected text, got 0x{lead:02X}")
+        length = self.byte()
+        start = self._index
+        self._index += length
+        if self._index > len(self._payload):
+            raise BinaryFrameError("Truncated string")
+        return self._payload[start : self._index].decode("utf-8", errors="replace")
+
+    def value(self, lead: int | None = None) -> Any:
+        lead = self.byte() if lead is None else lead
+        if lead == TAG_TRUE:
+            return True
+        if lead == TAG_FALSE:
+            return False
+        if lead == TAG_INT:
+            number = self.varint()
+            return -(number >> 1) - 1 if number & 1 else number >> 1
+        if lead == TAG_UINT:
+            return self.varint()
+        if lead == TAG_ARRAY:
+            items = []
+            while (item_lead := self.byte()) != TAG_END:
+                items.append(self.value(item_lead))
+            return items
+        if lead == TAG_OBJECT:
+            fields: dict[str, Any] = {}
+            while (key_lead := self.byte()) != TAG_END:
+                fields[self.text(key_lead)] = self.value()
+            return fields
+        return self.text(lead)
+
+    def varint(self) -> int:
+        number = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            number |= (byte & 0x7F) << shift
+            if byte < 0x80:
+                return number
+            shift += 7
@@ -6,6 +6,9 @@ from pathlib import Path
 from typing import Any
 
 
+# Firmware RampProfile values, in enum order.
+RAMP_PROFILES = ("step", "linear", "s_curve")
+
 ROOT_DIR = Path(__file__).resolve().parent.parent
 CONFIG_DIR = ROOT_DIR / "config"
 
@@ -61,3 +64,38 @@ def load_hardware_config(config_dir: Path = CONFIG_DIR) -> dict[str, Any]:
 
 def load_protocol_config(config_dir: Path = CONFIG_DIR) -> dict[str, Any]:
     return _load_json(config_dir / "protocol.json")
+
+
+def calibration_from_motion_config(motion_config: dict[str, Any]) -> dict[str, int]:
+    # Maps motion.json onto the firmware's calibration keys; anything missing
+    # is left out so the Arduino keeps its current value.
+    drive = motion_config.get("drive", {})
+    timing = drive.get("timing_ms", {})
+    pwm = drive.get("pwm", {})
+    ramp = drive.get("ramp", {})
+    encoder = drive.get("encoder", {})
+    sources = {
+        "forward_cell_ms": timing.get("forward_cell"),
+        "reverse_cell_ms": timing.get("reverse_cell"),
+        "turn_left_ms": timing.get("turn_left"),
+        "turn_right_ms": timing.get("turn_right"),
+        "arc_left_ms": timing.get("arc_left"),
+        "arc_right_ms": timing.get("arc_right"),
+        "forward_pwm": pwm.get("forward"),
+        "turn_pwm": pwm.get("turn"),
+        "arc_pwm": pwm.get("arc"),
+        "arc_inner_permille": drive.get("arc", {}).get("inner_permille"),
+        "ramp_ms": ramp.get("ms"),
+        "encoder_ticks_cell": encoder.get("ticks_per_cell"),
+        "encoder_ticks_turn": encoder.get("ticks_per_turn"),
+        "encoder_ticks_arc": encoder.get("ticks_per_arc"),
+        "encoder_kp": encoder.get("kp_permille"),
+        "encoder_ki": encoder.get("ki_permille"),
+    }
+    for action, wheels in drive.get("trim_permille", {}).items():
+        for wheel, value in wheels.items():
+            sources[f"{wheel}_{action}_trim"] = value
+    values = {key: int(value) for key, value in sources.items() if value is not None}
+    if "profile" in ramp:
+        values["ramp_profile"] = RAMP_PROFILES.index(ramp["profile"])
+    return values
@@ -0,0 +1,54 @@
+from __future__ import annotations
+
+from pi.models import Heading, Pose, PoseEstimate
+from pi.pathfinding import HEADINGS
+
+# The firmware keeps its pose in thousandths of a cell and tenths of a degree,
+# on the same grid as map.json: x east, y south, heading clockwise from north.
+MILLICELLS_PER_CELL = 1000
+DECIDEGREES_PER_DEGREE = 10
+HEADING_DECIDEGREES: dict[Heading, int] = {"N": 0, "E": 900, "S": 1800, "W": 2700}
+
+
+def pose_to_wire(pose: Pose) -> tuple[int, int, int]:
+    return (
+        pose.x * MILLICELLS_PER_CELL,
+        pose.y * MILLICELLS_PER_CELL,
+        HEADING_DECIDEGREES[pose.heading],
+    )
+
+
+def parse_pose(value: object) -> PoseEstimate | None:
+    # [x, y, heading, position_sd, heading_sd] as sent in motion_done, the
+    # telemetry event and the pose and stop acks.
+    if not isinstance(value, list) or len(value) != 5:
+        return None
+    if not all(isinstance(item, int) for item in value):
+        return None
+    x, y, heading, position_sd, heading_sd = value
+    return PoseEstimate(
+        x=x / MILLICELLS_PER_CELL,
+        y=y / MILLICELLS_PER_CELL,
+        heading_deg=heading / DECIDEGREES_PER_DEGREE,
+        position_sd=position_sd / MILLICELLS_PER_CELL,
+        heading_sd_deg=heading_sd / DECIDEGREES_PER_DEGREE,
+    )
+
+
+def snap_pose(
+    estimate: PoseEstimate,
+    max_offset: float = 0.3,
+    max_heading_offset_deg: float = 20.0,
+) -> Pose | None:
+    # The nearest cell and heading, or None when the estimate is too far off
+    # the grid or too uncertain to tell which cell the robot is in.
+    x = round(estimate.x)
+    y = round(estimate.y)
+    quarter = round(estimate.heading_deg / 90.0)
+    heading_offset = abs(estimate.heading_deg - quarter * 90.0)
+    offset = max(abs(estimate.x - x), abs(estimate.y - y))
+    if offset + estimate.position_sd > max_offset:
+        return None
+    if heading_offset + estimate.heading_sd_deg > max_heading_offset_deg:
+        return None
+    return Pose(x, y, HEADINGS[quarter % len(HEADINGS)])
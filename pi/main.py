@@ -8,7 +8,7 @@ from pathlib import Path
 from pi.arduino_client import ArduinoClient
 from pi.cabinet_index import CabinetIndex
 from pi.card_registry import CardRegistry
-from pi.config import load_project_config
+from pi.config import calibration_from_motion_config, load_project_config
 from pi.map_loader import load_grid_map
 from pi.serial_link import SerialJsonLink, SerialLinkDisconnected
 from pi.state_machine import RobotStateMachine
@@ -40,6 +40,21 @@ def parse_args() -> argparse.Namespace:
         action="store_true",
         help="Print keypad, routing, RFID, and state-machine debug logs",
     )
+    parser.add_argument(
+        "--json-link",
+        action="store_true",
+        help="Keep the JSON link instead of switching to binary frames",
+    )
+    parser.add_argument(
+        "--no-baud-upgrade",
+        action="store_true",
+        help="Stay at --baud instead of negotiating transport.upgrade_baud",
+    )
+    parser.add_argument(
+        "--push-calibration",
+        action="store_true",
+        help="Send motion.json timings to Arduino on startup and save them to EEPROM",
+    )
     parser.add_argument(
         "--lcd-demo-on-start",
         action="store_true",
@@ -94,7 +109,15 @@ def main() -> None:
         baudrate=args.baud,
         logger=log if args.verbose_rpc else None,
     )
-    arduino = ArduinoClient(link)
+    pipeline = config.protocol_config.get("pipeline", {})
+    transport = config.protocol_config.get("transport", {})
+    link_mode = "json" if args.json_link else transport.get("link_mode", "json")
+    upgrade_baud = 0 if args.no_baud_upgrade else int(transport.get("upgrade_baud", 0))
+    arduino = ArduinoClient(
+        link,
+        window=int(pipeline.get("window", 4)),
+        ack_timeout_s=float(pipeline.get("ack_timeout_ms", 250)) / 1000.0,
+    )
     grid_map = load_grid_map(config.map_config)
     cabinets = CabinetIndex(config.cabinets_config)
     cards = CardRegistry(config.cards_config)
@@ -104,6 +127,7 @@ def main() -> None:
         cabinet_index=cabinets,
         card_registry=cards,
         logger=log if args.verbose_state else None,
+        prefer_arcs=bool(config.motion_config.get("planner", {}).get("prefer_arcs")),
     )
 
     ensure_arduino_connection(arduino, log)
@@ -122,8 +146,19 @@ def main() -> None:
                     ):
                         ready_seen = True
                         log("[main] Arduino ready; sending startup commands")
+                        if upgrade_baud and arduino.negotiate_baud(
+                            upgrade_baud, message
+                        ):
+                            log(f"[main] Serial link running at {upgrade_baud} baud")
+                        if arduino.negotiate_link_mode(link_mode, message):
+                            log(f"[main] Switching Arduino link to {link_mode}")
                         arduino.ping()
                         arduino.get_state()
+                        if args.push_calibration:
+                            arduino.apply_calibration(
+                                calibration_from_motion_config(config.motion_config),
+                                save=True,
+                            )
                         if args.lcd_demo_on_start:
                             arduino.lcd_demo()
                         if not started:
@@ -20,7 +20,24 @@ class Pose:
     heading: Heading
 
 
+@dataclass(frozen=True)
+class PoseEstimate:
+    # The firmware's dead-reckoned pose, in cells and degrees on the grid.
+    x: float
+    y: float
+    heading_deg: float
+    position_sd: float
+    heading_sd_deg: float
+
+
 @dataclass(frozen=True)
 class DeliveryJob:
     cabinet_id: str
     box_id: int
+
+
+@dataclass(frozen=True)
+class RouteSegment:
+    action: str
+    cells: int = 1
+    duration_ms: int | None = None
@@ -4,7 +4,7 @@ import heapq
 from dataclasses import dataclass
 
 from pi.map_loader import GridMap
-from pi.models import Heading, Pose
+from pi.models import Heading, Pose, RouteSegment
 
 
 HEADINGS: tuple[Heading, ...] = ("N", "E", "S", "W")
@@ -19,6 +19,8 @@ FORWARD_DELTA: dict[Heading, tuple[int, int]] = {
 REVERSE_DELTA: dict[Heading, tuple[int, int]] = {
     heading: (-dx, -dy) for heading, (dx, dy) in FORWARD_DELTA.items()
 }
+# The firmware carries a segment's cell count in one byte.
+MAX_SEGMENT_CELLS = 255
 
 
 @dataclass(frozen=True)
@@ -27,9 +29,44 @@ class PlannedRoute:
     final_pose: Pose
     turns: int
     steps: int
-
-
-def plan_route(grid_map: GridMap, start: Pose, goal: Pose) -> PlannedRoute:
+    segments: list[RouteSegment]
+
+
+def compact_actions(actions: list[str]) -> list[RouteSegment]:
+    # A run of identical actions becomes one timed segment (forward_n and
+    # friends on the firmware side): one start, one stop, one step on the wire.
+    segments: list[RouteSegment] = []
+    for action in actions:
+        if (
+            segments
+            and segments[-1].action == action
+            and segments[-1].cells < MAX_SEGMENT_CELLS
+        ):
+            segments[-1] = RouteSegment(action, segments[-1].cells + 1)
+        else:
+            segments.append(RouteSegment(action))
+    return segments
+
+
+def _arc_target(
+    grid_map: GridMap, x: int, y: int, heading: Heading, turned: Heading
+) -> tuple[int, int] | None:
+    # An arc sweeps the 2x2 block between its start cell and the diagonal cell
+    # it ends on; the body needs all four free, not just the corner it cuts.
+    dx, dy = FORWARD_DELTA[heading]
+    tx, ty = FORWARD_DELTA[turned]
+    cells = ((x + dx, y + dy), (x + tx, y + ty), (x + dx + tx, y + dy + ty))
+    if all(grid_map.is_open(cx, cy) for cx, cy in cells):
+        return cells[2]
+    return None
+
+
+def plan_route(
+    grid_map: GridMap, start: Pose, goal: Pose, prefer_arcs: bool = False
+) -> PlannedRoute:
+    # With prefer_arcs, forward_cell + turn + forward_cell around a free corner
+    # becomes one arc_left / arc_right: still a turn, but two steps instead of
+    # three, so the search picks it whenever the grid allows.
     queue: list[tuple[int, int, int, int, str]] = []
     start_key = (start.x, start.y, start.heading)
     heapq.heappush(queue, (0, 0, start.x, start.y, start.heading))
@@ -77,6 +114,23 @@ def plan_route(grid_map: GridMap, start: Pose, goal: Pose) -> PlannedRoute:
                     queue, (forward_cost[0], forward_cost[1], nx, ny, heading)
                 )
 
+        if prefer_arcs:
+            for action, turned in (
+                ("arc_left", left_heading),
+                ("arc_right", right_heading),
+            ):
+                target = _arc_target(grid_map, x, y, heading, turned)
+                if target is None:
+                    continue
+                arc_state = (target[0], target[1], turned)
+                arc_cost = (turns + 1, steps + 2)
+                if arc_cost < best_cost.get(arc_state, (10**9, 10**9)):
+                    best_cost[arc_state] = arc_cost
+                    previous[arc_state] = (state, action)
+                    heapq.heappush(
+                        queue, (arc_cost[0], arc_cost[1], target[0], target[1], turned)
+                    )
+
         reverse_dx, reverse_dy = REVERSE_DELTA[heading]
         reverse_x, reverse_y = x + reverse_dx, y + reverse_dy
         if grid_map.is_open(reverse_x, reverse_y):
@@ -108,4 +162,10 @@ def plan_route(grid_map: GridMap, start: Pose, goal: Pose) -> PlannedRoute:
     actions.reverse()
 
     turns, steps = best_cost[goal_key]
-    return PlannedRoute(actions=actions, final_pose=goal, turns=turns, steps=steps)
+    return PlannedRoute(
+        actions=actions,
+        final_pose=goal,
+        turns=turns,
+        steps=steps,
+        segments=compact_actions(actions),
+    )
@@ -3,6 +3,8 @@ from __future__ import annotations
 import json
 from typing import Any
 
+from pi.models import RouteSegment
+
 
 COMMAND_CODES: dict[str, str] = {
     "ping": "P",
@@ -16,6 +18,14 @@ COMMAND_CODES: dict[str, str] = {
     "servo_set_angle": "A",
     "move": "M",
     "stop": "T",
+    "link_mode": "Y",
+    "set_baud": "U",
+    "stats": "S",
+    "profile": "F",
+    "route": "Q",
+    "calibration": "K",
+    "pose": "W",
+    "estop_clear": "E",
 }
 
 
@@ -34,16 +44,69 @@ def command(message_type: str, **fields: Any) -> dict[str, Any]:
     return {"type": message_type, **fields}
 
 
-def encode_compact_command(name: str, *fields: Any) -> bytes:
-    opcode = COMMAND_CODES[name]
-    payload = [opcode, *(_escape_compact_field(str(field)) for field in fields)]
-    return ("@" + "|".join(payload) + "\n").encode("utf-8")
+SEQUENCE_MODULO = 0x10000
+# Matches EMERGENCY_STOP_BYTE in src/rx_line_buffer.h. Sent on its own, outside
+# any line, in both link modes.
+EMERGENCY_STOP_BYTE = b"\x18"
+BATCH_OPCODE = "B"
+MAX_BATCH_COMMANDS = 6
+# Matches MOTION_QUEUE_CAPACITY in src/motion_route.h.
+MAX_ROUTE_STEPS = 16
+ROUTE_ALIASES: dict[str, str] = {
+    "forward_cell": "f",
+    "reverse_cell": "b",
+    "turn_left": "l",
+    "turn_right": "r",
+    "arc_left": "L",
+    "arc_right": "R",
+}
+
+
+def encode_compact_command(name: str, *fields: Any, seq: int | None = None) -> bytes:
+    body = _compact_body(COMMAND_CODES[name], fields, seq)
+    return ("@" + body + "\n").encode("utf-8")
+
+
+def encode_compact_batch(
+    commands: list[tuple[str, tuple[Any, ...]]], seq: int | None = None
+) -> bytes:
+    if not 1 <= len(commands) <= MAX_BATCH_COMMANDS:
+        raise ValueError(f"Batch must hold 1..{MAX_BATCH_COMMANDS} commands")
+    parts = [_compact_body(BATCH_OPCODE, (), seq)]
+    parts.extend(
+        _compact_body(COMMAND_CODES[name], fields, None) for name, fields in commands
+    )
+    return ("@" + ";".join(parts) + "\n").encode("utf-8")
+
+
+def encode_route_steps(steps: list[str | RouteSegment]) -> str:
+    # "f*3,l:480": one alias per step, with an optional cell count and an
+    # optional duration override for the whole segment.
+    if not 1 <= len(steps) <= MAX_ROUTE_STEPS:
+        raise ValueError(f"Route must hold 1..{MAX_ROUTE_STEPS} steps")
+    tokens = []
+    for step in steps:
+        segment = RouteSegment(step) if isinstance(step, str) else step
+        token = ROUTE_ALIASES[segment.action]
+        if segment.cells != 1:
+            token += f"*{segment.cells}"
+        if segment.duration_ms is not None:
+            token += f":{segment.duration_ms}"
+        tokens.append(token)
+    return ",".join(tokens)
+
+
+def _compact_body(opcode: str, fields: tuple[Any, ...], seq: int | None) -> str:
+    if seq is not None:
+        opcode = f"{opcode}#{seq % SEQUENCE_MODULO}"
+    return "|".join([opcode, *(_escape_compact_field(str(field)) for field in fields)])
 
 
 def _escape_compact_field(value: str) -> str:
     return (
         value.replace("\\", "\\\\")
         .replace("|", "\\|")
+        .replace(";", "\\;")
         .replace("\n", "\\n")
         .replace("\r", "\\r")
     )
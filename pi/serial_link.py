@@ -3,8 +3,16 @@ from __future__ import annotations
 import json
 from typing import Any, Callable
 
+from pi.binary_codec import (
+    FRAME_DELIMITER,
+    BinaryFrameError,
+    crc_suffix,
+    decode_frame,
+)
 from pi.protocol import decode_message, encode_message
 
+LINK_MODES = ("json", "binary")
+
 
 class SerialLinkDisconnected(RuntimeError):
     pass
@@ -23,6 +31,7 @@ class SerialJsonLink:
         self._timeout = timeout
         self._serial: Any | None = None
         self._logger = logger
+        self._reset_link_mode()
 
     def open(self) -> None:
         if self._serial is not None:
@@ -39,6 +48,39 @@ class SerialJsonLink:
             )
         except Exception as exc:
             self._raise_disconnected("open", exc)
+        # Opening the port resets the Mega, which boots in JSON mode.
+        self._reset_link_mode()
+
+    def baudrate(self) -> int:
+        if self._serial is None:
+            return self._baudrate
+        return int(self._serial.baudrate)
+
+    def set_baudrate(self, baudrate: int) -> None:
+        # Only the open port changes; open() always starts at the base rate
+        # because the Mega resets to it.
+        if self._serial is None:
+            raise RuntimeError("Serial link is not open")
+        try:
+            self._serial.baudrate = baudrate
+            self._serial.reset_input_buffer()
+        except Exception as exc:
+            self._raise_disconnected("reconfigure", exc)
+        self._rx_pending = bytearray()
+
+    def link_mode(self) -> str:
+        return self._tx_mode
+
+    def set_link_mode(self, mode: str) -> None:
+        # Call right after sending the link_mode command: the firmware checks
+        # CRCs from the next line on, but frames already queued on its side
+        # still use the old framing, so reads sniff each frame until the first
+        # one in the new framing arrives.
+        if mode not in LINK_MODES:
+            raise ValueError(f"Unknown link mode: {mode}")
+        self._tx_mode = mode
+        if mode != self._rx_mode:
+            self._rx_switching = True
 
     def close(self) -> None:
         if self._serial is None:
@@ -58,6 +100,9 @@ class SerialJsonLink:
     def send_raw_line(self, payload: bytes, debug_label: str) -> None:
         if self._serial is None:
             raise RuntimeError("Serial link is not open")
+        if self._tx_mode == "binary":
+            body = payload.rstrip(b"\n")
+            payload = body + crc_suffix(body) + b"\n"
         if self._logger is not None:
             self._logger(f"[serial tx] {debug_label}")
         try:
@@ -66,22 +111,77 @@ class SerialJsonLink:
         except Exception as exc:
             self._raise_disconnected("write", exc)
 
+    def send_control_byte(self, value: bytes, debug_label: str) -> None:
+        # Control bytes are not lines: no CRC suffix, no newline.
+        if self._serial is None:
+            raise RuntimeError("Serial link is not open")
+        if self._logger is not None:
+            self._logger(f"[serial tx] {debug_label}")
+        try:
+            self._serial.write(value)
+            self._serial.flush()
+        except Exception as exc:
+            self._raise_disconnected("write", exc)
+
     def read_message(self) -> dict[str, Any] | None:
         if self._serial is None:
             raise RuntimeError("Serial link is not open")
         try:
-            raw = self._serial.readline()
+            raw = self._read_frame()
         except Exception as exc:
             self._raise_disconnected("read", exc)
         if not raw:
             return None
-        line = raw.decode("utf-8", errors="ignore").strip()
-        if not line:
-            return None
-        message = decode_message(line)
+        if raw.endswith(FRAME_DELIMITER):
+            try:
+                message = decode_frame(raw)
+            except BinaryFrameError as exc:
+                if self._logger is not None:
+                    self._logger(f"[serial rx] dropped binary frame: {exc}")
+                return None
+            self._frame_seen("binary")
+        else:
+            line = raw.decode("utf-8", errors="ignore").strip()
+            if not line:
+                return None
+            message = decode_message(line)
+            self._frame_seen("json")
         self._log("rx", message)
         return message
 
+    def _read_frame(self) -> bytes:
+        assert self._serial is not None
+        mode = self._rx_mode
+        if self._rx_switching and not self._rx_pending:
+            first = self._serial.read(1)
+            if not first:
+                return b""
+            mode = "json" if first == b"{" else "binary"
+            self._rx_pending += first
+        elif self._rx_pending:
+            mode = "binary"
+        if mode == "json":
+            raw = bytes(self._rx_pending) + self._serial.readline()
+            self._rx_pending = bytearray()
+            return raw
+        # A read timeout can split a frame; keep the head for the next call.
+        self._rx_pending += self._serial.read_until(FRAME_DELIMITER)
+        if not self._rx_pending.endswith(FRAME_DELIMITER):
+            return b""
+        raw, self._rx_pending = bytes(self._rx_pending), bytearray()
+        return raw
+
+    def _frame_seen(self, mode: str) -> None:
+        if self._rx_switching and mode == self._tx_mode:
+            self._rx_mode = mode
+            self._rx_switching = False
+
+    def _reset_link_mode(self) -> None:
+        self._tx_mode = "json"
+        self._rx_mode = "json"
+        self._rx_switching = False
+        self._rx_pending = bytearray()
+
     def _log(self, direction: str, message: dict[str, Any]) -> None:
         if self._logger is None:
             return
@@ -18,9 +18,11 @@ from pi.lcd_presenter import (
     waiting_handoff_lines,
     waiting_card_lines,
 )
+from pi.dead_reckoning import parse_pose, snap_pose
 from pi.map_loader import GridMap
-from pi.models import DeliveryJob, Pose
-from pi.pathfinding import plan_route
+from pi.models import DeliveryJob, Pose, PoseEstimate
+from pi.pathfinding import compact_actions, plan_route
+from pi.protocol import MAX_ROUTE_STEPS
 from pi.queue_manager import DeliveryQueue
 
 
@@ -45,7 +47,12 @@ class RobotStateMachine:
     keypad_parser: KeypadParser = field(default_factory=KeypadParser)
     queue: DeliveryQueue = field(default_factory=DeliveryQueue)
     logger: Callable[[str], None] | None = None
+    # Plan corners as arcs; needs the arc_* calibration to be measured first.
+    prefer_arcs: bool = False
     current_pose: Pose = field(init=False)
+    # Latest dead-reckoned pose from the firmware, reset to current_pose at
+    # every known stop (home, cabinets).
+    pose_estimate: PoseEstimate | None = None
     mode: RobotMode = RobotMode.IDLE
     active_job: DeliveryJob | None = None
     active_boxes: tuple[int, ...] = field(default_factory=tuple)
@@ -69,6 +76,7 @@ class RobotStateMachine:
 
     def start(self) -> None:
         self._log(f"start mode={self.mode} pose={self.current_pose}")
+        self._sync_firmware_pose()
         self.arduino.lcd_set(idle_lines(self.keypad_parser.buffer, len(self.queue)))
 
     def tick(self, now_s: float | None = None) -> None:
@@ -91,6 +99,8 @@ class RobotStateMachine:
         if message_type == "event":
             self._handle_event(message)
             return
+        if message_type == "ack" and "pose" in message:
+            self._record_pose_estimate(message)
         if message_type == "ack" and message.get("command") == "move":
             self._log(f"move_ack action={message.get('action', '')}")
             return
@@ -104,6 +114,17 @@ class RobotStateMachine:
         if event == "state":
             self._handle_state_snapshot(message)
             return
+        if event == "telemetry":
+            self._record_pose_estimate(message)
+            return
+        if event == "estop":
+            self._log(
+                f"estop dropped={message.get('dropped', 0)} "
+                f"latency_us={message.get('latency_us', '')} "
+                f"max_latency_us={message.get('max_latency_us', '')}"
+            )
+            self._record_pose_estimate(message)
+            return
         if event == "key_event" and message.get("state") == "pressed":
             key = str(message.get("key", ""))
             if key == "0":
@@ -113,8 +134,15 @@ class RobotStateMachine:
                 self._handle_key(key)
                 return
         if event == "motion_done":
-            self._log(f"motion_done action={message.get('action', '')}")
-            self._handle_motion_done()
+            self._log(
+                f"motion_done action={message.get('action', '')} "
+                f"overshoot_us={message.get('overshoot_us', '')} "
+                f"remaining={message.get('remaining', 0)} "
+                f"pose={message.get('pose', '')}"
+            )
+            self._record_pose_estimate(message)
+            if message.get("remaining", 0) == 0:
+                self._handle_motion_done()
             return
         if event == "debug_move_request":
             self._log(
@@ -163,7 +191,9 @@ class RobotStateMachine:
 
         try:
             goal_pose = self.cabinet_index.get_pose(self.active_job.cabinet_id)
-            route = plan_route(self.grid_map, self.current_pose, goal_pose)
+            route = plan_route(
+                self.grid_map, self.current_pose, goal_pose, self.prefer_arcs
+            )
         except (KeyError, ValueError) as exc:
             self._log(f"job_rejected cabinet={self.active_job.cabinet_id} error={exc}")
             self.arduino.lcd_set(
@@ -215,11 +245,12 @@ class RobotStateMachine:
         self.loading_boxes_ready.clear()
         self.loading_seen_released = {1: False, 2: False}
         self._log(f"closing_boxes_before_move boxes={list(self.active_boxes)}")
-        for box in sorted(self.active_boxes):
-            self.arduino.servo_close(box)
-        self.arduino.lcd_set(
-            moving_lines(self.active_job, len(self.queue), self.active_boxes)
-        )
+        with self.arduino.batch():
+            for box in sorted(self.active_boxes):
+                self.arduino.servo_close(box)
+            self.arduino.lcd_set(
+                moving_lines(self.active_job, len(self.queue), self.active_boxes)
+            )
         self._schedule_next_action(BOX_CLOSE_SETTLE_S)
 
     def _dispatch_next_action_now(self) -> None:
@@ -232,18 +263,20 @@ class RobotStateMachine:
                 self._log(
                     f"arrived cabinet={self.active_job.cabinet_id} waiting_for_card boxes={list(self.active_boxes)}"
                 )
-                self.current_pose = self.cabinet_index.get_pose(
-                    self.active_job.cabinet_id
-                )
+                self._arrive_at(self.cabinet_index.get_pose(self.active_job.cabinet_id))
                 self.arduino.lcd_set(
                     waiting_card_lines(
                         self.active_job, len(self.queue), self.active_boxes
                     )
                 )
             return
-        action = self.pending_actions.pop(0)
-        self._log(f"dispatch_action mode={self.mode} action={action}")
-        self.arduino.move(action)
+        # The whole route goes out in one command, with runs of identical
+        # actions folded into segments; only routes longer than the firmware
+        # queue wait for a motion_done between chunks.
+        segments = compact_actions(self.pending_actions)[:MAX_ROUTE_STEPS]
+        del self.pending_actions[: sum(segment.cells for segment in segments)]
+        self._log(f"dispatch_route mode={self.mode} segments={segments}")
+        self.arduino.route(segments)
 
     def _schedule_next_action(self, delay_s: float) -> None:
         self.next_action_due_s = time.monotonic() + delay_s
@@ -358,7 +391,9 @@ class RobotStateMachine:
             self._try_start_next_job()
             return
 
-        home_route = plan_route(self.grid_map, self.current_pose, self.grid_map.home)
+        home_route = plan_route(
+            self.grid_map, self.current_pose, self.grid_map.home, self.prefer_arcs
+        )
         self._log(
             f"return_home route_steps={home_route.steps} turns={home_route.turns} actions={home_route.actions}"
         )
@@ -376,11 +411,32 @@ class RobotStateMachine:
 
     def _finish_return_home(self) -> None:
         self._log("return_home_complete")
-        self.current_pose = self.grid_map.home
+        self._arrive_at(self.grid_map.home)
         self._clear_active_delivery_state()
         self._refresh_idle_lcd()
         self._try_start_next_job()
 
+    def _record_pose_estimate(self, message: dict) -> None:
+        estimate = parse_pose(message.get("pose"))
+        if estimate is not None:
+            self.pose_estimate = estimate
+
+    def _arrive_at(self, pose: Pose) -> None:
+        # The route ended where it was planned to; dead reckoning that snaps to
+        # another cell means a step was lost or cut, which is worth a log line.
+        # Either way the firmware restarts from the planned pose.
+        if self.pose_estimate is not None:
+            snapped = snap_pose(self.pose_estimate)
+            if snapped != pose:
+                self._log(f"pose_mismatch planned={pose} estimate={self.pose_estimate}")
+        self.current_pose = pose
+        self._sync_firmware_pose()
+
+    def _sync_firmware_pose(self) -> None:
+        self.pose_estimate = None
+        if hasattr(self.arduino, "set_pose"):
+            self.arduino.set_pose(self.current_pose)
+
     def _maybe_refresh_box_presence(self, now_s: float) -> None:
         if self.next_presence_refresh_s is None or now_s < self.next_presence_refresh_s:
             return
@@ -393,13 +449,19 @@ class RobotStateMachine:
 
     def _handle_reset_request(self) -> None:
         self._log("reset_requested")
-        if hasattr(self.arduino, "stop"):
+        if hasattr(self.arduino, "emergency_stop"):
+            self.arduino.emergency_stop()
+        elif hasattr(self.arduino, "stop"):
             self.arduino.stop()
         self.keypad_parser.reset()
         self.queue.clear()
         self.current_pose = self.grid_map.home
+        self._sync_firmware_pose()
         self.box_present = {1: None, 2: None}
         self._clear_active_delivery_state()
+        # Everything queued before the stop is gone; the robot may drive again.
+        if hasattr(self.arduino, "clear_emergency_stop"):
+            self.arduino.clear_emergency_stop()
         if hasattr(self.arduino, "ping"):
             self.arduino.ping()
         if hasattr(self.arduino, "rfid_reset"):
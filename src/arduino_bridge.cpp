@@ -1,448 +1,935 @@
 #include "arduino_bridge.h"
 
+#include "batch_dispatch.h"
+#include "calibration_store.h"
+#include "motion_timer.h"
+#include "motion_trim.h"
 #include "runtime_config.h"
 
 namespace {
-String unescapeCompactField(const String &value) {
-  String out;
-  bool escaped = false;
-  for (unsigned int i = 0; i < value.length(); i++) {
-    const char ch = value[i];
-    if (escaped) {
-      switch (ch) {
-        case 'n':
-          out += '\n';
-          break;
-        case 'r':
-          out += '\r';
-          break;
-        case '\\':
-        case '|':
-          out += ch;
-          break;
-        default:
-          out += ch;
-          break;
-      }
-      escaped = false;
-      continue;
-    }
-    if (ch == '\\') {
-      escaped = true;
-      continue;
-    }
-    out += ch;
-  }
-  return out;
-}
-
-uint8_t splitCompactFields(const String &line, String *fields, uint8_t maxFields) {
-  uint8_t count = 0;
-  String current;
-  bool escaped = false;
-
-  for (unsigned int i = 0; i < line.length(); i++) {
-    const char ch = line[i];
-    if (escaped) {
-      current += '\\';
-      current += ch;
-      escaped = false;
-      continue;
-    }
-    if (ch == '\\') {
-      escaped = true;
-      continue;
-    }
-    if (ch == '|') {
-      if (count < maxFields) {
-        fields[count++] = unescapeCompactField(current);
-      }
-      current = "";
-      continue;
-    }
-    current += ch;
-  }
-
-  if (escaped) {
-    current += '\\';
-  }
-  if (count < maxFields) {
-    fields[count++] = unescapeCompactField(current);
-  }
-  return count;
-}
+constexpr uint8_t MAX_COMPACT_FIELDS = 4;
+constexpr uint8_t MAX_BATCH_COMMANDS = 6;
+
+// Periods and per-run budgets in microseconds. Motion is critical: it runs
+// before anything else that is due, and the RX task yields to it between
+// commands so LCD writes cannot hold back a motion cut-off.
+constexpr TaskSpec TASKS[] = {
+    {"motion", 1000, 200, true},
+    {"rx", 1000, 6000, false},
+    {"tx", 1000, 300, false},
+    {"switches", 5000, 200, false},
+    {"keypad", 10000, 500, false},
+    {"locks", 20000, 300, false},
+    {"rfid", 50000, 3000, false},
+};
+
+// Phase each task's time is charged to after its last lap_(); split tasks
+// lap_() their first phase themselves.
+constexpr ProfilePhase TASK_CLOSING_PHASES[] = {
+    ProfilePhase::EmitDrive,  ProfilePhase::Rx,    ProfilePhase::Tx,       ProfilePhase::EmitSwitches,
+    ProfilePhase::EmitKeypad, ProfilePhase::Locks, ProfilePhase::EmitRfid,
+};
 }  // namespace
 
 void ArduinoBridge::begin() {
   Serial.begin(SERIAL_BAUD);
+  baud_ = SERIAL_BAUD;
   while (!Serial && millis() < SERIAL_WAIT_MS) {
   }
 
-  protocol_.begin(Serial);
+  protocol_.begin(Serial, SERIAL_RX_RING_BYTES);
+  protocol_.setEmergencyStopHandler(&MotionTimer::trip);
   drive_.begin();
   locks_.begin();
   keypad_.begin();
   lcd_.begin();
   rfid_.begin();
   switches_.begin();
+  static_assert(sizeof(TASKS) / sizeof(TASKS[0]) == TASK_COUNT,
+                "TASKS needs one entry per task handler");
+  static_assert(sizeof(TASK_CLOSING_PHASES) / sizeof(TASK_CLOSING_PHASES[0]) == TASK_COUNT,
+                "TASK_CLOSING_PHASES needs one entry per task handler");
+  static_assert((PROFILE_SAMPLE_EVERY & (PROFILE_SAMPLE_EVERY - 1)) == 0,
+                "PROFILE_SAMPLE_EVERY must be a power of two");
+  measureProfilerCost_();
+  scheduler_.begin(TASKS, TASK_COUNT, micros());
   emitReady_();
 }
 
 void ArduinoBridge::update() {
-  String line;
+  const uint32_t start = micros();
+  pollEmergencyStop_(start);
+  emitEmergencyStop_();
+  const uint8_t task = scheduler_.nextDue(start);
+  if (task == TaskScheduler::NO_TASK) {
+    return;
+  }
+  TaskHandler handler;
+  memcpy_P(&handler, &TASK_HANDLERS[task], sizeof(handler));
+  profiling_ = (++profile_passes_ & (PROFILE_SAMPLE_EVERY - 1)) == 0;
+  phase_started_us_ = start;
+  (this->*handler)();
+  const uint32_t end = micros();
+  if (profiling_) {
+    profiler_.record(TASK_CLOSING_PHASES[task], end - phase_started_us_);
+  }
+  scheduler_.finish(task, start, end);
+}
+
+void ArduinoBridge::lap_(ProfilePhase phase) {
+  // The micros() read is the emergency stop scan's; on a pass that is not
+  // profiled, nothing else is spent here.
+  const uint32_t now = micros();
+  if (profiling_) {
+    profiler_.record(phase, now - phase_started_us_);
+    phase_started_us_ = now;
+  }
+  // Phase boundaries are the longest stretches the RX ring goes unscanned.
+  pollEmergencyStop_(now);
+}
+
+void ArduinoBridge::measureProfilerCost_() {
+  // Laps taken the way lap_() takes them, on a phase that is cleared after.
+  static constexpr uint8_t LAPS = 64;
+  const uint32_t started = micros();
+  uint32_t previous = started;
+  for (uint8_t i = 0; i < LAPS; i++) {
+    const uint32_t now = micros();
+    profiler_.record(ProfilePhase::Tx, now - previous);
+    previous = now;
+  }
+  const uint32_t elapsedUs = micros() - started;
+  profiler_.reset(ProfilePhase::Tx);
+  profile_sample_cycles_ = static_cast<uint16_t>(elapsedUs * (F_CPU / 1000000UL) / LAPS);
+}
+
+void ArduinoBridge::pollEmergencyStop_(uint32_t nowUs) {
+  protocol_.pumpRx(nowUs);
+  uint32_t arrivedAfterUs;
+  if (!protocol_.takeEmergencyStop(arrivedAfterUs)) {
+    return;
+  }
+  // The handler already zeroed PWM; stop the drive before its next update()
+  // can take the cut for a finished step and start the next one.
+  const int32_t latencyUs = static_cast<int32_t>(MotionTimer::firedAtUs() - arrivedAfterUs);
+  estop_dropped_ = drive_.stop();
+  estop_latency_us_ = latencyUs > 0 ? static_cast<uint32_t>(latencyUs) : 0;
+  if (estop_latency_us_ > estop_max_latency_us_) {
+    estop_max_latency_us_ = estop_latency_us_;
+  }
+  estop_pending_ = true;
+  estop_latched_ = true;
+}
+
+const ArduinoBridge::TaskHandler ArduinoBridge::TASK_HANDLERS[TASK_COUNT] PROGMEM = {
+    &ArduinoBridge::runMotionTask_, &ArduinoBridge::runRxTask_,
+    &ArduinoBridge::runTxTask_,     &ArduinoBridge::runSwitchTask_,
+    &ArduinoBridge::runKeypadTask_, &ArduinoBridge::runLockTask_,
+    &ArduinoBridge::runRfidTask_,
+};
+
+void ArduinoBridge::runMotionTask_() {
+  drive_.update();
+  lap_(ProfilePhase::Drive);
+  emitDriveEvents_();
+}
+
+void ArduinoBridge::runRxTask_() {
+  LineView line;
   while (protocol_.pollLine(line)) {
+    // Emergency stops counted so far came before this line; any later one
+    // drops whatever of it has not run yet.
+    line_estops_ = protocol_.emergencyStops();
+    lap_(ProfilePhase::Rx);
     handleCommand_(line);
+    lap_(ProfilePhase::Dispatch);
+    if (scheduler_.criticalDue(phase_started_us_)) {
+      return;
+    }
   }
+}
 
-  drive_.update();
-  locks_.update();
-  keypad_.update();
+void ArduinoBridge::runTxTask_() {
+  protocol_.drainTx();
+  updateBaud_();
+}
+
+void ArduinoBridge::runSwitchTask_() {
   switches_.update();
+  lap_(ProfilePhase::Switches);
+  emitSwitchEvents_();
+}
 
-  emitDriveEvents_();
+void ArduinoBridge::runKeypadTask_() {
+  keypad_.update();
+  lap_(ProfilePhase::Keypad);
   emitKeypadEvents_();
-  emitSwitchEvents_();
-  emitRfidEvents_();
 }
 
-void ArduinoBridge::handleCommand_(const String &line) {
-  if (line.startsWith("@")) {
+void ArduinoBridge::runLockTask_() { locks_.update(); }
+
+void ArduinoBridge::runRfidTask_() { emitRfidEvents_(); }
+
+void ArduinoBridge::handleCommand_(const LineView &line) {
+  if (line.data[0] == '@') {
     handleCompactCommand_(line);
-    return;
+  } else {
+    handleJsonCommand_(line);
   }
-  handleJsonCommand_(line);
+  protocol_.setSequence(NO_SEQUENCE);
 }
 
-void ArduinoBridge::handleJsonCommand_(const String &json) {
-  String command;
-  if (!SerialProtocol::extractString(json, "type", command)) {
+void ArduinoBridge::handleJsonCommand_(const LineView &line) {
+  JsonFieldIndex json;
+  if (!json.parse(line.data, line.length)) {
+    protocol_.sendError("invalid_json", "Command is not a JSON object");
+    return;
+  }
+
+  long sequence = NO_SEQUENCE;
+  if (json.getInt("seq", sequence) && sequence >= 0 && sequence <= MAX_SEQUENCE) {
+    protocol_.setSequence(static_cast<int32_t>(sequence));
+  }
+
+  CompactField command;
+  if (!json.getString("type", command.data, command.length)) {
     protocol_.sendError("missing_type", "Command must contain a type field");
     return;
   }
 
-  if (command == "ping") {
-    protocol_.sendAck("ping");
+  CommandSpec spec;
+  if (!findCommandByName(command.data, command.length, spec)) {
+    protocol_.beginError("unknown_command", "Unsupported command type")
+        .field("command", command.data, command.length);
+    protocol_.send();
     return;
   }
 
-  if (command == "get_state") {
-    emitState_();
-    protocol_.sendAck("get_state");
+  // Scalar values are already unescaped and terminated in the line buffer, so
+  // they feed the same handlers as compact fields; each key is looked up on
+  // its own and an omitted one leaves its slot absent.
+  CompactField fields[COMMAND_MAX_ARGS];
+  const uint8_t count = collectJsonArgs(json, spec, fields);
+  dispatch_(spec, CommandArgs{fields, count});
+}
+
+void ArduinoBridge::handleCompactCommand_(const LineView &line) {
+  // The raw line is copied into the debug frame before the in-place split
+  // rewrites the buffer; the remaining debug fields are appended afterwards.
+  FrameWriter &debug = protocol_.beginEvent("debug_compact_rx").field("raw", line.data, line.length);
+  if (line.data[1] == BATCH_OPCODE) {
+    CompactSegment segments[MAX_BATCH_COMMANDS + 1];
+    const uint8_t count =
+        splitCompactBatch(line.data + 1, line.length - 1, segments, MAX_BATCH_COMMANDS + 1);
+    debug.field("opcode", segments[0].data, segments[0].length).field("batch_count", count - 1);
+    protocol_.send();
+    handleBatch_(segments, count);
     return;
   }
 
-  if (command == "lcd_clear") {
-    lcd_.clear();
-    protocol_.sendAck("lcd_clear", String("\"available\":") + (lcd_.available() ? "true" : "false"));
+  CompactField fields[MAX_COMPACT_FIELDS];
+  const uint8_t count = splitCompactFields(line.data + 1, line.length - 1, fields, MAX_COMPACT_FIELDS);
+  debug.field("opcode", fields[0].data, fields[0].length).field("field_count", count);
+  protocol_.send();
+
+  if (count == 0 || fields[0].length == 0) {
+    protocol_.sendError("missing_opcode", "Compact command missing opcode");
     return;
   }
 
-  if (command == "lcd_backlight") {
-    bool enabled = true;
-    if (!SerialProtocol::extractBool(json, "enabled", enabled)) {
-      protocol_.sendError("missing_enabled", "lcd_backlight requires enabled=true/false");
-      return;
-    }
-    lcd_.setBacklight(enabled);
-    protocol_.sendAck("lcd_backlight", String("\"enabled\":") + (enabled ? "true" : "false"));
+  int32_t sequence = NO_SEQUENCE;
+  const char opcode = compactOpcode(fields[0], sequence);
+  protocol_.setSequence(sequence);
+
+  CommandSpec spec;
+  if (!findCommandByOpcode(opcode, spec)) {
+    protocol_.beginError("unknown_opcode", "Unsupported compact opcode")
+        .field("opcode", fields[0].data, fields[0].length);
+    protocol_.send();
     return;
   }
+  dispatch_(spec, CommandArgs{fields + 1, static_cast<uint8_t>(count - 1)});
+}
 
-  if (command == "lcd_set") {
-    protocol_.sendError("unsupported_command",
-                        "lcd_set is disabled; use lcd_set_line commands instead");
+void ArduinoBridge::handleBatch_(CompactSegment *segments, uint8_t count) {
+  int32_t sequence = NO_SEQUENCE;
+  if (compactOpcode(CompactField{segments[0].data, segments[0].length}, sequence) != BATCH_OPCODE) {
+    protocol_.beginError("unknown_opcode", "Unsupported compact opcode")
+        .field("opcode", segments[0].data, segments[0].length);
+    protocol_.send();
     return;
   }
+  protocol_.setSequence(sequence);
 
-  if (command == "lcd_set_line") {
-    int lineIndex = -1;
-    if (!SerialProtocol::extractInt(json, "line", lineIndex)) {
-      protocol_.sendError("missing_line", "lcd_set_line requires line index 0..3");
-      return;
-    }
+  const uint8_t commandCount = count - 1;
+  if (commandCount == 0 || commandCount > MAX_BATCH_COMMANDS) {
+    protocol_.beginError("invalid_batch", "Batch must hold 1 to 6 commands")
+        .field("count", commandCount);
+    protocol_.send();
+    return;
+  }
 
-    String text;
-    if (!SerialProtocol::extractString(json, "text", text)) {
-      protocol_.sendError("missing_text", "lcd_set_line requires text string");
+  // Every sub-command is parsed and checked before any of them runs, so a
+  // malformed batch has no side effects.
+  CompactField fields[MAX_BATCH_COMMANDS][MAX_COMPACT_FIELDS];
+  uint8_t fieldCounts[MAX_BATCH_COMMANDS];
+  CommandSpec specs[MAX_BATCH_COMMANDS];
+  for (uint8_t i = 0; i < commandCount; i++) {
+    CompactSegment &segment = segments[i + 1];
+    fieldCounts[i] = splitCompactFields(segment.data, segment.length, fields[i], MAX_COMPACT_FIELDS);
+    int32_t ignored = NO_SEQUENCE;
+    if (!findCommandByOpcode(compactOpcode(fields[i][0], ignored), specs[i])) {
+      protocol_.beginError("invalid_batch", "Unsupported opcode in batch")
+          .field("index", i)
+          .field("opcode", fields[i][0].data, fields[i][0].length);
+      protocol_.send();
       return;
     }
-
-    const bool ok = lcd_.setLine(static_cast<uint8_t>(lineIndex), text);
-    if (!ok) {
-      protocol_.sendError("lcd_write_failed", "lcd_set_line failed",
-                          String("\"line\":") + lineIndex);
+    if (fieldCounts[i] - 1 < specs[i].minArgs) {
+      protocol_.beginError("invalid_batch", "Batch command is missing required fields")
+          .field("index", i)
+          .field("command", specs[i].name);
+      protocol_.send();
       return;
     }
+  }
+
+  // Sub-commands can lap_(), which takes emergency stops; one taken mid-batch
+  // drops the rest of it.
+  const char *statuses[MAX_BATCH_COMMANDS];
+  runBatch(
+      commandCount, statuses,
+      [&](uint8_t i) -> const char * {
+        protocol_.beginCapture();
+        dispatch_(specs[i], CommandArgs{fields[i] + 1, static_cast<uint8_t>(fieldCounts[i] - 1)});
+        return protocol_.endCapture();
+      },
+      [this]() { return lineInterrupted_(); });
+
+  FrameWriter &ack = protocol_.beginAck("batch");
+  ack.beginArray("status");
+  for (uint8_t i = 0; i < commandCount; i++) {
+    ack.value(statuses[i]);
+  }
+  ack.endArray();
+  protocol_.send();
+}
 
-    protocol_.sendAck("lcd_set_line",
-                      String("\"line\":") + lineIndex + ",\"text\":\"" +
-                          SerialProtocol::escape(text) + "\"");
+void ArduinoBridge::dispatch_(const CommandSpec &spec, const CommandArgs &args) {
+  if (lineInterrupted_()) {
+    protocol_.sendError(DROPPED_STATUS, "Emergency stop arrived after this command");
     return;
   }
-
-  if (command == "lcd_demo") {
-    String lines[LCD_ROWS];
-    lines[0] = "LCD demo";
-    lines[1] = "Arduino bridge";
-    lines[2] = String("Addr: 0x") + String(lcd_.address(), HEX);
-    lines[2].toUpperCase();
-    lines[3] = "If seen, LCD OK";
-    const bool ok = lcd_.setLines(lines, LCD_ROWS);
-    protocol_.sendAck("lcd_demo", String("\"available\":") + (ok ? "true" : "false"));
+  uint8_t required = 0;
+  while (required < spec.minArgs && args.has(required)) {
+    required++;
+  }
+  if (required < spec.minArgs) {
+    FrameWriter &error = protocol_.beginError("missing_fields", "Command is missing required fields");
+    error.field("command", spec.name).beginArray("expected");
+    for (uint8_t i = 0; i < spec.minArgs; i++) {
+      error.value(spec.keys[i]);
+    }
+    error.endArray();
+    protocol_.send();
     return;
   }
 
-  if (command == "servo_open" || command == "servo_close" || command == "servo_set_angle") {
-    int box = 0;
-    if (!SerialProtocol::extractInt(json, "box", box)) {
-      protocol_.sendError("missing_box", "Servo command requires box=1 or box=2");
-      return;
-    }
+  CommandHandler handler;
+  memcpy_P(&handler, &COMMAND_HANDLERS[static_cast<uint8_t>(spec.id)], sizeof(handler));
+  // A command that parses at a new rate confirms it; the Pi sends a ping.
+  baud_on_trial_ = false;
+  (this->*handler)(spec, args);
+}
 
-    bool ok = false;
-    if (command == "servo_open") {
-      ok = locks_.openBox(static_cast<uint8_t>(box));
-    } else if (command == "servo_close") {
-      ok = locks_.closeBox(static_cast<uint8_t>(box));
-    } else {
-      int angle = 0;
-      if (!SerialProtocol::extractInt(json, "angle", angle)) {
-        protocol_.sendError("missing_angle", "servo_set_angle requires angle");
-        return;
-      }
-      ok = locks_.setAngle(static_cast<uint8_t>(box), static_cast<uint8_t>(angle));
-    }
+const ArduinoBridge::CommandHandler ArduinoBridge::COMMAND_HANDLERS[COMMAND_COUNT] PROGMEM = {
+    &ArduinoBridge::handlePing_,          &ArduinoBridge::handleGetState_,
+    &ArduinoBridge::handleRfidReset_,     &ArduinoBridge::handleLcdClear_,
+    &ArduinoBridge::handleLcdDemo_,       &ArduinoBridge::handleLcdSetLine_,
+    &ArduinoBridge::handleLcdSet_,        &ArduinoBridge::handleLcdBacklight_,
+    &ArduinoBridge::handleServo_,         &ArduinoBridge::handleServo_,
+    &ArduinoBridge::handleServoSetAngle_, &ArduinoBridge::handleMove_,
+    &ArduinoBridge::handleStop_,          &ArduinoBridge::handleLinkMode_,
+    &ArduinoBridge::handleSetBaud_,       &ArduinoBridge::handleStats_,
+    &ArduinoBridge::handleProfile_,       &ArduinoBridge::handleRoute_,
+    &ArduinoBridge::handleCalibration_,   &ArduinoBridge::handlePose_,
+    &ArduinoBridge::handleEstopClear_,
+};
+
+void ArduinoBridge::handlePing_(const CommandSpec &spec, const CommandArgs &) {
+  protocol_.sendAck(spec.name);
+}
 
-    if (!ok) {
-      protocol_.sendError("invalid_box", "Unknown box id", String("\"box\":") + box);
-      return;
-    }
-    protocol_.sendAck(command.c_str(), String("\"box\":") + box + ",\"state\":\"" +
-                                       locks_.boxState(static_cast<uint8_t>(box)) + "\"");
+void ArduinoBridge::handleGetState_(const CommandSpec &spec, const CommandArgs &) {
+  emitState_();
+  protocol_.sendAck(spec.name);
+}
+
+void ArduinoBridge::handleRfidReset_(const CommandSpec &spec, const CommandArgs &) {
+  rfid_.begin();
+  protocol_.sendAck(spec.name);
+}
+
+void ArduinoBridge::handleLcdClear_(const CommandSpec &spec, const CommandArgs &) {
+  lap_(ProfilePhase::Dispatch);
+  lcd_.clear();
+  lap_(ProfilePhase::LcdI2c);
+  protocol_.beginAck(spec.name).field("available", lcd_.available());
+  protocol_.send();
+}
+
+void ArduinoBridge::handleLcdDemo_(const CommandSpec &spec, const CommandArgs &) {
+  lap_(ProfilePhase::Dispatch);
+  const bool ok = drawLcdDemo_();
+  lap_(ProfilePhase::LcdI2c);
+  protocol_.beginAck(spec.name).field("available", ok);
+  protocol_.send();
+}
+
+void ArduinoBridge::handleLcdSetLine_(const CommandSpec &spec, const CommandArgs &args) {
+  const uint8_t lineIndex = static_cast<uint8_t>(args.integer(0));
+  lap_(ProfilePhase::Dispatch);
+  const bool ok = lcd_.setLine(lineIndex, args.text(1));
+  lap_(ProfilePhase::LcdI2c);
+  if (!ok) {
+    protocol_.beginError("lcd_write_failed", "lcd_set_line failed").field("line", lineIndex);
+    protocol_.send();
     return;
   }
+  protocol_.beginAck(spec.name)
+      .field("line", lineIndex)
+      .field("text", args.text(1), args.length(1));
+  protocol_.send();
+}
 
-  if (command == "move") {
-    String action;
-    if (!SerialProtocol::extractString(json, "action", action)) {
-      protocol_.sendError("missing_action", "move requires an action string");
-      return;
-    }
+void ArduinoBridge::handleLcdSet_(const CommandSpec &, const CommandArgs &) {
+  protocol_.sendError("unsupported_command",
+                      "lcd_set is disabled; use lcd_set_line commands instead");
+}
 
-    int durationMs = 0;
-    SerialProtocol::extractInt(json, "duration_ms", durationMs);
-    if (!drive_.startAction(action, durationMs > 0 ? static_cast<unsigned long>(durationMs) : 0)) {
-      if (drive_.busy()) {
-        protocol_.sendError("drive_busy", "Drive controller is busy",
-                            String("\"current\":\"") + drive_.currentAction() + "\"");
-      } else {
-        protocol_.sendError("invalid_action", "Unknown move action",
-                            String("\"action\":\"") + SerialProtocol::escape(action) + "\"");
-      }
-      return;
-    }
-    protocol_.sendAck("move", String("\"action\":\"") + SerialProtocol::escape(action) + "\"");
+void ArduinoBridge::handleLcdBacklight_(const CommandSpec &spec, const CommandArgs &args) {
+  const bool enabled = args.flag(0);
+  lap_(ProfilePhase::Dispatch);
+  lcd_.setBacklight(enabled);
+  lap_(ProfilePhase::LcdI2c);
+  protocol_.beginAck(spec.name).field("enabled", enabled);
+  protocol_.send();
+}
+
+void ArduinoBridge::handleServo_(const CommandSpec &spec, const CommandArgs &args) {
+  const uint8_t box = static_cast<uint8_t>(args.integer(0));
+  const bool ok = spec.id == CommandId::ServoOpen ? locks_.openBox(box) : locks_.closeBox(box);
+  if (!ok) {
+    protocol_.beginError("invalid_box", "Unknown box id").field("box", box);
+    protocol_.send();
     return;
   }
+  protocol_.beginAck(spec.name).field("box", box).field("state", locks_.boxState(box));
+  protocol_.send();
+}
 
-  if (command == "stop") {
-    drive_.stop();
-    protocol_.sendAck("stop");
+void ArduinoBridge::handleServoSetAngle_(const CommandSpec &spec, const CommandArgs &args) {
+  const uint8_t box = static_cast<uint8_t>(args.integer(0));
+  const uint8_t angle = static_cast<uint8_t>(args.integer(1));
+  if (!locks_.setAngle(box, angle)) {
+    protocol_.beginError("invalid_box", "Unknown box id").field("box", box);
+    protocol_.send();
     return;
   }
+  protocol_.beginAck(spec.name)
+      .field("box", box)
+      .field("angle", angle)
+      .field("state", locks_.boxState(box));
+  protocol_.send();
+}
 
-  protocol_.sendError("unknown_command", "Unsupported command type",
-                      String("\"command\":\"") + SerialProtocol::escape(command) + "\"");
+bool ArduinoBridge::refuseWhileEmergencyStop_() {
+  // Nothing may start the wheels again until the Pi has seen the stop and
+  // clears it; a line sent before the stop cannot do that by accident.
+  if (!estop_latched_) {
+    return false;
+  }
+  protocol_.sendError("estop_latched", "Emergency stop not cleared");
+  return true;
 }
 
-void ArduinoBridge::handleCompactCommand_(const String &line) {
-  String fields[4];
-  const uint8_t count = splitCompactFields(line.substring(1), fields, 4);
-  if (count == 0) {
-    protocol_.sendError("missing_opcode", "Compact command missing opcode");
+bool ArduinoBridge::refuseOverlongSteps_(const MotionStep *steps, uint8_t count) {
+  const uint8_t index = drive_.firstOverlongStep(steps, count);
+  if (index == count) {
+    return false;
+  }
+  protocol_.beginError("invalid_argument", "Step runs longer than the limit")
+      .field("index", index)
+      .field("max_ms", MAX_STEP_MS);
+  protocol_.send();
+  return true;
+}
+
+void ArduinoBridge::handleMove_(const CommandSpec &spec, const CommandArgs &args) {
+  if (refuseWhileEmergencyStop_()) {
     return;
   }
+  const long requestedMs = args.has(1) ? args.integer(1) : 0;
+  const unsigned long durationMs = requestedMs > 0 ? static_cast<unsigned long>(requestedMs) : 0;
+  protocol_.beginEvent("debug_move_request")
+      .field("action", args.text(0), args.length(0))
+      .field("duration_ms", durationMs)
+      .field("busy", drive_.busy());
+  protocol_.send();
+  MotionStep step;
+  uint8_t errorIndex = 0;
+  if (parseRoute(args.text(0), args.length(0), &step, 1, errorIndex) == 1) {
+    if (durationMs > 0) {
+      step.durationMs = durationMs;
+    }
+    if (refuseOverlongSteps_(&step, 1)) {
+      return;
+    }
+  }
+  MotionSuperseded superseded{};
+  const bool replace = args.has(2) && args.flag(2);
+  if (!drive_.startAction(args.text(0), durationMs, replace ? &superseded : nullptr)) {
+    if (drive_.busy() && !replace) {
+      protocol_.beginError("drive_busy", "Drive controller is busy")
+          .field("current", drive_.currentAction());
+    } else {
+      protocol_.beginError("invalid_action", "Unknown move action")
+          .field("action", args.text(0), args.length(0));
+    }
+    protocol_.send();
+    return;
+  }
+  FrameWriter &ack = protocol_.beginAck(spec.name).field("action", args.text(0), args.length(0));
+  if (replace) {
+    addSuperseded_(ack, superseded);
+  }
+  protocol_.send();
+}
 
-  const String opcode = fields[0];
-  protocol_.sendEvent("debug_compact_rx",
-                      String("\"opcode\":\"") + SerialProtocol::escape(opcode) +
-                          "\",\"field_count\":" + count + ",\"raw\":\"" +
-                          SerialProtocol::escape(line) + "\"");
+void ArduinoBridge::handleStop_(const CommandSpec &spec, const CommandArgs &) {
+  const uint8_t dropped = drive_.stop();
+  FrameWriter &ack = protocol_.beginAck(spec.name, TxPriority::Motion).field("dropped", dropped);
+  addPose_(ack, drive_.pose());
+  protocol_.send();
+}
 
-  if (opcode == "P") {
-    protocol_.sendAck("ping");
+void ArduinoBridge::handleRoute_(const CommandSpec &spec, const CommandArgs &args) {
+  if (refuseWhileEmergencyStop_()) {
     return;
   }
-
-   if (opcode == "R") {
-    rfid_.begin();
-    protocol_.sendAck("rfid_reset");
+  // Every step is checked before the first one starts, as in a batch.
+  MotionStep steps[MOTION_QUEUE_CAPACITY];
+  uint8_t errorIndex = 0;
+  const uint8_t count =
+      parseRoute(args.text(0), args.length(0), steps, MOTION_QUEUE_CAPACITY, errorIndex);
+  if (count == ROUTE_INVALID) {
+    protocol_.beginError("invalid_route", "Unknown route step or route too long")
+        .field("index", errorIndex);
+    protocol_.send();
     return;
   }
-
-  if (opcode == "G") {
-    emitState_();
-    protocol_.sendAck("get_state");
+  if (refuseOverlongSteps_(steps, count)) {
     return;
   }
-
-  if (opcode == "C") {
-    lcd_.clear();
-    protocol_.sendAck("lcd_clear", String("\"available\":") + (lcd_.available() ? "true" : "false"));
+  MotionSuperseded superseded{};
+  const bool replace = args.has(1) && args.flag(1);
+  if (!drive_.startRoute(steps, count, replace ? &superseded : nullptr)) {
+    protocol_.beginError("drive_busy", "Drive controller is busy")
+        .field("current", drive_.currentAction());
+    protocol_.send();
     return;
   }
+  FrameWriter &ack = protocol_.beginAck(spec.name).field("steps", count);
+  if (replace) {
+    addSuperseded_(ack, superseded);
+  }
+  protocol_.send();
+}
 
-  if (opcode == "D") {
-    String demo[LCD_ROWS];
-    demo[0] = "LCD demo";
-    demo[1] = "Arduino bridge";
-    demo[2] = String("Addr: 0x") + String(lcd_.address(), HEX);
-    demo[2].toUpperCase();
-    demo[3] = "If seen, LCD OK";
-    const bool ok = lcd_.setLines(demo, LCD_ROWS);
-    protocol_.sendAck("lcd_demo", String("\"available\":") + (ok ? "true" : "false"));
+void ArduinoBridge::addSuperseded_(FrameWriter &ack, const MotionSuperseded &superseded) {
+  // The cut step gets no motion_done; this is its report.
+  if (superseded.action == nullptr) {
     return;
   }
+  ack.field("superseded", superseded.action)
+      .field("executed_ms", superseded.executedMs)
+      .field("planned_ms", superseded.plannedMs)
+      .field("dropped", superseded.dropped);
+}
 
-  if (opcode == "L") {
-    if (count < 3) {
-      protocol_.sendError("missing_fields", "L requires line and text");
+void ArduinoBridge::handleCalibration_(const CommandSpec &spec, const CommandArgs &args) {
+  // "save" and "defaults" act on the whole set, "forward_drift" and
+  // "reverse_drift" derive that action's wheel trims from a measured run,
+  // "capture_supply" takes the present voltage as supply_nominal_mv; any
+  // other key names one field, by name or index, which is read back or, with a
+  // value, changed in RAM.
+  MotionCalibration &calibration = drive_.calibration();
+  const char *key = args.has(0) ? args.text(0) : "0";
+  if (strcmp(key, "save") == 0 || strcmp(key, "defaults") == 0) {
+    if (drive_.busy()) {
+      // EEPROM writes stall the loop for milliseconds per byte.
+      protocol_.beginError("drive_busy", "Drive controller is busy")
+          .field("current", drive_.currentAction());
+      protocol_.send();
       return;
     }
-    const uint8_t lineIndex = static_cast<uint8_t>(fields[1].toInt());
-    const bool ok = lcd_.setLine(lineIndex, fields[2]);
-    if (!ok) {
-      protocol_.sendError("lcd_write_failed", "lcd_set_line failed",
-                          String("\"line\":") + lineIndex);
-      return;
+    if (key[0] == 's') {
+      CalibrationStore::save(calibration);
+    } else {
+      calibration = DriveController::defaultCalibration();
     }
-    protocol_.sendAck("lcd_set_line",
-                      String("\"line\":") + lineIndex + ",\"text\":\"" +
-                          SerialProtocol::escape(fields[2]) + "\"");
+    protocol_.beginAck(spec.name).field("key", key);
+    protocol_.send();
     return;
   }
-
-  if (opcode == "O" || opcode == "X") {
-    if (count < 2) {
-      protocol_.sendError("missing_box", "Servo command requires box id");
+  if (strcmp(key, "capture_supply") == 0) {
+    // Taken right after calibrating the timings: they then hold as the pack
+    // drains.
+    const uint16_t millivolts = drive_.supplyMillivolts();
+    if (millivolts < SUPPLY_MIN_VALID_MV) {
+      protocol_.beginError("no_supply", "No motor supply reading").field("mv", millivolts);
+      protocol_.send();
       return;
     }
-    const uint8_t box = static_cast<uint8_t>(fields[1].toInt());
-    const bool ok = opcode == "O" ? locks_.openBox(box) : locks_.closeBox(box);
-    if (!ok) {
-      protocol_.sendError("invalid_box", "Unknown box id", String("\"box\":") + box);
-      return;
+    calibration.supplyNominalMv = millivolts;
+    protocol_.beginAck(spec.name).field("key", key).field("value", millivolts);
+    protocol_.send();
+    return;
+  }
+  const bool forwardDrift = strcmp(key, "forward_drift") == 0;
+  if (forwardDrift || strcmp(key, "reverse_drift") == 0) {
+    handleDriftTrim_(spec, args,
+                     forwardDrift ? MotionAction::ForwardCell : MotionAction::ReverseCell);
+    return;
+  }
+  uint8_t field = NO_CALIBRATION_FIELD;
+  if (isdigit(static_cast<unsigned char>(key[0]))) {
+    const long index = atol(key);
+    if (index < calibrationFieldCount()) {
+      field = static_cast<uint8_t>(index);
     }
-    protocol_.sendAck(opcode == "O" ? "servo_open" : "servo_close",
-                      String("\"box\":") + box + ",\"state\":\"" + locks_.boxState(box) +
-                          "\"");
+  } else {
+    field = findCalibrationField(key, strlen(key));
+  }
+  if (field == NO_CALIBRATION_FIELD) {
+    protocol_.beginError("invalid_key", "Unknown calibration key")
+        .field("count", calibrationFieldCount());
+    protocol_.send();
+    return;
+  }
+  if (args.has(1) && !setCalibrationField(calibration, field, args.integer(1))) {
+    protocol_.beginError("invalid_value", "Calibration value out of range")
+        .field("key", calibrationFieldName(field))
+        .field("min", calibrationFieldMin(field))
+        .field("max", calibrationFieldMax(field));
+    protocol_.send();
     return;
   }
+  protocol_.beginAck(spec.name)
+      .field("key", calibrationFieldName(field))
+      .field("value", getCalibrationField(calibration, field))
+      .field("min", calibrationFieldMin(field))
+      .field("max", calibrationFieldMax(field))
+      .field("count", calibrationFieldCount());
+  protocol_.send();
+}
 
-  if (opcode == "A") {
-    if (count < 3) {
-      protocol_.sendError("missing_fields", "A requires box and angle");
-      return;
-    }
-    const uint8_t box = static_cast<uint8_t>(fields[1].toInt());
-    const uint8_t angle = static_cast<uint8_t>(fields[2].toInt());
-    if (!locks_.setAngle(box, angle)) {
-      protocol_.sendError("invalid_box", "Unknown box id", String("\"box\":") + box);
-      return;
-    }
-    protocol_.sendAck("servo_set_angle",
-                      String("\"box\":") + box + ",\"angle\":" + angle);
+void ArduinoBridge::handleDriftTrim_(const CommandSpec &spec, const CommandArgs &args,
+                                     MotionAction action) {
+  // value: drift to the robot's left in mm (negative: right); run_mm: how far
+  // it travelled. The derived trims replace the action's row in RAM.
+  MotionCalibration &calibration = drive_.calibration();
+  const long runMm = args.has(2) ? args.integer(2) : 0;
+  if (!args.has(1) || runMm <= 0 ||
+      !deriveDriftTrim(calibration, action, args.integer(1), static_cast<uint32_t>(runMm),
+                       DRIVE_TRACK_MM)) {
+    protocol_.beginError("invalid_value", "Drift cannot be corrected by trim")
+        .field("key", args.text(0), args.length(0));
+    protocol_.send();
     return;
   }
+  const uint16_t *trim = calibration.wheelTrim[static_cast<uint8_t>(action) - 1];
+  protocol_.beginAck(spec.name)
+      .field("key", args.text(0), args.length(0))
+      .field("left", trim[static_cast<uint8_t>(Wheel::Left)])
+      .field("right", trim[static_cast<uint8_t>(Wheel::Right)]);
+  protocol_.send();
+}
 
-  if (opcode == "M") {
-    if (count < 2) {
-      protocol_.sendError("missing_action", "M requires action");
-      return;
-    }
-    const String action = fields[1];
-    const unsigned long durationMs = count >= 3 ? static_cast<unsigned long>(fields[2].toInt()) : 0;
-    protocol_.sendEvent("debug_move_request",
-                        String("\"action\":\"") + SerialProtocol::escape(action) +
-                            "\",\"duration_ms\":" + durationMs + ",\"busy\":" +
-                            (drive_.busy() ? "true" : "false"));
-    if (!drive_.startAction(action, durationMs)) {
-      if (drive_.busy()) {
-        protocol_.sendError("drive_busy", "Drive controller is busy",
-                            String("\"current\":\"") + drive_.currentAction() + "\"");
-      } else {
-        protocol_.sendError("invalid_action", "Unknown move action",
-                            String("\"action\":\"") + SerialProtocol::escape(action) + "\"");
-      }
+void ArduinoBridge::handlePose_(const CommandSpec &spec, const CommandArgs &args) {
+  // No arguments reads the estimate; x, y and heading (millicells, tenths of
+  // a degree) replace it with a known pose, e.g. after an RFID checkpoint.
+  if (args.has(0) || args.has(1) || args.has(2)) {
+    if (!args.has(0) || !args.has(1) || !args.has(2)) {
+      protocol_.beginError("invalid_pose", "Pose needs x, y and heading");
+      protocol_.send();
       return;
     }
-    protocol_.sendAck("move", String("\"action\":\"") + SerialProtocol::escape(action) + "\"");
+    const long heading = args.integer(2) % POSE_FULL_TURN;
+    drive_.setPose(args.integer(0), args.integer(1),
+                   static_cast<uint16_t>(heading < 0 ? heading + POSE_FULL_TURN : heading));
+  }
+  addPose_(protocol_.beginAck(spec.name), drive_.pose());
+  protocol_.send();
+}
+
+void ArduinoBridge::handleEstopClear_(const CommandSpec &spec, const CommandArgs &) {
+  // "latched" tells whether there was a stop to clear.
+  protocol_.beginAck(spec.name).field("latched", estop_latched_);
+  protocol_.send();
+  estop_latched_ = false;
+}
+
+void ArduinoBridge::addPose_(FrameWriter &frame, const PoseEstimate &pose) {
+  // [x, y, heading, position sd, heading sd]
+  frame.beginArray("pose")
+      .value(pose.x)
+      .value(pose.y)
+      .value(pose.heading)
+      .value(pose.positionSd())
+      .value(pose.headingSd())
+      .endArray();
+}
+
+void ArduinoBridge::handleLinkMode_(const CommandSpec &spec, const CommandArgs &args) {
+  LinkMode mode;
+  if (strcmp(args.text(0), "json") == 0) {
+    mode = LinkMode::Json;
+  } else if (strcmp(args.text(0), "binary") == 0) {
+    mode = LinkMode::Binary;
+  } else {
+    protocol_.beginError("invalid_mode", "Unknown link mode")
+        .field("mode", args.text(0), args.length(0));
+    protocol_.send();
     return;
   }
+  // The ack still goes out in the current mode.
+  protocol_.beginAck(spec.name).field("mode", SerialProtocol::linkModeName(mode));
+  protocol_.send();
+  protocol_.setLinkMode(mode);
+}
 
-  if (opcode == "T") {
-    drive_.stop();
-    protocol_.sendAck("stop");
+void ArduinoBridge::handleSetBaud_(const CommandSpec &spec, const CommandArgs &args) {
+  const unsigned long baud = static_cast<unsigned long>(args.integer(0));
+  bool supported = baud == SERIAL_BAUD;
+  for (uint8_t i = 0; i < SERIAL_FAST_BAUD_COUNT; i++) {
+    supported = supported || baud == SERIAL_FAST_BAUDS[i];
+  }
+  if (!supported) {
+    protocol_.beginError("invalid_baud", "Unsupported baud rate")
+        .field("baud", args.text(0), args.length(0));
+    protocol_.send();
     return;
   }
+  protocol_.beginAck(spec.name).field("baud", baud);
+  protocol_.send();
+  pending_baud_ = baud;
+}
 
-  protocol_.sendError("unknown_opcode", "Unsupported compact opcode",
-                      String("\"opcode\":\"") + SerialProtocol::escape(opcode) + "\"");
+void ArduinoBridge::handleStats_(const CommandSpec &spec, const CommandArgs &args) {
+  const long index = args.has(0) ? args.integer(0) : 0;
+  if (index < 0 || index >= scheduler_.count()) {
+    protocol_.beginError("invalid_task", "Unknown task index").field("count", scheduler_.count());
+    protocol_.send();
+    return;
+  }
+  const uint8_t task = static_cast<uint8_t>(index);
+  const TaskSpec &taskSpec = scheduler_.spec(task);
+  const TaskStats &stats = scheduler_.stats(task);
+  protocol_.beginAck(spec.name)
+      .field("task", taskSpec.name)
+      .field("count", scheduler_.count())
+      .field("period_us", taskSpec.periodUs)
+      .field("budget_us", taskSpec.budgetUs)
+      .field("last_us", stats.lastRunUs)
+      .field("max_us", stats.maxRunUs)
+      .field("overruns", stats.overruns)
+      .field("late", stats.late);
+  protocol_.send();
+}
+
+void ArduinoBridge::handleProfile_(const CommandSpec &spec, const CommandArgs &args) {
+  const long index = args.has(0) ? args.integer(0) : 0;
+  if (index < 0 || index >= PROFILE_PHASE_COUNT) {
+    protocol_.beginError("invalid_phase", "Unknown profile phase").field("count", PROFILE_PHASE_COUNT);
+    protocol_.send();
+    return;
+  }
+  const ProfilePhase phase = static_cast<ProfilePhase>(index);
+  const PhaseProfile &profile = profiler_.phase(phase);
+  // Only the non-empty stretch of the histogram is sent, starting at bucket
+  // hist_from, so a reply stays well inside one frame.
+  uint8_t first = 0;
+  uint8_t end = PROFILE_BUCKETS;
+  while (first < end && profile.histogram[first] == 0) {
+    first++;
+  }
+  while (end > first && profile.histogram[end - 1] == 0) {
+    end--;
+  }
+  FrameWriter &ack = protocol_.beginAck(spec.name);
+  ack.field("phase", LoopProfiler::phaseName(phase))
+      .field("count", PROFILE_PHASE_COUNT)
+      .field("samples", profile.samples)
+      .field("min_us", profile.minUs)
+      .field("max_us", profile.maxUs)
+      .field("mean_us", profile.meanUs())
+      .field("sample_cycles", profile_sample_cycles_)
+      .field("hist_from", first);
+  ack.beginArray("hist");
+  for (uint8_t i = first; i < end; i++) {
+    ack.value(profile.histogram[i]);
+  }
+  ack.endArray();
+  protocol_.send();
+  if (args.has(1) && args.flag(1)) {
+    profiler_.reset(phase);
+  }
+}
+
+void ArduinoBridge::updateBaud_() {
+  if (pending_baud_ != 0) {
+    // Wait until the ack, and everything queued before it, is on the wire.
+    if (!protocol_.txIdle() || Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1) {
+      return;
+    }
+    switchBaud_(pending_baud_);
+    pending_baud_ = 0;
+    baud_on_trial_ = baud_ != SERIAL_BAUD;
+    baud_switched_ms_ = millis();
+    return;
+  }
+  if (baud_on_trial_ && millis() - baud_switched_ms_ >= BAUD_CONFIRM_TIMEOUT_MS) {
+    baud_on_trial_ = false;
+    switchBaud_(SERIAL_BAUD);
+    protocol_.beginEvent("baud_fallback").field("baud", SERIAL_BAUD);
+    protocol_.send();
+  }
+}
+
+void ArduinoBridge::switchBaud_(unsigned long baud) {
+  // flush() only waits for the last byte or two in the shift register here.
+  Serial.flush();
+  Serial.end();
+  Serial.begin(baud);
+  protocol_.discardInput();
+  baud_ = baud;
+}
+
+bool ArduinoBridge::drawLcdDemo_() {
+  char address[LCD_COLS + 1];
+  snprintf(address, sizeof(address), "Addr: 0x%X", lcd_.address());
+  const char *const demo[LCD_ROWS] = {"LCD demo", "Arduino bridge", address, "If seen, LCD OK"};
+  return lcd_.setLines(demo, LCD_ROWS);
 }
 
 void ArduinoBridge::emitReady_() {
-  String fields = String("\"firmware\":\"arduino_bridge\",\"lcd_available\":") +
-                  (lcd_.available() ? "true" : "false") + ",\"lcd_address\":" + lcd_.address();
-  protocol_.sendEvent("ready", fields);
+  FrameWriter &ready = protocol_.beginEvent("ready");
+  ready.field("firmware", "arduino_bridge")
+      .field("lcd_available", lcd_.available())
+      .field("lcd_address", lcd_.address())
+      .field("rx_window", protocol_.rxWindow())
+      .field("calibration_stored", drive_.calibrationLoaded());
+  ready.beginArray("modes")
+      .value(SerialProtocol::linkModeName(LinkMode::Json))
+      .value(SerialProtocol::linkModeName(LinkMode::Binary))
+      .endArray();
+  ready.beginArray("bauds").value(SERIAL_BAUD);
+  for (uint8_t i = 0; i < SERIAL_FAST_BAUD_COUNT; i++) {
+    ready.value(SERIAL_FAST_BAUDS[i]);
+  }
+  ready.endArray();
+  protocol_.send();
 }
 
 void ArduinoBridge::emitState_() {
-  String fields = String("\"drive_busy\":") + (drive_.busy() ? "true" : "false") +
-                  ",\"drive_action\":\"" + drive_.currentAction() + "\"" +
-                  ",\"switches\":[" + (switches_.isPressed(1) ? "true" : "false") + "," +
-                  (switches_.isPressed(2) ? "true" : "false") + "]" + ",\"locks\":[\"" +
-                  locks_.boxState(1) + "\",\"" + locks_.boxState(2) + "\"]";
-  protocol_.sendEvent("state", fields);
+  FrameWriter &state = protocol_.beginEvent("state");
+  state.field("drive_busy", drive_.busy()).field("drive_action", drive_.currentAction());
+  state.beginArray("switches").value(switches_.isPressed(1)).value(switches_.isPressed(2)).endArray();
+  state.beginArray("locks").value(locks_.boxState(1)).value(locks_.boxState(2)).endArray();
+  state.field("rx_overflows", protocol_.rxOverflows());
+  state.beginArray("tx_dropped");
+  for (uint8_t i = 0; i < TX_PRIORITY_COUNT; i++) {
+    state.value(protocol_.txDropped(static_cast<TxPriority>(i)));
+  }
+  state.endArray();
+  protocol_.send();
+  // The rest would overflow TX_FRAME_CAPACITY, so it follows in one frame. It
+  // is a snapshot the next get_state replaces, so it goes out at Debug
+  // priority, where it evicts its own stale copies instead of taking Event
+  // ring space from keypad, switch and RFID events. nominal_mv is read back
+  // with the calibration command.
+  FrameWriter &telemetry = protocol_.beginEvent("telemetry", TxPriority::Debug)
+                               .field("mv", drive_.supplyMillivolts())
+                               .field("pwm_scale", drive_.supplyScalePermille());
+  addPose_(telemetry, drive_.pose());
+  if (ENCODER_MODE != EncoderMode::None) {
+    int32_t left;
+    int32_t right;
+    drive_.encoderTicks(left, right);
+    telemetry.beginArray("ticks").value(left).value(right).endArray();
+    telemetry.field("closed_loop", drive_.encoderStep())
+        .field("fallbacks", drive_.encoderFallbacks());
+  }
+  protocol_.send();
 }
 
 void ArduinoBridge::emitKeypadEvents_() {
   KeypadInputEvent event;
   while (keypad_.pollEvent(event)) {
-    String key;
-    key += event.key;
-    protocol_.sendEvent("key_event", String("\"key\":\"") + SerialProtocol::escape(key) +
-                                         "\",\"state\":\"" + event.state + "\"");
+    protocol_.beginEvent("key_event").field("key", event.key).field("state", event.state);
+    protocol_.send();
   }
 }
 
 void ArduinoBridge::emitSwitchEvents_() {
   SwitchEvent event;
   while (switches_.pollEvent(event)) {
-    protocol_.sendEvent("switch_state", String("\"box\":") + event.box + ",\"pressed\":" +
-                                            (event.pressed ? "true" : "false"));
+    protocol_.beginEvent("switch_state").field("box", event.box).field("pressed", event.pressed);
+    protocol_.send();
   }
 }
 
 void ArduinoBridge::emitRfidEvents_() {
-  String uid;
+  const char *uid = nullptr;
   const RfidReader::PollStatus status = rfid_.pollUid(uid);
+  lap_(ProfilePhase::RfidSpi);
   if (rfid_.consumeRecoveredSinceLastPoll()) {
-    protocol_.sendEvent("debug_rfid_recovered", "");
+    protocol_.sendEvent("debug_rfid_recovered");
   }
   if (status == RfidReader::PollStatus::ReadFailed) {
-    protocol_.sendEvent("debug_rfid_read_failed", "");
+    protocol_.sendEvent("debug_rfid_read_failed");
     return;
   }
   if (status == RfidReader::PollStatus::ScanSuccess) {
-    protocol_.sendEvent("rfid_scan",
-                        String("\"uid\":\"") + SerialProtocol::escape(uid) + "\"");
+    protocol_.beginEvent("rfid_scan").field("uid", uid);
+    protocol_.send();
   }
 }
 
 void ArduinoBridge::emitDriveEvents_() {
-  String action;
-  if (drive_.consumeCompletedAction(action)) {
-    protocol_.sendEvent("motion_done",
-                        String("\"action\":\"") + SerialProtocol::escape(action) + "\"");
+  MotionDone done;
+  if (drive_.consumeCompletedAction(done)) {
+    FrameWriter &frame = protocol_.beginEvent("motion_done", TxPriority::Motion)
+        .field("action", done.action)
+        .field("overshoot_us", done.overshootUs)
+        .field("cells", done.cells)
+        .field("step", done.step)
+        .field("remaining", done.remaining);
+    addPose_(frame, done.pose);
+    protocol_.send();
+  }
+}
+
+void ArduinoBridge::emitEmergencyStop_() {
+  if (!estop_pending_) {
+    return;
   }
+  estop_pending_ = false;
+  FrameWriter &frame = protocol_.beginEvent("estop", TxPriority::Motion)
+      .field("dropped", estop_dropped_)
+      .field("latency_us", estop_latency_us_)
+      .field("max_latency_us", estop_max_latency_us_);
+  addPose_(frame, drive_.pose());
+  protocol_.send();
 }
@@ -2,13 +2,18 @@
 
 #include <Arduino.h>
 
+#include "command_catalog.h"
+#include "compact_fields.h"
 #include "drive_controller.h"
+#include "json_fields.h"
 #include "keypad_reader.h"
 #include "lcd_display.h"
 #include "lock_controller.h"
+#include "loop_profiler.h"
 #include "rfid_reader.h"
 #include "serial_protocol.h"
 #include "switch_monitor.h"
+#include "task_scheduler.h"
 
 class ArduinoBridge {
  public:
@@ -23,14 +28,96 @@ class ArduinoBridge {
   LcdDisplay lcd_;
   RfidReader rfid_;
   SwitchMonitor switches_;
+  TaskScheduler scheduler_;
+  LoopProfiler profiler_;
+  // Start of the phase currently being timed; lap_() closes it.
+  uint32_t phase_started_us_ = 0;
+  // Cycles one recorded lap costs the loop (micros() plus record()), timed
+  // at boot.
+  uint16_t profile_sample_cycles_ = 0;
+  // Counts scheduler passes; profiling_ holds for one in PROFILE_SAMPLE_EVERY.
+  uint8_t profile_passes_ = 0;
+  bool profiling_ = false;
 
-  void handleCommand_(const String &line);
-  void handleJsonCommand_(const String &json);
-  void handleCompactCommand_(const String &line);
+  unsigned long baud_ = 0;
+  // Rate acked by set_baud, applied once the ack has left the UART.
+  unsigned long pending_baud_ = 0;
+  unsigned long baud_switched_ms_ = 0;
+  bool baud_on_trial_ = false;
+
+  // Last emergency stop, held until update() can send its event. Latency runs
+  // from the last empty RX scan before the byte to the PWM cut.
+  bool estop_pending_ = false;
+  uint8_t estop_dropped_ = 0;
+  uint32_t estop_latency_us_ = 0;
+  uint32_t estop_max_latency_us_ = 0;
+  // Set by every emergency stop; move and route stay refused until the Pi
+  // sends estop_clear.
+  bool estop_latched_ = false;
+  // protocol_.emergencyStops() when the line being handled was read.
+  uint8_t line_estops_ = 0;
+
+  // Handlers are indexed by CommandId; arity is checked before they run.
+  typedef void (ArduinoBridge::*CommandHandler)(const CommandSpec &spec, const CommandArgs &args);
+  static const CommandHandler COMMAND_HANDLERS[COMMAND_COUNT];
+
+  // Main-loop tasks, indexed like TASKS in arduino_bridge.cpp.
+  static constexpr uint8_t TASK_COUNT = 7;
+  typedef void (ArduinoBridge::*TaskHandler)();
+  static const TaskHandler TASK_HANDLERS[TASK_COUNT];
+
+  void runMotionTask_();
+  void runRxTask_();
+  void runTxTask_();
+  void runSwitchTask_();
+  void runKeypadTask_();
+  void runLockTask_();
+  void runRfidTask_();
+  void lap_(ProfilePhase phase);
+  void pollEmergencyStop_(uint32_t nowUs);
+  void measureProfilerCost_();
+  bool lineInterrupted_() const { return protocol_.emergencyStops() != line_estops_; }
+
+  void handleCommand_(const LineView &line);
+  void handleJsonCommand_(const LineView &line);
+  void handleCompactCommand_(const LineView &line);
+  void handleBatch_(CompactSegment *segments, uint8_t count);
+  void dispatch_(const CommandSpec &spec, const CommandArgs &args);
+
+  void handlePing_(const CommandSpec &spec, const CommandArgs &args);
+  void handleGetState_(const CommandSpec &spec, const CommandArgs &args);
+  void handleRfidReset_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLcdClear_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLcdDemo_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLcdSetLine_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLcdSet_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLcdBacklight_(const CommandSpec &spec, const CommandArgs &args);
+  void handleServo_(const CommandSpec &spec, const CommandArgs &args);
+  void handleServoSetAngle_(const CommandSpec &spec, const CommandArgs &args);
+  bool refuseWhileEmergencyStop_();
+  bool refuseOverlongSteps_(const MotionStep *steps, uint8_t count);
+  void handleMove_(const CommandSpec &spec, const CommandArgs &args);
+  void handleStop_(const CommandSpec &spec, const CommandArgs &args);
+  void handleLinkMode_(const CommandSpec &spec, const CommandArgs &args);
+  void handleSetBaud_(const CommandSpec &spec, const CommandArgs &args);
+  void handleStats_(const CommandSpec &spec, const CommandArgs &args);
+  void handleProfile_(const CommandSpec &spec, const CommandArgs &args);
+  void handleRoute_(const CommandSpec &spec, const CommandArgs &args);
+  void addSuperseded_(FrameWriter &ack, const MotionSuperseded &superseded);
+  void handleCalibration_(const CommandSpec &spec, const CommandArgs &args);
+  void handleDriftTrim_(const CommandSpec &spec, const CommandArgs &args, MotionAction action);
+  void handlePose_(const CommandSpec &spec, const CommandArgs &args);
+  void handleEstopClear_(const CommandSpec &spec, const CommandArgs &args);
+  void addPose_(FrameWriter &frame, const PoseEstimate &pose);
+
+  void updateBaud_();
+  void switchBaud_(unsigned long baud);
+  bool drawLcdDemo_();
   void emitReady_();
   void emitState_();
   void emitKeypadEvents_();
   void emitSwitchEvents_();
   void emitRfidEvents_();
   void emitDriveEvents_();
+  void emitEmergencyStop_();
 };
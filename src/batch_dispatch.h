@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Status of a command that never ran because an emergency stop was read
+// after its line arrived.
+static constexpr const char *DROPPED_STATUS = "dropped";
+
+// Runs the sub-commands of an already checked batch in order: `dispatch(i)`
+// runs one and returns its status. `interrupted()` is asked before each one;
+// once it holds, the rest are not dispatched and are marked DROPPED_STATUS.
+// Returns how many were dispatched.
+template <typename Dispatch, typename Interrupted>
+uint8_t runBatch(uint8_t count, const char **statuses, Dispatch dispatch, Interrupted interrupted) {
+  uint8_t ran = 0;
+  while (ran < count && !interrupted()) {
+    statuses[ran] = dispatch(ran);
+    ran++;
+  }
+  for (uint8_t i = ran; i < count; i++) {
+    statuses[i] = DROPPED_STATUS;
+  }
+  return ran;
+}
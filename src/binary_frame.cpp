@@ -0,0 +1,222 @@
+#include "binary_frame.h"
+
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t *>(address))
+#endif
+
+using namespace binary_frame;
+
+namespace {
+// Keys and string values on the hot path, sorted by strcmp so a lookup is a
+// binary search. Anything else is sent as a literal. Ids are positions, so
+// inserting a symbol changes the ids after it: update pi/binary_codec.py
+// SYMBOLS and the golden frames in the same change.
+constexpr char SYMBOLS[][SYMBOL_WIDTH] PROGMEM = {
+    "ack", "action", "angle", "arduino_bridge", "available", "batch", "batch_count",
+    "binary", "box", "busy", "closed", "code", "command", "count", "crc_mismatch",
+    "current", "custom", "debug_compact_rx", "debug_move_request", "debug_rfid_read_failed",
+    "debug_rfid_recovered", "drive_action", "drive_busy", "duration_ms", "enabled", "error",
+    "event", "expected", "field_count", "firmware", "forward_cell", "get_state", "hold",
+    "idle", "index", "invalid", "invalid_action", "invalid_batch", "invalid_box",
+    "invalid_json", "invalid_mode", "json", "key", "key_event", "lcd_address",
+    "lcd_available", "lcd_backlight", "lcd_clear", "lcd_demo", "lcd_set", "lcd_set_line",
+    "lcd_write_failed", "line", "line_too_long", "link_mode", "locks", "message",
+    "missing_fields", "missing_opcode", "missing_type", "mode", "modes", "motion_done",
+    "move", "ok", "opcode", "open", "ping", "pressed", "raw", "ready", "released",
+    "reverse_cell", "rfid_reset", "rfid_scan", "rx_overflows", "seq", "servo_close",
+    "servo_open", "servo_set_angle", "state", "status", "stop", "switch_state", "switches",
+    "text", "turn_left", "turn_right", "tx_dropped", "tx_frame_overflow", "type", "uid",
+    "unknown", "unknown_command", "unknown_opcode", "unsupported_command",
+};
+
+constexpr uint8_t SYMBOL_COUNT = sizeof(SYMBOLS) / sizeof(SYMBOLS[0]);
+
+constexpr bool textLess(const char *a, const char *b) {
+  return *a == *b ? *a != '\0' && textLess(a + 1, b + 1)
+                  : static_cast<uint8_t>(*a) < static_cast<uint8_t>(*b);
+}
+
+constexpr bool symbolsSorted(uint8_t index = 1) {
+  return index >= SYMBOL_COUNT ||
+         (textLess(SYMBOLS[index - 1], SYMBOLS[index]) && symbolsSorted(index + 1));
+}
+
+static_assert(SYMBOL_COUNT < TAG_STRING, "Symbol ids must stay below the value tags");
+static_assert(symbolsSorted(), "SYMBOLS must be sorted and free of duplicates");
+
+// strcmp() of a bounded text against a PROGMEM symbol.
+int compareSymbol(const char *text, size_t length, uint8_t index) {
+  const char *symbol = SYMBOLS[index];
+  for (size_t i = 0; i < length; i++) {
+    const uint8_t expected = pgm_read_byte(symbol + i);
+    const uint8_t actual = static_cast<uint8_t>(text[i]);
+    if (actual != expected) {
+      return actual < expected ? -1 : 1;
+    }
+  }
+  return pgm_read_byte(symbol + length) == '\0' ? 0 : -1;
+}
+
+uint16_t crcUpdate(uint16_t crc, uint8_t data) {
+#if defined(__AVR__)
+  return _crc_xmodem_update(crc, data);
+#else
+  crc ^= static_cast<uint16_t>(data) << 8;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000) != 0 ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                              : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+#endif
+}
+}  // namespace
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc = crcUpdate(crc, data[i]);
+  }
+  return crc;
+}
+
+uint8_t binarySymbolCount() { return SYMBOL_COUNT; }
+
+uint8_t findBinarySymbol(const char *text, size_t length) {
+  if (length >= SYMBOL_WIDTH) {
+    return NO_SYMBOL;
+  }
+  uint8_t low = 0;
+  uint8_t high = SYMBOL_COUNT;
+  while (low < high) {
+    const uint8_t middle = static_cast<uint8_t>((low + high) / 2);
+    const int order = compareSymbol(text, length, middle);
+    if (order == 0) {
+      return middle;
+    }
+    if (order < 0) {
+      high = middle;
+    } else {
+      low = static_cast<uint8_t>(middle + 1);
+    }
+  }
+  return NO_SYMBOL;
+}
+
+size_t sealBinaryFrame(uint8_t *frame, size_t payloadLength) {
+  if (payloadLength > MAX_PAYLOAD) {
+    return 0;
+  }
+  const uint16_t crc = crc16Ccitt(frame + 1, payloadLength);
+  frame[payloadLength + 1] = static_cast<uint8_t>(crc >> 8);
+  frame[payloadLength + 2] = static_cast<uint8_t>(crc & 0xFF);
+
+  // In-place COBS: each zero is replaced by the distance to the next one, and
+  // frame[0] holds the distance to the first. The payload cap keeps every run
+  // below 255 bytes, so no extra code bytes are ever needed.
+  const size_t end = payloadLength + 3;
+  size_t code_at = 0;
+  for (size_t i = 1; i < end; i++) {
+    if (frame[i] == 0) {
+      frame[code_at] = static_cast<uint8_t>(i - code_at);
+      code_at = i;
+    }
+  }
+  frame[code_at] = static_cast<uint8_t>(end - code_at);
+  frame[end] = 0;
+  return end + 1;
+}
+
+FrameWriter &BinaryFrameWriter::beginObject() {
+  if (depth_ > 0) {
+    put_(static_cast<char>(TAG_OBJECT));
+  }
+  depth_++;
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::endObject() {
+  if (depth_ > 0) {
+    depth_--;
+  }
+  if (depth_ > 0) {
+    put_(static_cast<char>(TAG_END));
+  }
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::beginArray() {
+  put_(static_cast<char>(TAG_ARRAY));
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::endArray() {
+  put_(static_cast<char>(TAG_END));
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::key(const char *name) {
+  // The leading "type" key is implied: the first text of a frame is its type.
+  if (depth_ == 1 && used_ == 0 && strcmp(name, "type") == 0) {
+    return *this;
+  }
+  putText_(name, strlen(name));
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::value(const char *text) {
+  return value(text, text == nullptr ? 0 : strlen(text));
+}
+
+FrameWriter &BinaryFrameWriter::value(const char *text, size_t length) {
+  putText_(text, length);
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::value(bool flag) {
+  put_(static_cast<char>(flag ? TAG_TRUE : TAG_FALSE));
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::value(long number) {
+  put_(static_cast<char>(TAG_INT));
+  const unsigned long zigzag = number < 0 ? ~(static_cast<unsigned long>(number) << 1)
+                                          : static_cast<unsigned long>(number) << 1;
+  putVarint_(zigzag);
+  return *this;
+}
+
+FrameWriter &BinaryFrameWriter::value(unsigned long number) {
+  put_(static_cast<char>(TAG_UINT));
+  putVarint_(number);
+  return *this;
+}
+
+void BinaryFrameWriter::putText_(const char *text, size_t length) {
+  const uint8_t symbol = findBinarySymbol(text, length);
+  if (symbol != NO_SYMBOL) {
+    put_(static_cast<char>(symbol));
+    return;
+  }
+  if (length > 0xFF) {
+    overflowed_ = true;
+    return;
+  }
+  put_(static_cast<char>(TAG_STRING));
+  put_(static_cast<char>(length));
+  for (size_t i = 0; i < length; i++) {
+    put_(text[i]);
+  }
+}
+
+void BinaryFrameWriter::putVarint_(unsigned long number) {
+  while (number >= 0x80) {
+    put_(static_cast<char>((number & 0x7F) | 0x80));
+    number >>= 7;
+  }
+  put_(static_cast<char>(number));
+}
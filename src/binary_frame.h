@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_writer.h"
+
+// Binary link mode: every Arduino -> Pi message becomes one COBS-encoded frame
+// terminated by 0x00. Before COBS the frame is
+//
+//   <type text> <key text> <value> ... <crc16 hi> <crc16 lo>
+//
+// where a text is one symbol id (BINARY_SYMBOLS index) or TAG_STRING + length +
+// bytes, and a value is a text or one of the tags below. Integers are zigzag
+// (TAG_INT) or plain (TAG_UINT) LEB128 varints. Nested objects end with TAG_END
+// in key position, arrays with TAG_END in value position. pi/binary_codec.py
+// is the decoder; keep both symbol lists identical.
+namespace binary_frame {
+static constexpr uint8_t TAG_STRING = 0xF0;
+static constexpr uint8_t TAG_TRUE = 0xF1;
+static constexpr uint8_t TAG_FALSE = 0xF2;
+static constexpr uint8_t TAG_INT = 0xF3;
+static constexpr uint8_t TAG_UINT = 0xF4;
+static constexpr uint8_t TAG_ARRAY = 0xF5;
+static constexpr uint8_t TAG_OBJECT = 0xF6;
+static constexpr uint8_t TAG_END = 0xF7;
+
+// COBS adds one byte per 254 and the frame keeps a leading code byte and a
+// trailing 0x00; longer payloads are rejected by sealFrame().
+static constexpr size_t MAX_PAYLOAD = 250;
+static constexpr uint8_t SYMBOL_WIDTH = 24;
+static constexpr uint8_t NO_SYMBOL = 0xFF;
+}  // namespace binary_frame
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF): "123456789" -> 0x29B1.
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+// Index of `text` in the symbol table, or binary_frame::NO_SYMBOL.
+uint8_t findBinarySymbol(const char *text, size_t length);
+uint8_t binarySymbolCount();
+
+// `frame[1..payloadLength]` holds the payload; frame[0] is reserved for the
+// first COBS code byte. Appends the CRC, COBS-encodes in place and appends the
+// 0x00 delimiter. Returns the bytes to send, or 0 when the payload is too long.
+// `frame` needs payloadLength + 4 bytes.
+size_t sealBinaryFrame(uint8_t *frame, size_t payloadLength);
+
+class BinaryFrameWriter : public FrameWriter {
+ public:
+  using FrameWriter::beginArray;
+  using FrameWriter::value;
+
+  FrameWriter &beginObject() override;
+  FrameWriter &endObject() override;
+  FrameWriter &beginArray() override;
+  FrameWriter &endArray() override;
+  FrameWriter &key(const char *name) override;
+
+  FrameWriter &value(const char *text) override;
+  FrameWriter &value(const char *text, size_t length) override;
+  FrameWriter &value(bool flag) override;
+  FrameWriter &value(long number) override;
+  FrameWriter &value(unsigned long number) override;
+
+ private:
+  uint8_t depth_ = 0;
+
+  void restart_() override { depth_ = 0; }
+  void putText_(const char *text, size_t length);
+  void putVarint_(unsigned long number);
+};
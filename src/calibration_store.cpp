@@ -0,0 +1,21 @@
+#include "calibration_store.h"
+
+#include <EEPROM.h>
+
+#include "runtime_config.h"
+
+bool CalibrationStore::load(MotionCalibration &calibration) {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  for (size_t i = 0; i < sizeof(block); i++) {
+    block[i] = EEPROM.read(CALIBRATION_EEPROM_ADDRESS + i);
+  }
+  return decodeCalibration(block, sizeof(block), calibration);
+}
+
+void CalibrationStore::save(const MotionCalibration &calibration) {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  const size_t length = encodeCalibration(calibration, block);
+  for (size_t i = 0; i < length; i++) {
+    EEPROM.update(CALIBRATION_EEPROM_ADDRESS + i, block[i]);
+  }
+}
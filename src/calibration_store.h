@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "motion_calibration.h"
+
+// EEPROM home of the motion calibration block.
+class CalibrationStore {
+ public:
+  // Leaves `calibration` as it is when EEPROM holds no valid block.
+  static bool load(MotionCalibration &calibration);
+  // Rewrites only the bytes that changed; each costs ~3.4 ms of EEPROM time.
+  static void save(const MotionCalibration &calibration);
+};
@@ -0,0 +1,156 @@
+#include "command_catalog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t *>(address))
+#define memcpy_P memcpy
+#endif
+
+namespace {
+constexpr uint8_t NO_COMMAND = 0xFF;
+
+constexpr CommandSpec COMMANDS[] PROGMEM = {
+    {CommandId::Ping, 'P', "ping", 0, 0, {}},
+    {CommandId::GetState, 'G', "get_state", 0, 0, {}},
+    {CommandId::RfidReset, 'R', "rfid_reset", 0, 0, {}},
+    {CommandId::LcdClear, 'C', "lcd_clear", 0, 0, {}},
+    {CommandId::LcdDemo, 'D', "lcd_demo", 0, 0, {}},
+    {CommandId::LcdSetLine, 'L', "lcd_set_line", 2, 2, {"line", "text"}},
+    {CommandId::LcdSet, '\0', "lcd_set", 0, 0, {}},
+    {CommandId::LcdBacklight, '\0', "lcd_backlight", 1, 1, {"enabled"}},
+    {CommandId::ServoOpen, 'O', "servo_open", 1, 1, {"box"}},
+    {CommandId::ServoClose, 'X', "servo_close", 1, 1, {"box"}},
+    {CommandId::ServoSetAngle, 'A', "servo_set_angle", 2, 2, {"box", "angle"}},
+    {CommandId::Move, 'M', "move", 1, 3, {"action", "duration_ms", "replace"}},
+    {CommandId::Stop, 'T', "stop", 0, 0, {}},
+    {CommandId::LinkMode, 'Y', "link_mode", 1, 1, {"mode"}},
+    {CommandId::SetBaud, 'U', "set_baud", 1, 1, {"baud"}},
+    {CommandId::Stats, 'S', "stats", 0, 1, {"task"}},
+    {CommandId::Profile, 'F', "profile", 0, 2, {"phase", "reset"}},
+    {CommandId::Route, 'Q', "route", 1, 2, {"steps", "replace"}},
+    {CommandId::Calibration, 'K', "calibration", 0, 3, {"key", "value", "run_mm"}},
+    {CommandId::Pose, 'W', "pose", 0, 3, {"x", "y", "heading"}},
+    {CommandId::EstopClear, 'E', "estop_clear", 0, 0, {}},
+};
+
+constexpr size_t nameLength(const char *name) { return *name == '\0' ? 0 : 1 + nameLength(name + 1); }
+
+constexpr uint8_t nameSlot(uint8_t index) {
+  return commandNameSlot(COMMANDS[index].name, nameLength(COMMANDS[index].name));
+}
+
+constexpr uint8_t commandForOpcode(char opcode, uint8_t index = 0) {
+  return index >= COMMAND_COUNT              ? NO_COMMAND
+         : COMMANDS[index].opcode == opcode ? index
+                                            : commandForOpcode(opcode, index + 1);
+}
+
+constexpr uint8_t commandForSlot(uint8_t slot, uint8_t index = 0) {
+  return index >= COMMAND_COUNT     ? NO_COMMAND
+         : nameSlot(index) == slot ? index
+                                   : commandForSlot(slot, index + 1);
+}
+
+constexpr bool slotsUnique(uint8_t i = 0, uint8_t j = 1) {
+  return i >= COMMAND_COUNT   ? true
+         : j >= COMMAND_COUNT ? slotsUnique(i + 1, i + 2)
+                              : nameSlot(i) != nameSlot(j) && slotsUnique(i, j + 1);
+}
+
+constexpr bool opcodesUnique(uint8_t i = 0, uint8_t j = 1) {
+  return i >= COMMAND_COUNT   ? true
+         : j >= COMMAND_COUNT ? opcodesUnique(i + 1, i + 2)
+                              : (COMMANDS[i].opcode == '\0' ||
+                                 COMMANDS[i].opcode != COMMANDS[j].opcode) &&
+                                    opcodesUnique(i, j + 1);
+}
+
+constexpr bool listedInIdOrder(uint8_t index = 0) {
+  return index >= COMMAND_COUNT ||
+         (static_cast<uint8_t>(COMMANDS[index].id) == index && listedInIdOrder(index + 1));
+}
+
+constexpr size_t longestName(uint8_t index = 0, size_t longest = 0) {
+  return index >= COMMAND_COUNT
+             ? longest
+             : longestName(index + 1, nameLength(COMMANDS[index].name) > longest
+                                          ? nameLength(COMMANDS[index].name)
+                                          : longest);
+}
+
+static_assert(sizeof(COMMANDS) / sizeof(COMMANDS[0]) == COMMAND_COUNT,
+              "COMMANDS needs one entry per CommandId");
+static_assert(listedInIdOrder(), "COMMANDS must be listed in CommandId order");
+static_assert(opcodesUnique(), "Two commands share a compact opcode");
+static_assert(slotsUnique(), "Command names collide in the hash table; change COMMAND_HASH_SEED");
+
+constexpr size_t LONGEST_NAME = longestName();
+
+const uint8_t OPCODE_TABLE[26] PROGMEM = {
+    commandForOpcode('A'), commandForOpcode('B'), commandForOpcode('C'), commandForOpcode('D'), commandForOpcode('E'), commandForOpcode('F'),
+    commandForOpcode('G'), commandForOpcode('H'), commandForOpcode('I'), commandForOpcode('J'), commandForOpcode('K'), commandForOpcode('L'),
+    commandForOpcode('M'), commandForOpcode('N'), commandForOpcode('O'), commandForOpcode('P'), commandForOpcode('Q'), commandForOpcode('R'),
+    commandForOpcode('S'), commandForOpcode('T'), commandForOpcode('U'), commandForOpcode('V'), commandForOpcode('W'), commandForOpcode('X'),
+    commandForOpcode('Y'), commandForOpcode('Z'),
+};
+
+const uint8_t NAME_TABLE[COMMAND_HASH_SLOTS] PROGMEM = {
+    commandForSlot(0), commandForSlot(1), commandForSlot(2), commandForSlot(3),
+    commandForSlot(4), commandForSlot(5), commandForSlot(6), commandForSlot(7),
+    commandForSlot(8), commandForSlot(9), commandForSlot(10), commandForSlot(11),
+    commandForSlot(12), commandForSlot(13), commandForSlot(14), commandForSlot(15),
+    commandForSlot(16), commandForSlot(17), commandForSlot(18), commandForSlot(19),
+    commandForSlot(20), commandForSlot(21), commandForSlot(22), commandForSlot(23),
+    commandForSlot(24), commandForSlot(25), commandForSlot(26), commandForSlot(27),
+    commandForSlot(28), commandForSlot(29), commandForSlot(30), commandForSlot(31),
+};
+}  // namespace
+
+long CommandArgs::integer(uint8_t index) const { return atol(fields[index].data); }
+
+bool CommandArgs::flag(uint8_t index) const {
+  return strcmp(fields[index].data, "true") == 0 || strcmp(fields[index].data, "1") == 0;
+}
+
+uint8_t collectJsonArgs(const JsonFieldIndex &json, const CommandSpec &spec,
+                        CompactField *fieldsOut) {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < spec.maxArgs; i++) {
+    if (json.getScalar(spec.keys[i], fieldsOut[i].data, fieldsOut[i].length)) {
+      count = i + 1;
+    } else {
+      fieldsOut[i] = CompactField{nullptr, 0};
+    }
+  }
+  return count;
+}
+
+bool findCommandByOpcode(char opcode, CommandSpec &specOut) {
+  if (opcode < 'A' || opcode > 'Z') {
+    return false;
+  }
+  const uint8_t index = pgm_read_byte(&OPCODE_TABLE[opcode - 'A']);
+  if (index == NO_COMMAND) {
+    return false;
+  }
+  memcpy_P(&specOut, &COMMANDS[index], sizeof(specOut));
+  return true;
+}
+
+bool findCommandByName(const char *name, size_t length, CommandSpec &specOut) {
+  if (length == 0 || length > LONGEST_NAME) {
+    return false;
+  }
+  const uint8_t index =
+      pgm_read_byte(&NAME_TABLE[commandNameSlot(name, length)]);
+  if (index == NO_COMMAND) {
+    return false;
+  }
+  memcpy_P(&specOut, &COMMANDS[index], sizeof(specOut));
+  return strncmp(specOut.name, name, length) == 0 && specOut.name[length] == '\0';
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "compact_fields.h"
+#include "json_fields.h"
+
+// Every command the bridge understands, in dispatch-table order.
+enum class CommandId : uint8_t {
+  Ping,
+  GetState,
+  RfidReset,
+  LcdClear,
+  LcdDemo,
+  LcdSetLine,
+  LcdSet,
+  LcdBacklight,
+  ServoOpen,
+  ServoClose,
+  ServoSetAngle,
+  Move,
+  Stop,
+  LinkMode,
+  SetBaud,
+  Stats,
+  Profile,
+  Route,
+  Calibration,
+  Pose,
+  EstopClear,
+  Count,
+};
+
+static constexpr uint8_t COMMAND_COUNT = static_cast<uint8_t>(CommandId::Count);
+static constexpr uint8_t COMMAND_MAX_ARGS = 3;
+
+// Static description of one command. Arguments are positional: compact
+// commands carry them as `|` fields after the opcode, JSON commands under
+// `keys[i]`. Only the first `minArgs` are required.
+struct CommandSpec {
+  CommandId id;
+  char opcode;
+  const char *name;
+  uint8_t minArgs;
+  uint8_t maxArgs;
+  const char *keys[COMMAND_MAX_ARGS];
+};
+
+// Positional arguments as NUL-terminated text tokens, whatever wire format
+// they arrived in. A slot below `count` can still be absent (data nullptr)
+// when a JSON command omits a key before a later one; check has() first.
+struct CommandArgs {
+  const CompactField *fields;
+  uint8_t count;
+
+  bool has(uint8_t index) const { return index < count && fields[index].data != nullptr; }
+
+  const char *text(uint8_t index) const { return fields[index].data; }
+  size_t length(uint8_t index) const { return fields[index].length; }
+  long integer(uint8_t index) const;
+  bool flag(uint8_t index) const;
+};
+
+// Looks up every `spec.keys[i]` on its own, so an omitted key never shifts
+// the ones after it; absent slots are {nullptr, 0}. Returns one past the last
+// present slot, the `count` for CommandArgs.
+uint8_t collectJsonArgs(const JsonFieldIndex &json, const CommandSpec &spec,
+                        CompactField *fieldsOut);
+
+// O(1) lookup by compact opcode byte.
+bool findCommandByOpcode(char opcode, CommandSpec &specOut);
+// O(1) lookup by JSON type name: one perfect-hash probe plus one compare.
+bool findCommandByName(const char *name, size_t length, CommandSpec &specOut);
+
+// FNV-1a with a seed chosen so the command names land in distinct slots.
+// command_catalog.cpp static_asserts that; pick a new seed if it fires.
+static constexpr uint32_t COMMAND_HASH_SEED = 0x811CB312UL;
+static constexpr uint8_t COMMAND_HASH_SLOTS = 32;
+
+constexpr uint32_t commandNameHash(const char *name, size_t length,
+                                   uint32_t hash = COMMAND_HASH_SEED) {
+  return length == 0 ? hash
+                     : commandNameHash(name + 1, length - 1,
+                                       (hash ^ static_cast<uint8_t>(*name)) * 16777619UL);
+}
+
+// The low bits of FNV-1a only depend on the low bits of the seed, so the high
+// half is folded in before taking the slot; otherwise few seeds are distinct.
+constexpr uint8_t commandNameSlot(const char *name, size_t length,
+                                  uint32_t hash = 0, bool hashed = false) {
+  return hashed ? static_cast<uint8_t>((hash ^ (hash >> 16)) % COMMAND_HASH_SLOTS)
+                : commandNameSlot(name, length, commandNameHash(name, length), true);
+}
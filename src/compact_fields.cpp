@@ -0,0 +1,108 @@
+#include "compact_fields.h"
+
+uint8_t splitCompactFields(char *line, size_t length, CompactField *fields, uint8_t maxFields) {
+  uint8_t count = 0;
+  size_t fieldStart = 0;
+  size_t out = 0;
+  bool escaped = false;
+
+  for (size_t in = 0; in < length; in++) {
+    const char ch = line[in];
+    if (escaped) {
+      switch (ch) {
+        case 'n':
+          line[out++] = '\n';
+          break;
+        case 'r':
+          line[out++] = '\r';
+          break;
+        default:
+          line[out++] = ch;
+          break;
+      }
+      escaped = false;
+      continue;
+    }
+    if (ch == '\\') {
+      escaped = true;
+      continue;
+    }
+    if (ch == '|') {
+      if (count < maxFields) {
+        fields[count].data = line + fieldStart;
+        fields[count].length = out - fieldStart;
+        count++;
+      }
+      line[out++] = '\0';
+      fieldStart = out;
+      continue;
+    }
+    line[out++] = ch;
+  }
+
+  line[out] = '\0';
+  if (count < maxFields) {
+    fields[count].data = line + fieldStart;
+    fields[count].length = out - fieldStart;
+    count++;
+  }
+  return count;
+}
+
+uint8_t splitCompactBatch(char *line, size_t length, CompactSegment *segments,
+                          uint8_t maxSegments) {
+  uint8_t count = 0;
+  size_t segmentStart = 0;
+  bool escaped = false;
+
+  for (size_t i = 0; i <= length; i++) {
+    if (i < length) {
+      if (escaped) {
+        escaped = false;
+        continue;
+      }
+      if (line[i] == '\\') {
+        escaped = true;
+        continue;
+      }
+      if (line[i] != BATCH_SEPARATOR) {
+        continue;
+      }
+    }
+    // A separator, or the end of the line.
+    line[i] = '\0';
+    if (count < maxSegments) {
+      segments[count].data = line + segmentStart;
+      segments[count].length = i - segmentStart;
+    }
+    if (count < 0xFF) {
+      count++;
+    }
+    segmentStart = i + 1;
+  }
+  return count;
+}
+
+char compactOpcode(const CompactField &field, int32_t &sequenceOut) {
+  sequenceOut = NO_SEQUENCE;
+  if (field.length == 1) {
+    return field.data[0];
+  }
+  if (field.length < 3 || field.data[1] != '#') {
+    return '\0';
+  }
+
+  int32_t sequence = 0;
+  for (size_t i = 2; i < field.length; i++) {
+    const char digit = field.data[i];
+    if (digit < '0' || digit > '9') {
+      return '\0';
+    }
+    sequence = sequence * 10 + (digit - '0');
+    if (sequence > MAX_SEQUENCE) {
+      return '\0';
+    }
+  }
+  sequenceOut = sequence;
+  return field.data[0];
+}
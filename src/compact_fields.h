@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One `|`-separated field of a compact command. `data` points into the
+// original line buffer, is already unescaped and is NUL-terminated.
+struct CompactField {
+  const char *data;
+  size_t length;
+};
+
+// Splits `line` (without the leading '@') in place: escapes are resolved by
+// shifting bytes left and every separator is overwritten with '\0'. Fields
+// beyond `maxFields` are ignored. Returns the number of fields written.
+uint8_t splitCompactFields(char *line, size_t length, CompactField *fields, uint8_t maxFields);
+
+// One `;`-separated sub-command of a batch line. Escapes are left in place
+// for splitCompactFields(); `data` is writable and NUL-terminated.
+struct CompactSegment {
+  char *data;
+  size_t length;
+};
+
+static constexpr char BATCH_OPCODE = 'B';
+static constexpr char BATCH_SEPARATOR = ';';
+
+// Splits a batch line (`B[#seq];X|..;Y|..`, without the leading '@') on
+// unescaped ';' by overwriting each separator with '\0'. Returns the total
+// number of segments, which may exceed `maxSegments`; only that many are
+// written to `segments`.
+uint8_t splitCompactBatch(char *line, size_t length, CompactSegment *segments,
+                          uint8_t maxSegments);
+
+static constexpr int32_t NO_SEQUENCE = -1;
+static constexpr int32_t MAX_SEQUENCE = 0xFFFF;
+
+// Returns the opcode held by `field`, written either as `X` or as `X#<seq>`
+// with a decimal sequence id up to MAX_SEQUENCE, or '\0' if the field is
+// malformed. `sequenceOut` receives the id, or NO_SEQUENCE if there is none.
+char compactOpcode(const CompactField &field, int32_t &sequenceOut);
@@ -1,112 +1,483 @@
 #include "drive_controller.h"
 
+#include <util/atomic.h>
+
+#include "calibration_store.h"
+#include "motion_timer.h"
 #include "runtime_config.h"
 
+namespace {
+// value * by / div in 64 bits; step distances in pose units reach 2e7.
+uint32_t scaleWide(uint32_t value, uint32_t by, uint32_t div) {
+  return static_cast<uint32_t>(static_cast<uint64_t>(value) * by / div);
+}
+
+uint16_t readSupplyAdc() { return static_cast<uint16_t>(analogRead(SUPPLY_SENSE_PIN)); }
+
+constexpr EncoderLoopConfig encoderConfig(const MotionCalibration &calibration) {
+  return EncoderLoopConfig{calibration.encoderKp, calibration.encoderKi, ENCODER_PERIOD_MS,
+                           ENCODER_STALL_MS, ENCODER_MAX_CORRECTION_PERMILLE};
+}
+
+constexpr SupplyConfig SUPPLY_CONFIG = {
+    SUPPLY_ADC_FULL_SCALE_MV,  SUPPLY_DIVIDER_PERMILLE,   SUPPLY_MIN_VALID_MV,
+    SUPPLY_MIN_SCALE_PERMILLE, SUPPLY_MAX_SCALE_PERMILLE, SUPPLY_SAMPLE_PERIOD_MS,
+    SUPPLY_FILTER_SHIFT,
+};
+}  // namespace
+
+MotionCalibration DriveController::defaultCalibration() {
+  return MotionCalibration{MOTION_FORWARD_CELL_MS,
+                           MOTION_REVERSE_CELL_MS,
+                           MOTION_TURN_LEFT_MS,
+                           MOTION_TURN_RIGHT_MS,
+                           MOTOR_FORWARD_PWM,
+                           MOTOR_TURN_PWM,
+                           static_cast<uint8_t>(MOTION_RAMP_PROFILE),
+                           MOTION_RAMP_MS,
+                           {{MOTOR_LEFT_TRIM_PERMILLE, MOTOR_RIGHT_TRIM_PERMILLE},
+                            {MOTOR_LEFT_TRIM_PERMILLE, MOTOR_RIGHT_TRIM_PERMILLE},
+                            {MOTOR_LEFT_TRIM_PERMILLE, MOTOR_RIGHT_TRIM_PERMILLE},
+                            {MOTOR_LEFT_TRIM_PERMILLE, MOTOR_RIGHT_TRIM_PERMILLE}},
+                           MOTION_ARC_LEFT_MS,
+                           MOTION_ARC_RIGHT_MS,
+                           MOTOR_ARC_PWM,
+                           MOTION_ARC_INNER_PERMILLE,
+                           SUPPLY_NOMINAL_MV,
+                           ENCODER_TICKS_PER_CELL,
+                           ENCODER_TICKS_PER_TURN,
+                           ENCODER_TICKS_PER_ARC,
+                           ENCODER_KP_PERMILLE,
+                           ENCODER_KI_PERMILLE};
+}
+
 void DriveController::begin() {
+  calibration_ = defaultCalibration();
+  calibration_loaded_ = CalibrationStore::load(calibration_);
   pinMode(MOTOR_RIGHT_DIR_PIN, OUTPUT);
   pinMode(MOTOR_RIGHT_PWM_PIN, OUTPUT);
   pinMode(MOTOR_LEFT_DIR_PIN, OUTPUT);
   pinMode(MOTOR_LEFT_PWM_PIN, OUTPUT);
+  MotionTimer::begin();
+  WheelEncoders::begin();
+  supply_.begin(SUPPLY_CONFIG, readSupplyAdc);
   stop();
 }
 
 void DriveController::update() {
+  if (supply_.update(millis())) {
+    supply_scale_ = supply_.scalePermille(calibration_.supplyNominalMv);
+  }
   if (current_action_ == MotionAction::Idle) {
     return;
   }
 
-  if ((long)(millis() - action_ends_at_ms_) >= 0) {
-    completed_action_ = actionName_(current_action_);
-    stop();
+  const uint32_t now = micros();
+  if (MotionTimer::fired()) {
+    // The timer interrupt already cut the motors; this only reports it.
+    finishStep_(MotionTimer::firedAtUs());
+  } else if (encoder_step_) {
+    updateEncoderStep_(now);
+  } else if (chains_out_ && static_cast<int32_t>(now - action_deadline_us_) >= 0) {
+    finishStep_(now);
+  } else {
+    applyRamp_(now);
   }
 }
 
-void DriveController::stop() {
-  analogWrite(MOTOR_RIGHT_PWM_PIN, 0);
-  analogWrite(MOTOR_LEFT_PWM_PIN, 0);
+uint8_t DriveController::stop() {
+  // Both read before cutMotors_(), which clears the fired flags.
+  const bool ranOut = MotionTimer::alarmFired();
+  if (busy()) {
+    integratePose_(MotionTimer::fired() ? MotionTimer::firedAtUs() : micros());
+  }
+  cutMotors_();
+  const uint8_t dropped = busy() ? stoppedRouteDropped(route_length_, route_next_, ranOut) : 0;
   current_action_ = MotionAction::Idle;
-  action_ends_at_ms_ = 0;
+  encoder_step_ = false;
+  chains_out_ = false;
+  route_length_ = 0;
+  route_next_ = 0;
+  return dropped;
 }
 
-bool DriveController::startAction(const String &action, unsigned long durationOverrideMs) {
-  if (busy()) {
+bool DriveController::startAction(const char *action, unsigned long durationOverrideMs,
+                                  MotionSuperseded *supersededOut) {
+  if (busy() && supersededOut == nullptr) {
     return false;
   }
 
-  if (action == "forward_cell") {
-    applyMotion_(MOTOR_RIGHT_FORWARD_DIR, MOTOR_FORWARD_PWM, MOTOR_LEFT_FORWARD_DIR, MOTOR_FORWARD_PWM);
-    startTimedAction_(MotionAction::ForwardCell,
-                      durationOverrideMs > 0 ? durationOverrideMs : MOTION_FORWARD_CELL_MS);
+  if (strcmp(action, "stop") == 0) {
+    if (supersededOut != nullptr) {
+      // A replacing stop cuts the running step; report it like supersede_().
+      supersededOut->action = busy() ? motionActionName(current_action_) : nullptr;
+      const uint32_t now = micros();
+      supersededOut->executedMs = (now - step_started_us_) / 1000UL;
+      supersededOut->plannedMs = (action_deadline_us_ - step_started_us_) / 1000UL;
+    }
+    const uint8_t dropped = stop();
+    if (supersededOut != nullptr) {
+      supersededOut->dropped = dropped;
+    }
+    completed_ = {"stop", 0, 0, 0, 0, pose_.pose()};
     return true;
   }
 
-  if (action == "reverse_cell") {
-    applyMotion_(MOTOR_RIGHT_REVERSE_DIR, MOTOR_FORWARD_PWM, MOTOR_LEFT_REVERSE_DIR, MOTOR_FORWARD_PWM);
-    startTimedAction_(MotionAction::ReverseCell,
-                      durationOverrideMs > 0 ? durationOverrideMs : MOTION_REVERSE_CELL_MS);
-    return true;
+  MotionStep step;
+  uint8_t errorIndex = 0;
+  if (parseRoute(action, strlen(action), &step, 1, errorIndex) == ROUTE_INVALID) {
+    return false;
   }
+  if (durationOverrideMs > 0) {
+    step.durationMs = durationOverrideMs;
+  }
+  return startRoute(&step, 1, supersededOut);
+}
 
-  if (action == "turn_left") {
-    applyMotion_(MOTOR_RIGHT_FORWARD_DIR, MOTOR_TURN_PWM, MOTOR_LEFT_REVERSE_DIR, MOTOR_TURN_PWM);
-    startTimedAction_(MotionAction::TurnLeft,
-                      durationOverrideMs > 0 ? durationOverrideMs : MOTION_TURN_LEFT_MS);
-    return true;
+bool DriveController::startRoute(const MotionStep *steps, uint8_t count,
+                                 MotionSuperseded *supersededOut) {
+  if (count == 0 || count > MOTION_QUEUE_CAPACITY) {
+    return false;
+  }
+  bool atSpeed = false;
+  if (supersededOut != nullptr) {
+    atSpeed = supersede_(steps[0].action, *supersededOut);
+  } else if (busy()) {
+    return false;
   }
+  if (!atSpeed && (supersededOut == nullptr || supersededOut->action == nullptr)) {
+    // A route from rest gives stalled encoders another chance.
+    encoder_fault_ = false;
+  }
+  memcpy(route_, steps, count * sizeof(MotionStep));
+  route_length_ = count;
+  route_next_ = 1;
+  startStep_(route_[0], atSpeed);
+  return true;
+}
 
-  if (action == "turn_right") {
-    applyMotion_(MOTOR_RIGHT_REVERSE_DIR, MOTOR_TURN_PWM, MOTOR_LEFT_FORWARD_DIR, MOTOR_TURN_PWM);
-    startTimedAction_(MotionAction::TurnRight,
-                      durationOverrideMs > 0 ? durationOverrideMs : MOTION_TURN_RIGHT_MS);
-    return true;
+bool DriveController::busy() const { return current_action_ != MotionAction::Idle; }
+
+bool DriveController::consumeCompletedAction(MotionDone &doneOut) {
+  if (completed_.action == nullptr) {
+    return false;
   }
+  doneOut = completed_;
+  completed_.action = nullptr;
+  return true;
+}
+
+const char *DriveController::currentAction() const { return motionActionName(current_action_); }
 
-  if (action == "stop") {
-    stop();
-    completed_action_ = "stop";
+void DriveController::cutMotors_() {
+  MotionTimer::disarm();
+  analogWrite(MOTOR_RIGHT_PWM_PIN, 0);
+  analogWrite(MOTOR_LEFT_PWM_PIN, 0);
+  applied_ = WheelPwm{0, 0};
+}
+
+bool DriveController::supersede_(MotionAction next, MotionSuperseded &supersededOut) {
+  supersededOut.action = nullptr;
+  if (busy() && MotionTimer::fired()) {
+    // The step already ended; report it normally, the route may go on.
+    finishStep_(MotionTimer::firedAtUs());
+  }
+  if (!busy()) {
+    return false;
+  }
+  const uint32_t now = micros();
+  supersededOut.action = motionActionName(current_action_);
+  supersededOut.executedMs = (now - step_started_us_) / 1000UL;
+  supersededOut.plannedMs = (action_deadline_us_ - step_started_us_) / 1000UL;
+  supersededOut.dropped = route_length_ - route_next_ + 1;
+  integratePose_(now);
+  if (runsOnAtSpeed(current_action_, next)) {
+    MotionTimer::disarm();
+    // startStep_ carries a chained step on from the previous deadline; for a
+    // replacement that is now.
+    action_deadline_us_ = now;
     return true;
   }
-
+  cutMotors_();
+  current_action_ = MotionAction::Idle;
   return false;
 }
 
-bool DriveController::busy() const { return current_action_ != MotionAction::Idle; }
+RampProfile DriveController::rampProfile_() const {
+  return static_cast<RampProfile>(calibration_.rampProfile);
+}
 
-bool DriveController::consumeCompletedAction(String &actionOut) {
-  if (completed_action_.length() == 0) {
-    return false;
+uint32_t DriveController::nominalMs_(MotionAction action) const {
+  switch (action) {
+    case MotionAction::ForwardCell:
+      return calibration_.forwardCellMs;
+    case MotionAction::ReverseCell:
+      return calibration_.reverseCellMs;
+    case MotionAction::TurnLeft:
+      return calibration_.turnLeftMs;
+    case MotionAction::TurnRight:
+      return calibration_.turnRightMs;
+    case MotionAction::ArcLeft:
+      return calibration_.arcLeftMs;
+    case MotionAction::ArcRight:
+      return calibration_.arcRightMs;
+    case MotionAction::Idle:
+    default:
+      return 0;
   }
-  actionOut = completed_action_;
-  completed_action_ = "";
-  return true;
 }
 
-const char *DriveController::currentAction() const { return actionName_(current_action_); }
+uint32_t DriveController::segmentMs_(const MotionStep &step) const {
+  // A segment of n cells is one timed move: n times the cell timing, ramped
+  // only at its ends.
+  return step.durationMs > 0 ? step.durationMs : nominalMs_(step.action) * step.cells;
+}
 
-void DriveController::applyMotion_(bool rightDir, uint8_t rightPwm, bool leftDir, uint8_t leftPwm) {
-  digitalWrite(MOTOR_RIGHT_DIR_PIN, rightDir);
-  analogWrite(MOTOR_RIGHT_PWM_PIN, rightPwm);
-  digitalWrite(MOTOR_LEFT_DIR_PIN, leftDir);
-  analogWrite(MOTOR_LEFT_PWM_PIN, leftPwm);
+uint8_t DriveController::firstOverlongStep(const MotionStep *steps, uint8_t count) const {
+  for (uint8_t i = 0; i < count; i++) {
+    if (segmentMs_(steps[i]) > MAX_STEP_MS) {
+      return i;
+    }
+  }
+  return count;
+}
+
+void DriveController::startStep_(const MotionStep &step, bool chainedIn) {
+  bool rightDir;
+  bool leftDir;
+  switch (step.action) {
+    case MotionAction::ForwardCell:
+      rightDir = MOTOR_RIGHT_FORWARD_DIR;
+      leftDir = MOTOR_LEFT_FORWARD_DIR;
+      target_pwm_ = calibration_.forwardPwm;
+      break;
+    case MotionAction::ReverseCell:
+      rightDir = MOTOR_RIGHT_REVERSE_DIR;
+      leftDir = MOTOR_LEFT_REVERSE_DIR;
+      target_pwm_ = calibration_.forwardPwm;
+      break;
+    case MotionAction::TurnLeft:
+      rightDir = MOTOR_RIGHT_FORWARD_DIR;
+      leftDir = MOTOR_LEFT_REVERSE_DIR;
+      target_pwm_ = calibration_.turnPwm;
+      break;
+    case MotionAction::TurnRight:
+      rightDir = MOTOR_RIGHT_REVERSE_DIR;
+      leftDir = MOTOR_LEFT_FORWARD_DIR;
+      target_pwm_ = calibration_.turnPwm;
+      break;
+    case MotionAction::ArcLeft:
+    case MotionAction::ArcRight:
+      rightDir = MOTOR_RIGHT_FORWARD_DIR;
+      leftDir = MOTOR_LEFT_FORWARD_DIR;
+      target_pwm_ = calibration_.arcPwm;
+      break;
+    case MotionAction::Idle:
+    default:
+      return;
+  }
+
+  chains_out_ =
+      route_next_ < route_length_ && runsOnAtSpeed(step.action, route_[route_next_].action);
+  // Routes are checked with firstOverlongStep(), but the calibration may have
+  // changed since; the clamp keeps the deadline arithmetic in range.
+  uint32_t segmentMs = segmentMs_(step);
+  if (segmentMs > MAX_STEP_MS) {
+    segmentMs = MAX_STEP_MS;
+  }
+  const uint32_t nominalMs = nominalMs_(step.action);
+  const RampPlan plan =
+      planRampedStep(segmentMs, rampProfile_(), calibration_.rampMs, !chainedIn, !chains_out_);
+  ramp_up_us_ = plan.rampUpMs * 1000UL;
+  ramp_down_us_ = plan.rampDownMs * 1000UL;
+  // The calibrated time per cell or quarter turn converts time into distance
+  // or angle, so overridden durations count for what they drove.
+  step_milli_units_ = nominalMs > 0 ? scaleWide(segmentMs, 1000, nominalMs) : 0;
+  step_planned_ms_ = plan.durationMs;
+  uint32_t leftTicks = 0;
+  uint32_t rightTicks = 0;
+  encoder_step_ = encoderTargets_(step.action, leftTicks, rightTicks);
+  current_action_ = step.action;
+  current_cells_ = step.cells;
+
+  if (chainedIn) {
+    // Carry on from the previous deadline so chained steps do not drift.
+    step_started_us_ = action_deadline_us_;
+  } else {
+    digitalWrite(MOTOR_RIGHT_DIR_PIN, rightDir);
+    digitalWrite(MOTOR_LEFT_DIR_PIN, leftDir);
+    WheelEncoders::setDirection(leftDir == MOTOR_LEFT_FORWARD_DIR,
+                                rightDir == MOTOR_RIGHT_FORWARD_DIR);
+    step_started_us_ = micros();
+  }
+  action_deadline_us_ = step_started_us_ + plan.durationMs * 1000UL;
+  if (encoder_step_) {
+    int32_t left;
+    int32_t right;
+    WheelEncoders::read(left, right);
+    encoder_loop_.begin(encoderConfig(calibration_), leftTicks, rightTicks, left, right, millis());
+  }
+
+  const uint32_t now = micros();
+  if (!chains_out_) {
+    // On encoders the timer only backs up the count: it cuts the step once it
+    // overruns its timed duration by ENCODER_TIMEOUT_PERMILLE.
+    const uint32_t graceUs =
+        encoder_step_ ? plan.durationMs * (ENCODER_TIMEOUT_PERMILLE - 1000UL) : 0;
+    const int32_t leftUs = static_cast<int32_t>(action_deadline_us_ + graceUs - now);
+    MotionTimer::arm(leftUs > 0 ? static_cast<uint32_t>(leftUs) : 0);
+  }
+  applyRamp_(now);
+}
+
+void DriveController::finishStep_(uint32_t endedAtUs) {
+  integratePose_(endedAtUs);
+  completed_.action = motionActionName(current_action_);
+  completed_.overshootUs = static_cast<int32_t>(endedAtUs - action_deadline_us_);
+  completed_.cells = current_cells_;
+  completed_.step = route_next_ - 1;
+  completed_.remaining = route_length_ - route_next_;
+  completed_.pose = pose_.pose();
+  if (encoder_step_) {
+    // A chained step carries on from where this one actually ended.
+    action_deadline_us_ = endedAtUs;
+    encoder_step_ = false;
+  }
+  const bool chained = chains_out_;
+  MotionTimer::disarm();
+  current_action_ = MotionAction::Idle;
+  chains_out_ = false;
+  if (!chained) {
+    applied_ = WheelPwm{0, 0};
+  }
+  if (route_next_ < route_length_) {
+    startStep_(route_[route_next_++], chained);
+  }
 }
 
-void DriveController::startTimedAction_(MotionAction action, unsigned long durationMs) {
-  current_action_ = action;
-  action_ends_at_ms_ = millis() + durationMs;
+void DriveController::integratePose_(uint32_t endedAtUs) {
+  // A finished step counts in full. For a cut one the share of the planned
+  // time that ran stands in for the share of the distance, which ignores
+  // where the ramps fall.
+  const uint32_t ranMs = static_cast<int32_t>(endedAtUs - step_started_us_) > 0
+                             ? (endedAtUs - step_started_us_) / 1000UL
+                             : 0;
+  uint32_t progress = 1000;
+  if (encoder_step_) {
+    progress = encoder_loop_.progressPermille();
+  } else if (step_planned_ms_ > 0 && ranMs < step_planned_ms_) {
+    progress = ranMs * 1000UL / step_planned_ms_;
+  }
+  pose_.integrate(current_action_, scaleWide(step_milli_units_, progress, 1000));
 }
 
-const char *DriveController::actionName_(MotionAction action) const {
+bool DriveController::encoderTargets_(MotionAction action, uint32_t &leftOut,
+                                      uint32_t &rightOut) const {
+  if (ENCODER_MODE == EncoderMode::None || encoder_fault_) {
+    return false;
+  }
+  uint16_t ticksPerUnit;
   switch (action) {
     case MotionAction::ForwardCell:
-      return "forward_cell";
     case MotionAction::ReverseCell:
-      return "reverse_cell";
+      ticksPerUnit = calibration_.encoderTicksCell;
+      break;
     case MotionAction::TurnLeft:
-      return "turn_left";
     case MotionAction::TurnRight:
-      return "turn_right";
+      ticksPerUnit = calibration_.encoderTicksTurn;
+      break;
+    case MotionAction::ArcLeft:
+    case MotionAction::ArcRight:
+      ticksPerUnit = calibration_.encoderTicksArc;
+      break;
     case MotionAction::Idle:
     default:
-      return "idle";
+      return false;
+  }
+  // Same units as the pose: thousandths of a cell or quarter turn.
+  const uint32_t ticks = scaleWide(step_milli_units_, ticksPerUnit, 1000);
+  if (ticks == 0) {
+    return false;
+  }
+  leftOut = ticks;
+  rightOut = ticks;
+  if (action == MotionAction::ArcLeft) {
+    leftOut = scaleWide(ticks, calibration_.arcInnerPermille, 1000);
+  } else if (action == MotionAction::ArcRight) {
+    rightOut = scaleWide(ticks, calibration_.arcInnerPermille, 1000);
+  }
+  return true;
+}
+
+void DriveController::updateEncoderStep_(uint32_t nowUs) {
+  int32_t left;
+  int32_t right;
+  WheelEncoders::read(left, right);
+  const EncoderStatus status = encoder_loop_.update(millis(), left, right);
+  if (status == EncoderStatus::Reached) {
+    if (!chains_out_) {
+      cutMotors_();
+    }
+    finishStep_(nowUs);
+    return;
+  }
+  const int32_t overrunUs = static_cast<int32_t>(nowUs - action_deadline_us_);
+  if (status == EncoderStatus::Stalled ||
+      overrunUs > static_cast<int32_t>(step_planned_ms_ * (ENCODER_TIMEOUT_PERMILLE - 1000UL))) {
+    fallBackToTimed_(nowUs);
+  }
+  applyRamp_(nowUs);
+}
+
+void DriveController::fallBackToTimed_(uint32_t nowUs) {
+  encoder_step_ = false;
+  encoder_fault_ = true;
+  encoder_fallbacks_++;
+  if (!chains_out_) {
+    const int32_t leftUs = static_cast<int32_t>(action_deadline_us_ - nowUs);
+    MotionTimer::arm(leftUs > 0 ? static_cast<uint32_t>(leftUs) : 0);
+  }
+}
+
+void DriveController::applyRamp_(uint32_t nowUs) {
+  const uint32_t elapsedUs = nowUs - step_started_us_;
+  uint8_t pwm = rampPwm(rampProfile_(), elapsedUs, ramp_up_us_, target_pwm_);
+  if (ramp_down_us_ > 0) {
+    uint8_t down;
+    if (encoder_step_) {
+      // The ramp-down follows the distance left, at the planned pace, and
+      // keeps enough PWM for the last ticks to come.
+      uint32_t leftMs = step_planned_ms_ * (1000UL - encoder_loop_.progressPermille()) / 1000UL;
+      leftMs = leftMs < RAMP_MAX_US / 1000UL ? leftMs : RAMP_MAX_US / 1000UL;
+      down = rampPwm(rampProfile_(), leftMs * 1000UL, ramp_down_us_, target_pwm_);
+      const uint8_t floor = ENCODER_MIN_PWM < target_pwm_ ? ENCODER_MIN_PWM : target_pwm_;
+      down = down > floor ? down : floor;
+    } else {
+      const int32_t leftUs = static_cast<int32_t>(action_deadline_us_ - nowUs);
+      down = rampPwm(rampProfile_(), leftUs > 0 ? static_cast<uint32_t>(leftUs) : 0,
+                     ramp_down_us_, target_pwm_);
+    }
+    pwm = down < pwm ? down : pwm;
+  }
+  writePwm_(pwm);
+}
+
+void DriveController::writePwm_(uint8_t pwm) {
+  // The ramp is shared and scaled for the supply voltage; each wheel then gets
+  // its own trim for this action and, on encoders, its PI correction.
+  WheelPwm wheels = trimWheelPwm(calibration_, current_action_, scalePwm(pwm, supply_scale_));
+  if (encoder_step_) {
+    wheels = encoder_loop_.apply(wheels);
+  }
+  if (wheels.left == applied_.left && wheels.right == applied_.right) {
+    return;
+  }
+  // The cut-off interrupt must win: never re-enable outputs it has zeroed.
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (!MotionTimer::fired()) {
+      analogWrite(MOTOR_RIGHT_PWM_PIN, wheels.right);
+      analogWrite(MOTOR_LEFT_PWM_PIN, wheels.left);
+      applied_ = wheels;
+    }
   }
 }
@@ -2,25 +2,126 @@
 
 #include <Arduino.h>
 
+#include "encoder_control.h"
+#include "motion_calibration.h"
+#include "motion_ramp.h"
+#include "motion_route.h"
+#include "motion_trim.h"
+#include "pose_estimator.h"
+#include "supply_monitor.h"
+#include "wheel_encoders.h"
+
+// One finished step, as reported in motion_done.
+struct MotionDone {
+  const char *action;
+  // How long after its deadline the step actually stopped, or for a step that
+  // runs on into the next one, how late the boundary was noticed.
+  int32_t overshootUs;
+  uint8_t cells;
+  uint8_t step;
+  // Steps of the same route still to run.
+  uint8_t remaining;
+  // Dead-reckoned pose once the step ended.
+  PoseEstimate pose;
+};
+
+// The step a replacing move or route cut short.
+struct MotionSuperseded {
+  // nullptr when the drive was idle and nothing was replaced.
+  const char *action;
+  uint32_t executedMs;
+  uint32_t plannedMs;
+  // Steps, the cut one included, that will not complete.
+  uint8_t dropped;
+};
+
 class DriveController {
  public:
   void begin();
   void update();
-  void stop();
+  // Cuts the motors at once and drops the rest of the route; returns how many
+  // steps, the running one included, will not complete.
+  uint8_t stop();
 
-  bool startAction(const String &action, unsigned long durationOverrideMs = 0);
+  // `action` is one route step, e.g. "forward_cell" or "forward_n*5".
+  bool startAction(const char *action, unsigned long durationOverrideMs = 0,
+                   MotionSuperseded *supersededOut = nullptr);
+  // Runs `count` steps back to back. Without `supersededOut` this fails while
+  // busy; with it, the new steps replace the running route at once and the
+  // step they cut short is described there. A replacement that starts with
+  // the running action carries on at speed; any other one stops the wheels
+  // before changing direction and ramps up from zero.
+  bool startRoute(const MotionStep *steps, uint8_t count,
+                  MotionSuperseded *supersededOut = nullptr);
+  // Index of the first step longer than MAX_STEP_MS with the current
+  // calibration, or `count` when they all fit.
+  uint8_t firstOverlongStep(const MotionStep *steps, uint8_t count) const;
   bool busy() const;
-  bool consumeCompletedAction(String &actionOut);
+  bool consumeCompletedAction(MotionDone &doneOut);
   const char *currentAction() const;
 
- private:
-  enum class MotionAction : uint8_t { Idle, ForwardCell, ReverseCell, TurnLeft, TurnRight };
+  static MotionCalibration defaultCalibration();
+  // Changes apply from the next step on.
+  MotionCalibration &calibration() { return calibration_; }
+  // Whether begin() found a valid block in EEPROM.
+  bool calibrationLoaded() const { return calibration_loaded_; }
+  uint16_t supplyMillivolts() const { return supply_.millivolts(); }
+  // Factor, in permille, currently applied to every PWM value.
+  uint16_t supplyScalePermille() const { return supply_scale_; }
+  // Dead-reckoned from the steps executed so far, cut ones included, using the
+  // calibration they ran with.
+  const PoseEstimate &pose() const { return pose_.pose(); }
+  void setPose(int32_t x, int32_t y, uint16_t heading) { pose_.reset(x, y, heading); }
+  void encoderTicks(int32_t &left, int32_t &right) const { WheelEncoders::read(left, right); }
+  // Whether the running step ends on its encoder count.
+  bool encoderStep() const { return encoder_step_; }
+  // Steps that finished on time because their encoders stopped counting.
+  uint16_t encoderFallbacks() const { return encoder_fallbacks_; }
 
+ private:
+  MotionCalibration calibration_;
+  bool calibration_loaded_ = false;
+  SupplyMonitor supply_;
+  uint16_t supply_scale_ = 1000;
+  PoseEstimator pose_;
+  // Distance or angle of the running step in pose units (see integrate()) and
+  // the time planned for it.
+  uint32_t step_milli_units_ = 0;
+  uint32_t step_planned_ms_ = 0;
+  EncoderLoop encoder_loop_;
+  bool encoder_step_ = false;
+  // Set when a step's encoders stall; the rest of that route runs timed.
+  bool encoder_fault_ = false;
+  uint16_t encoder_fallbacks_ = 0;
   MotionAction current_action_ = MotionAction::Idle;
-  String completed_action_;
-  unsigned long action_ends_at_ms_ = 0;
+  MotionDone completed_ = {nullptr, 0, 0, 0, 0, {0, 0, 0, 0, 0}};
+  uint32_t step_started_us_ = 0;
+  uint32_t action_deadline_us_ = 0;
+  uint32_t ramp_up_us_ = 0;
+  uint32_t ramp_down_us_ = 0;
+  uint8_t current_cells_ = 0;
+  uint8_t target_pwm_ = 0;
+  WheelPwm applied_ = {0, 0};
+  // The next step takes over at speed (runsOnAtSpeed), so this one is neither
+  // ramped down nor cut off by the timer.
+  bool chains_out_ = false;
+
+  MotionStep route_[MOTION_QUEUE_CAPACITY];
+  uint8_t route_length_ = 0;
+  // Index of the step after the running one.
+  uint8_t route_next_ = 0;
 
-  void applyMotion_(bool rightDir, uint8_t rightPwm, bool leftDir, uint8_t leftPwm);
-  void startTimedAction_(MotionAction action, unsigned long durationMs);
-  const char *actionName_(MotionAction action) const;
+  RampProfile rampProfile_() const;
+  uint32_t nominalMs_(MotionAction action) const;
+  uint32_t segmentMs_(const MotionStep &step) const;
+  void cutMotors_();
+  bool supersede_(MotionAction next, MotionSuperseded &supersededOut);
+  void startStep_(const MotionStep &step, bool chainedIn);
+  void finishStep_(uint32_t endedAtUs);
+  void integratePose_(uint32_t endedAtUs);
+  bool encoderTargets_(MotionAction action, uint32_t &leftOut, uint32_t &rightOut) const;
+  void updateEncoderStep_(uint32_t nowUs);
+  void fallBackToTimed_(uint32_t nowUs);
+  void applyRamp_(uint32_t nowUs);
+  void writePwm_(uint8_t pwm);
 };
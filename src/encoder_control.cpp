@@ -0,0 +1,117 @@
+#include "encoder_control.h"
+
+namespace {
+// A wheel is compared with the other down to a tenth of its distance; below
+// that (a near-pivot arc) it is driven but not tracked.
+constexpr uint32_t MAX_WEIGHT = 10000;
+constexpr int32_t TERM_LIMIT = 10000;
+
+uint32_t distance(int32_t from, int32_t to) {
+  const int32_t delta = to - from;
+  return static_cast<uint32_t>(delta < 0 ? -delta : delta);
+}
+
+int32_t clampTerm(int32_t value, int32_t limit) {
+  return value > limit ? limit : value < -limit ? -limit : value;
+}
+
+// ticks * weight / 1000 without overflowing for any 32-bit tick count.
+uint32_t scaleTicks(uint32_t ticks, uint32_t weight) {
+  return (ticks / 1000UL) * weight + (ticks % 1000UL) * weight / 1000UL;
+}
+
+uint8_t correctPwm(uint8_t pwm, int16_t correction) {
+  const uint32_t scaled = (static_cast<uint32_t>(pwm) * (1000 + correction) + 500) / 1000;
+  return static_cast<uint8_t>(scaled > 255 ? 255 : scaled);
+}
+}  // namespace
+
+void EncoderLoop::begin(const EncoderLoopConfig &config, uint32_t leftTarget,
+                        uint32_t rightTarget, int32_t leftStart, int32_t rightStart,
+                        uint32_t nowMs) {
+  config_ = config;
+  if (config_.periodMs == 0) {
+    config_.periodMs = 1;
+  }
+  target_ = leftTarget > rightTarget ? leftTarget : rightTarget;
+  const uint32_t targets[2] = {leftTarget, rightTarget};
+  for (uint8_t i = 0; i < 2; i++) {
+    // target_ stays below 4.29 million ticks, so the product fits.
+    weight_[i] = targets[i] > 0 ? target_ * 1000UL / targets[i] : 0;
+    if (weight_[i] > MAX_WEIGHT) {
+      weight_[i] = 0;
+    }
+    travelled_[i] = 0;
+    last_travelled_[i] = 0;
+    last_tick_ms_[i] = nowMs;
+    correction_[i] = 0;
+  }
+  start_[0] = leftStart;
+  start_[1] = rightStart;
+  last_period_ms_ = nowMs;
+}
+
+EncoderStatus EncoderLoop::update(uint32_t nowMs, int32_t leftTicks, int32_t rightTicks) {
+  const int32_t ticks[2] = {leftTicks, rightTicks};
+  for (uint8_t i = 0; i < 2; i++) {
+    const uint32_t travelled = scaleTicks(distance(start_[i], ticks[i]), weight_[i]);
+    if (travelled != travelled_[i]) {
+      travelled_[i] = travelled;
+      last_tick_ms_[i] = nowMs;
+    }
+  }
+  if (meanTravelled_() >= target_) {
+    return EncoderStatus::Reached;
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    if (weight_[i] > 0 && nowMs - last_tick_ms_[i] >= config_.stallMs) {
+      return EncoderStatus::Stalled;
+    }
+  }
+  if (nowMs - last_period_ms_ < config_.periodMs) {
+    return EncoderStatus::Running;
+  }
+  last_period_ms_ = nowMs;
+  if (weight_[0] == 0 || weight_[1] == 0) {
+    return EncoderStatus::Running;
+  }
+
+  int32_t speed[2];
+  for (uint8_t i = 0; i < 2; i++) {
+    speed[i] = static_cast<int32_t>(travelled_[i] - last_travelled_[i]);
+    last_travelled_[i] = travelled_[i];
+  }
+  const int32_t meanSpeed = (speed[0] + speed[1]) / 2;
+  const int32_t mean = static_cast<int32_t>(meanTravelled_());
+  for (uint8_t i = 0; i < 2; i++) {
+    // Bounded before the gains so the products fit in 32 bits.
+    const int32_t speedError = clampTerm(meanSpeed - speed[i], TERM_LIMIT);
+    const int32_t lag = clampTerm(mean - static_cast<int32_t>(travelled_[i]), TERM_LIMIT);
+    correction_[i] = static_cast<int16_t>(
+        clampTerm(speedError * config_.kpPermille + lag * config_.kiPermille,
+                  config_.maxCorrectionPermille));
+  }
+  return EncoderStatus::Running;
+}
+
+WheelPwm EncoderLoop::apply(WheelPwm pwm) const {
+  return WheelPwm{correctPwm(pwm.left, correction_[static_cast<uint8_t>(Wheel::Left)]),
+                  correctPwm(pwm.right, correction_[static_cast<uint8_t>(Wheel::Right)])};
+}
+
+uint16_t EncoderLoop::progressPermille() const {
+  if (target_ == 0) {
+    return 1000;
+  }
+  const uint32_t mean = meanTravelled_();
+  // Capped first; with target_ below 4.29 million the product fits.
+  return static_cast<uint16_t>((mean < target_ ? mean : target_) * 1000UL / target_);
+}
+
+uint32_t EncoderLoop::meanTravelled_() const {
+  // A wheel without a target (weight 0) does not count.
+  if (weight_[0] == 0 || weight_[1] == 0) {
+    return travelled_[0] + travelled_[1];
+  }
+  return (travelled_[0] + travelled_[1]) / 2;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "motion_trim.h"
+
+enum class EncoderMode : uint8_t { None, SingleChannel, Quadrature };
+
+// What one channel-A interrupt adds to a wheel's count. Quadrature: on either
+// edge of A the wheel turns forward when B differs from A (A leads B), so the
+// count follows the wheel whatever the motors were told. Single channel: each
+// rising edge counts in the direction the wheel was driven.
+inline int8_t quadratureStep(bool a, bool b) { return a != b ? 1 : -1; }
+inline int8_t singleChannelStep(bool forward) { return forward ? 1 : -1; }
+
+struct EncoderLoopConfig {
+  // Correction, in permille of PWM, per tick per period of speed error and
+  // per tick of accumulated lag behind the other wheel.
+  uint16_t kpPermille;
+  uint16_t kiPermille;
+  uint16_t periodMs;
+  // A wheel with no tick for this long while driven counts as stalled.
+  uint16_t stallMs;
+  uint16_t maxCorrectionPermille;
+};
+
+enum class EncoderStatus : uint8_t { Running, Reached, Stalled };
+
+// Ends a step on distance and keeps the wheels together. Each wheel has a PI
+// loop on its speed, in ticks per period, against the mean of both: the P
+// term reacts to the last period, the I term (the summed speed error, which
+// is exactly how far the wheel lags the mean) removes the offset. Targets may
+// differ per wheel, as on an arc; speeds are then compared in proportion.
+class EncoderLoop {
+ public:
+  // `*Target` is how far each wheel must turn, in ticks; `*Start` are the raw
+  // counts the step begins from.
+  void begin(const EncoderLoopConfig &config, uint32_t leftTarget, uint32_t rightTarget,
+             int32_t leftStart, int32_t rightStart, uint32_t nowMs);
+  // Feed raw counts as often as possible; the PI step runs once per period.
+  EncoderStatus update(uint32_t nowMs, int32_t leftTicks, int32_t rightTicks);
+  // Applies the per-wheel corrections to the trimmed PWM.
+  WheelPwm apply(WheelPwm pwm) const;
+  // Mean distance covered, in permille of the target; capped at 1000.
+  uint16_t progressPermille() const;
+  int16_t correctionPermille(Wheel wheel) const {
+    return correction_[static_cast<uint8_t>(wheel)];
+  }
+
+ private:
+  EncoderLoopConfig config_ = {0, 0, 1, 0, 0};
+  // The larger target; each wheel's travel is scaled to it by weight_.
+  uint32_t target_ = 0;
+  uint32_t weight_[2] = {1000, 1000};
+  int32_t start_[2] = {0, 0};
+  uint32_t travelled_[2] = {0, 0};
+  uint32_t last_travelled_[2] = {0, 0};
+  uint32_t last_tick_ms_[2] = {0, 0};
+  uint32_t last_period_ms_ = 0;
+  int16_t correction_[2] = {0, 0};
+
+  uint32_t meanTravelled_() const;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Output side of SerialProtocol. The same begin/key/value calls produce a JSON
+// line (JsonWriter) or a compact binary frame (BinaryFrameWriter) straight
+// into a caller-owned buffer; running out of space only sets overflowed().
+class FrameWriter {
+ public:
+  void reset(char *buffer, size_t capacity);
+
+  virtual FrameWriter &beginObject() = 0;
+  virtual FrameWriter &endObject() = 0;
+  virtual FrameWriter &beginArray() = 0;
+  virtual FrameWriter &endArray() = 0;
+  virtual FrameWriter &key(const char *name) = 0;
+
+  virtual FrameWriter &value(const char *text) = 0;
+  virtual FrameWriter &value(const char *text, size_t length) = 0;
+  virtual FrameWriter &value(bool flag) = 0;
+  virtual FrameWriter &value(long number) = 0;
+  virtual FrameWriter &value(unsigned long number) = 0;
+  FrameWriter &value(char ch) { return value(&ch, 1); }
+  FrameWriter &value(int number) { return value(static_cast<long>(number)); }
+  FrameWriter &value(unsigned int number) { return value(static_cast<unsigned long>(number)); }
+
+  template <typename T>
+  FrameWriter &field(const char *name, T fieldValue) {
+    return key(name).value(fieldValue);
+  }
+  FrameWriter &field(const char *name, const char *text, size_t length) {
+    return key(name).value(text, length);
+  }
+  FrameWriter &beginArray(const char *name) { return key(name).beginArray(); }
+
+  const char *data() const { return buffer_; }
+  size_t length() const { return used_; }
+  bool overflowed() const { return overflowed_; }
+
+ protected:
+  char *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  bool overflowed_ = false;
+
+  virtual void restart_() {}
+  void put_(char ch);
+  void putRaw_(const char *text);
+};
@@ -0,0 +1,296 @@
+#include "json_fields.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+int8_t hexValue(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return static_cast<int8_t>(ch - '0');
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return static_cast<int8_t>(ch - 'a' + 10);
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return static_cast<int8_t>(ch - 'A' + 10);
+  }
+  return -1;
+}
+
+// A six-byte \uXXXX escape always shrinks to at most three UTF-8 bytes, so
+// decoding in place never overtakes the read position. NUL and lone
+// surrogates become '?'.
+char *appendUtf8(char *out, uint16_t codepoint) {
+  if (codepoint == 0 || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+    *out++ = '?';
+  } else if (codepoint < 0x80) {
+    *out++ = static_cast<char>(codepoint);
+  } else if (codepoint < 0x800) {
+    *out++ = static_cast<char>(0xC0 | (codepoint >> 6));
+    *out++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+  } else {
+    *out++ = static_cast<char>(0xE0 | (codepoint >> 12));
+    *out++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+  }
+  return out;
+}
+
+bool isScalar(JsonKind kind) {
+  return kind == JsonKind::String || kind == JsonKind::Number || kind == JsonKind::Bool;
+}
+}  // namespace
+
+bool JsonFieldIndex::parse(char *line, size_t length) {
+  line_ = line;
+  length_ = length;
+  pos_ = 0;
+  count_ = 0;
+
+  skipSpace_();
+  if (peek_() != '{') {
+    return false;
+  }
+  pos_++;
+  skipSpace_();
+  if (peek_() == '}') {
+    pos_++;
+  } else {
+    while (true) {
+      JsonField field;
+      size_t keyLength = 0;
+      skipSpace_();
+      if (peek_() != '"' || !readString_(field.key, keyLength)) {
+        return false;
+      }
+      skipSpace_();
+      if (peek_() != ':') {
+        return false;
+      }
+      pos_++;
+      skipSpace_();
+      if (!readValue_(field)) {
+        return false;
+      }
+
+      const size_t valueEnd = pos_;
+      skipSpace_();
+      const char delimiter = peek_();
+      if (delimiter != ',' && delimiter != '}') {
+        return false;
+      }
+      pos_++;
+      // Strings were terminated over their closing quote; everything else
+      // is terminated now that the delimiter has been read.
+      if (field.kind != JsonKind::String) {
+        line_[valueEnd] = '\0';
+      }
+      if (count_ < MAX_FIELDS) {
+        fields_[count_++] = field;
+      }
+      if (delimiter == '}') {
+        break;
+      }
+    }
+  }
+
+  skipSpace_();
+  return pos_ >= length_;
+}
+
+const JsonField *JsonFieldIndex::find(const char *key) const {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (strcmp(fields_[i].key, key) == 0) {
+      return &fields_[i];
+    }
+  }
+  return nullptr;
+}
+
+bool JsonFieldIndex::getString(const char *key, const char *&textOut, size_t &lengthOut) const {
+  const JsonField *field = find(key);
+  if (field == nullptr || field->kind != JsonKind::String) {
+    return false;
+  }
+  textOut = field->value;
+  lengthOut = field->length;
+  return true;
+}
+
+bool JsonFieldIndex::getScalar(const char *key, const char *&textOut, size_t &lengthOut) const {
+  const JsonField *field = find(key);
+  if (field == nullptr || !isScalar(field->kind)) {
+    return false;
+  }
+  textOut = field->value;
+  lengthOut = field->length;
+  return true;
+}
+
+bool JsonFieldIndex::getInt(const char *key, long &valueOut) const {
+  const JsonField *field = find(key);
+  if (field == nullptr || field->kind != JsonKind::Number) {
+    return false;
+  }
+  char *end = nullptr;
+  const long value = strtol(field->value, &end, 10);
+  if (*end != '\0') {
+    return false;
+  }
+  valueOut = value;
+  return true;
+}
+
+bool JsonFieldIndex::getBool(const char *key, bool &valueOut) const {
+  const JsonField *field = find(key);
+  if (field == nullptr || field->kind != JsonKind::Bool) {
+    return false;
+  }
+  valueOut = field->value[0] == 't';
+  return true;
+}
+
+void JsonFieldIndex::skipSpace_() {
+  while (pos_ < length_) {
+    const char ch = line_[pos_];
+    if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') {
+      return;
+    }
+    pos_++;
+  }
+}
+
+bool JsonFieldIndex::readString_(const char *&textOut, size_t &lengthOut) {
+  pos_++;
+  char *const start = line_ + pos_;
+  char *out = start;
+  while (pos_ < length_) {
+    char ch = line_[pos_++];
+    if (ch == '"') {
+      *out = '\0';
+      textOut = start;
+      lengthOut = static_cast<size_t>(out - start);
+      return true;
+    }
+    if (ch != '\\') {
+      *out++ = ch;
+      continue;
+    }
+    if (pos_ >= length_) {
+      return false;
+    }
+    ch = line_[pos_++];
+    switch (ch) {
+      case '"':
+      case '\\':
+      case '/':
+        *out++ = ch;
+        break;
+      case 'n':
+        *out++ = '\n';
+        break;
+      case 'r':
+        *out++ = '\r';
+        break;
+      case 't':
+        *out++ = '\t';
+        break;
+      case 'b':
+        *out++ = '\b';
+        break;
+      case 'f':
+        *out++ = '\f';
+        break;
+      case 'u': {
+        if (pos_ + 4 > length_) {
+          return false;
+        }
+        uint16_t codepoint = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+          const int8_t digit = hexValue(line_[pos_++]);
+          if (digit < 0) {
+            return false;
+          }
+          codepoint = static_cast<uint16_t>((codepoint << 4) | digit);
+        }
+        out = appendUtf8(out, codepoint);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
+bool JsonFieldIndex::readValue_(JsonField &field) {
+  const char ch = peek_();
+  field.value = line_ + pos_;
+  if (ch == '"') {
+    field.kind = JsonKind::String;
+    return readString_(field.value, field.length);
+  }
+
+  const size_t start = pos_;
+  bool ok = false;
+  if (ch == '{' || ch == '[') {
+    field.kind = ch == '{' ? JsonKind::Object : JsonKind::Array;
+    ok = skipContainer_();
+  } else if (ch == 't' || ch == 'f') {
+    field.kind = JsonKind::Bool;
+    ok = skipLiteral_(ch == 't' ? "true" : "false");
+  } else if (ch == 'n') {
+    field.kind = JsonKind::Null;
+    ok = skipLiteral_("null");
+  } else if (ch == '-' || (ch >= '0' && ch <= '9')) {
+    field.kind = JsonKind::Number;
+    while (pos_ < length_) {
+      const char digit = line_[pos_];
+      if (!((digit >= '0' && digit <= '9') || digit == '-' || digit == '+' || digit == '.' ||
+            digit == 'e' || digit == 'E')) {
+        break;
+      }
+      pos_++;
+    }
+    ok = true;
+  }
+  field.length = pos_ - start;
+  return ok;
+}
+
+bool JsonFieldIndex::skipContainer_() {
+  uint8_t depth = 0;
+  bool inString = false;
+  while (pos_ < length_) {
+    const char ch = line_[pos_++];
+    if (inString) {
+      if (ch == '\\') {
+        pos_++;
+      } else if (ch == '"') {
+        inString = false;
+      }
+      continue;
+    }
+    if (ch == '"') {
+      inString = true;
+    } else if (ch == '{' || ch == '[') {
+      if (++depth == 0) {
+        return false;
+      }
+    } else if (ch == '}' || ch == ']') {
+      if (--depth == 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool JsonFieldIndex::skipLiteral_(const char *literal) {
+  const size_t literalLength = strlen(literal);
+  if (pos_ + literalLength > length_ || strncmp(line_ + pos_, literal, literalLength) != 0) {
+    return false;
+  }
+  pos_ += literalLength;
+  return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum class JsonKind : uint8_t { String, Number, Bool, Null, Array, Object };
+
+// One top-level member of a JSON command object. Both pointers reference the
+// original line buffer and are NUL-terminated. String values (and keys) are
+// already unescaped; every other kind is left as its raw JSON text.
+struct JsonField {
+  const char *key;
+  const char *value;
+  size_t length;
+  JsonKind kind;
+};
+
+// Tokenizes one JSON object in a single pass over a writable line and keeps a
+// fixed-size index of its top-level members. Nested arrays and objects are
+// indexed as a single raw value, so keys inside them (or inside string values)
+// never shadow a top-level key. The index borrows the line buffer.
+class JsonFieldIndex {
+ public:
+  static constexpr uint8_t MAX_FIELDS = 8;
+
+  // Returns false if `line` is not a single well-formed object. Members past
+  // MAX_FIELDS are validated but not indexed.
+  bool parse(char *line, size_t length);
+
+  uint8_t count() const { return count_; }
+  const JsonField &field(uint8_t index) const { return fields_[index]; }
+  // First member named `key`, or nullptr.
+  const JsonField *find(const char *key) const;
+
+  bool getString(const char *key, const char *&textOut, size_t &lengthOut) const;
+  // Any string, number or bool value as text.
+  bool getScalar(const char *key, const char *&textOut, size_t &lengthOut) const;
+  bool getInt(const char *key, long &valueOut) const;
+  bool getBool(const char *key, bool &valueOut) const;
+
+ private:
+  JsonField fields_[MAX_FIELDS];
+  uint8_t count_ = 0;
+  char *line_ = nullptr;
+  size_t length_ = 0;
+  size_t pos_ = 0;
+
+  char peek_() const { return pos_ < length_ ? line_[pos_] : '\0'; }
+  void skipSpace_();
+  bool readString_(const char *&textOut, size_t &lengthOut);
+  bool readValue_(JsonField &field);
+  bool skipContainer_();
+  bool skipLiteral_(const char *literal);
+};
@@ -0,0 +1,158 @@
+#include "json_writer.h"
+
+void FrameWriter::reset(char *buffer, size_t capacity) {
+  buffer_ = buffer;
+  capacity_ = capacity;
+  used_ = 0;
+  overflowed_ = false;
+  restart_();
+}
+
+void FrameWriter::put_(char ch) {
+  if (used_ >= capacity_) {
+    overflowed_ = true;
+    return;
+  }
+  buffer_[used_++] = ch;
+}
+
+void FrameWriter::putRaw_(const char *text) {
+  while (*text != '\0') {
+    put_(*text++);
+  }
+}
+
+FrameWriter &JsonWriter::beginObject() {
+  separate_();
+  put_('{');
+  needs_comma_ = false;
+  return *this;
+}
+
+FrameWriter &JsonWriter::endObject() {
+  put_('}');
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::beginArray() {
+  separate_();
+  put_('[');
+  needs_comma_ = false;
+  return *this;
+}
+
+FrameWriter &JsonWriter::endArray() {
+  put_(']');
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::key(const char *name) {
+  separate_();
+  put_('"');
+  putEscaped_(name, 0, false);
+  put_('"');
+  put_(':');
+  needs_comma_ = false;
+  return *this;
+}
+
+FrameWriter &JsonWriter::value(const char *text) {
+  separate_();
+  put_('"');
+  if (text != nullptr) {
+    putEscaped_(text, 0, false);
+  }
+  put_('"');
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::value(const char *text, size_t length) {
+  separate_();
+  put_('"');
+  putEscaped_(text, length, true);
+  put_('"');
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::value(bool flag) {
+  separate_();
+  putRaw_(flag ? "true" : "false");
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::value(long number) {
+  separate_();
+  if (number < 0) {
+    put_('-');
+    putUnsigned_(0UL - static_cast<unsigned long>(number));
+  } else {
+    putUnsigned_(static_cast<unsigned long>(number));
+  }
+  needs_comma_ = true;
+  return *this;
+}
+
+FrameWriter &JsonWriter::value(unsigned long number) {
+  separate_();
+  putUnsigned_(number);
+  needs_comma_ = true;
+  return *this;
+}
+
+void JsonWriter::separate_() {
+  if (needs_comma_) {
+    put_(',');
+  }
+}
+
+void JsonWriter::putEscaped_(const char *text, size_t length, bool bounded) {
+  for (size_t i = 0; bounded ? i < length : text[i] != '\0'; i++) {
+    const char ch = text[i];
+    switch (ch) {
+      case '"':
+      case '\\':
+        put_('\\');
+        put_(ch);
+        break;
+      case '\n':
+        put_('\\');
+        put_('n');
+        break;
+      case '\r':
+        put_('\\');
+        put_('r');
+        break;
+      case '\t':
+        put_('\\');
+        put_('t');
+        break;
+      default:
+        if (static_cast<uint8_t>(ch) < 0x20) {
+          static const char kHex[] = "0123456789abcdef";
+          putRaw_("\\u00");
+          put_(kHex[(ch >> 4) & 0x0F]);
+          put_(kHex[ch & 0x0F]);
+        } else {
+          put_(ch);
+        }
+        break;
+    }
+  }
+}
+
+void JsonWriter::putUnsigned_(unsigned long number) {
+  char digits[20];
+  uint8_t count = 0;
+  do {
+    digits[count++] = static_cast<char>('0' + number % 10);
+    number /= 10;
+  } while (number > 0);
+  while (count > 0) {
+    put_(digits[--count]);
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_writer.h"
+
+// Streaming JSON encoder. Keeps no heap state: commas are tracked with one
+// flag and strings are escaped while they are copied.
+class JsonWriter : public FrameWriter {
+ public:
+  using FrameWriter::beginArray;
+  using FrameWriter::value;
+
+  FrameWriter &beginObject() override;
+  FrameWriter &endObject() override;
+  FrameWriter &beginArray() override;
+  FrameWriter &endArray() override;
+  FrameWriter &key(const char *name) override;
+
+  FrameWriter &value(const char *text) override;
+  FrameWriter &value(const char *text, size_t length) override;
+  FrameWriter &value(bool flag) override;
+  FrameWriter &value(long number) override;
+  FrameWriter &value(unsigned long number) override;
+
+ private:
+  bool needs_comma_ = false;
+
+  void restart_() override { needs_comma_ = false; }
+  void separate_();
+  void putEscaped_(const char *text, size_t length, bool bounded);
+  void putUnsigned_(unsigned long number);
+};
@@ -49,11 +49,10 @@ void LcdDisplay::begin() {
   lcd_->backlight();
   lcd_->clear();
 
-  lines_[0] = "LCD ready";
-  lines_[1] = String("Addr: 0x") + String(address_, HEX);
-  lines_[1].toUpperCase();
-  lines_[2] = "Waiting for host";
-  lines_[3] = "";
+  normalizeLine_(0, "LCD ready");
+  snprintf(lines_[1], LINE_CAPACITY, "Addr: 0x%X", address_);
+  normalizeLine_(2, "Waiting for host");
+  normalizeLine_(3, "");
   redraw_();
 }
 
@@ -63,7 +62,7 @@ int LcdDisplay::address() const { return address_; }
 
 void LcdDisplay::clear() {
   for (uint8_t i = 0; i < LCD_ROWS; i++) {
-    lines_[i] = "";
+    lines_[i][0] = '\0';
   }
   redraw_();
 }
@@ -79,19 +78,19 @@ void LcdDisplay::setBacklight(bool enabled) {
   }
 }
 
-bool LcdDisplay::setLines(const String *lines, size_t count) {
+bool LcdDisplay::setLines(const char *const *lines, size_t count) {
   for (uint8_t i = 0; i < LCD_ROWS; i++) {
-    lines_[i] = i < count ? normalizeLine_(lines[i]) : normalizeLine_("");
+    normalizeLine_(i, i < count ? lines[i] : "");
   }
   redraw_();
   return available();
 }
 
-bool LcdDisplay::setLine(uint8_t lineIndex, const String &text) {
+bool LcdDisplay::setLine(uint8_t lineIndex, const char *text) {
   if (lineIndex >= LCD_ROWS) {
     return false;
   }
-  lines_[lineIndex] = normalizeLine_(text);
+  normalizeLine_(lineIndex, text);
   redraw_();
   return available();
 }
@@ -106,24 +105,26 @@ void LcdDisplay::redraw_() {
   }
 }
 
-void LcdDisplay::writeEncodedLine_(uint8_t row, const String &text) {
+void LcdDisplay::writeEncodedLine_(uint8_t row, const char *text) {
   lcd_->setCursor(0, row);
   for (uint8_t i = 0; i < LCD_COLS; i++) {
     lcd_->write(' ');
   }
 
   lcd_->setCursor(0, row);
-  uint16_t index = 0;
+  const uint8_t length = static_cast<uint8_t>(strlen(text));
+  uint8_t index = 0;
   uint8_t printed = 0;
   int8_t utfHiChar = -1;
-  while (index < text.length() && printed < LCD_COLS) {
-    lcd_->write(writeEncodedChar_(text, index, utfHiChar));
+  while (index < length && printed < LCD_COLS) {
+    lcd_->write(writeEncodedChar_(text, length, index, utfHiChar));
     printed++;
   }
 }
 
-uint8_t LcdDisplay::writeEncodedChar_(const String &text, uint16_t &index, int8_t &utfHiChar) {
-  if (index >= text.length()) {
+uint8_t LcdDisplay::writeEncodedChar_(const char *text, uint8_t length, uint8_t &index,
+                                      int8_t &utfHiChar) {
+  if (index >= length) {
     return ' ';
   }
 
@@ -150,20 +151,17 @@ uint8_t LcdDisplay::writeEncodedChar_(const String &text, uint16_t &index, int8_
 
   if (value >= 0xD0 && value < 0xD2) {
     utfHiChar = static_cast<int8_t>(value - 0xD0);
-    if (index >= text.length()) {
+    if (index >= length) {
       utfHiChar = -1;
       return value;
     }
-    return writeEncodedChar_(text, index, utfHiChar);
+    return writeEncodedChar_(text, length, index, utfHiChar);
   }
 
   return value;
 }
 
-String LcdDisplay::normalizeLine_(const String &text) const {
-  String out = text;
-  if (out.length() > LCD_COLS) {
-    out.remove(LCD_COLS);
-  }
-  return out;
+void LcdDisplay::normalizeLine_(uint8_t row, const char *text) {
+  strncpy(lines_[row], text, LCD_COLS);
+  lines_[row][LCD_COLS] = '\0';
 }
@@ -12,16 +12,18 @@ class LcdDisplay {
   int address() const;
   void clear();
   void setBacklight(bool enabled);
-  bool setLines(const String *lines, size_t count);
-  bool setLine(uint8_t lineIndex, const String &text);
+  bool setLines(const char *const *lines, size_t count);
+  bool setLine(uint8_t lineIndex, const char *text);
 
  private:
+  static constexpr uint8_t LINE_CAPACITY = 21;
+
   LiquidCrystal_I2C *lcd_ = nullptr;
   int address_ = -1;
 
   void redraw_();
-  void writeEncodedLine_(uint8_t row, const String &text);
-  uint8_t writeEncodedChar_(const String &text, uint16_t &index, int8_t &utfHiChar);
-  String normalizeLine_(const String &text) const;
-  String lines_[4];
+  void writeEncodedLine_(uint8_t row, const char *text);
+  uint8_t writeEncodedChar_(const char *text, uint8_t length, uint8_t &index, int8_t &utfHiChar);
+  void normalizeLine_(uint8_t row, const char *text);
+  char lines_[4][LINE_CAPACITY];
 };
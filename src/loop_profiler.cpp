@@ -0,0 +1,75 @@
+#include "loop_profiler.h"
+
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(address) (*(address))
+#endif
+
+namespace {
+constexpr uint16_t COUNTER_MAX = 0xFFFF;
+constexpr uint32_t SAMPLES_MAX = 0xFFFFFFFFUL;
+constexpr uint32_t TOTAL_MAX = 0xFFFFFFFFUL;
+
+// floor(log2(n)) for a nibble; 0 for 0.
+const uint8_t NIBBLE_LOG2[16] PROGMEM = {0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3};
+
+const char *const PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "rx",       "dispatch",    "lcd_i2c", "drive",    "emit_drive", "switches", "emit_switches",
+    "keypad",   "emit_keypad", "locks",   "rfid_spi", "emit_rfid",  "tx",
+};
+}  // namespace
+
+void LoopProfiler::record(ProfilePhase phase, uint32_t us) {
+  PhaseProfile &profile = phases_[static_cast<uint8_t>(phase)];
+  if (profile.samples == 0 || us < profile.minUs) {
+    profile.minUs = us;
+  }
+  if (us > profile.maxUs) {
+    profile.maxUs = us;
+  }
+  // samples and totalUs stop together, so meanUs() stays the mean of the
+  // samples counted rather than wrapping after ~71 minutes of phase time.
+  if (profile.samples < SAMPLES_MAX && us <= TOTAL_MAX - profile.totalUs) {
+    profile.samples++;
+    profile.totalUs += us;
+  }
+  uint16_t &count = profile.histogram[bucketFor(us)];
+  if (count < COUNTER_MAX) {
+    count++;
+  }
+}
+
+void LoopProfiler::reset() { memset(phases_, 0, sizeof(phases_)); }
+
+void LoopProfiler::reset(ProfilePhase phase) {
+  memset(&phases_[static_cast<uint8_t>(phase)], 0, sizeof(PhaseProfile));
+}
+
+uint8_t LoopProfiler::bucketFor(uint32_t us) {
+  if (us >= (1UL << (PROFILE_BUCKETS + 1))) {
+    return PROFILE_BUCKETS - 1;
+  }
+  // floor(log2(us)) from one nibble lookup; us < 2^13 here. Byte picks and
+  // nibble swaps are single instructions on the AVR, unlike 16-bit shifts.
+  const uint8_t high = static_cast<uint8_t>(us >> 8);
+  const uint8_t low = static_cast<uint8_t>(us);
+  uint8_t log2;
+  if (high >= 0x10) {
+    log2 = 12;
+  } else if (high != 0) {
+    log2 = 8 + pgm_read_byte(&NIBBLE_LOG2[high]);
+  } else if (low >= 0x10) {
+    log2 = 4 + pgm_read_byte(&NIBBLE_LOG2[low >> 4]);
+  } else {
+    log2 = pgm_read_byte(&NIBBLE_LOG2[low]);
+  }
+  return log2 > 1 ? log2 - 1 : 0;
+}
+
+const char *LoopProfiler::phaseName(ProfilePhase phase) {
+  return PHASE_NAMES[static_cast<uint8_t>(phase)];
+}
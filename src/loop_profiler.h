@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Exclusive main-loop phases: time spent in one is never counted in another.
+enum class ProfilePhase : uint8_t {
+  Rx,
+  Dispatch,
+  LcdI2c,
+  Drive,
+  EmitDrive,
+  Switches,
+  EmitSwitches,
+  Keypad,
+  EmitKeypad,
+  Locks,
+  RfidSpi,
+  EmitRfid,
+  Tx,
+  Count,
+};
+
+static constexpr uint8_t PROFILE_PHASE_COUNT = static_cast<uint8_t>(ProfilePhase::Count);
+// Bucket 0 is [0, 4) us, bucket k is [2^(k+1), 2^(k+2)) us, and the last
+// bucket takes everything from 4096 us up.
+static constexpr uint8_t PROFILE_BUCKETS = 12;
+
+struct PhaseProfile {
+  uint32_t samples;
+  uint32_t totalUs;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint16_t histogram[PROFILE_BUCKETS];
+
+  uint32_t meanUs() const { return samples > 0 ? totalUs / samples : 0; }
+};
+
+// Always-on per-phase loop timings: min/max/mean plus a log2 histogram.
+// record() is a few 32-bit compares and adds and a nibble-table log2; the
+// bridge times it on the target at boot (profile ack "sample_cycles") and
+// only records one loop pass in PROFILE_SAMPLE_EVERY.
+// Histogram buckets saturate; samples and totalUs stop together.
+class LoopProfiler {
+ public:
+  LoopProfiler() { reset(); }
+
+  void record(ProfilePhase phase, uint32_t us);
+  void reset();
+  void reset(ProfilePhase phase);
+  const PhaseProfile &phase(ProfilePhase phase) const {
+    return phases_[static_cast<uint8_t>(phase)];
+  }
+
+  static uint8_t bucketFor(uint32_t us);
+  static const char *phaseName(ProfilePhase phase);
+
+ private:
+  PhaseProfile phases_[PROFILE_PHASE_COUNT];
+};
@@ -0,0 +1,162 @@
+#include "motion_calibration.h"
+
+#include <string.h>
+
+#include "binary_frame.h"
+
+namespace {
+constexpr uint8_t MAGIC_0 = 'M';
+constexpr uint8_t MAGIC_1 = 'C';
+
+struct CalibrationField {
+  const char *name;
+  uint8_t offset;
+  uint8_t width;
+  uint16_t min;
+  uint16_t max;
+};
+
+// Append only: the position of a field is its place in the stored payload.
+constexpr CalibrationField CALIBRATION_FIELDS[] = {
+    {"forward_cell_ms", offsetof(MotionCalibration, forwardCellMs), 2, 50, 10000},
+    {"reverse_cell_ms", offsetof(MotionCalibration, reverseCellMs), 2, 50, 10000},
+    {"turn_left_ms", offsetof(MotionCalibration, turnLeftMs), 2, 50, 10000},
+    {"turn_right_ms", offsetof(MotionCalibration, turnRightMs), 2, 50, 10000},
+    {"forward_pwm", offsetof(MotionCalibration, forwardPwm), 1, 0, 255},
+    {"turn_pwm", offsetof(MotionCalibration, turnPwm), 1, 0, 255},
+    {"ramp_profile", offsetof(MotionCalibration, rampProfile), 1, 0, 2},
+    {"ramp_ms", offsetof(MotionCalibration, rampMs), 2, 0, 1000},
+    // Version 2.
+    {"left_forward_trim", offsetof(MotionCalibration, wheelTrim[0][0]), 2, TRIM_MIN, TRIM_MAX},
+    {"right_forward_trim", offsetof(MotionCalibration, wheelTrim[0][1]), 2, TRIM_MIN, TRIM_MAX},
+    {"left_reverse_trim", offsetof(MotionCalibration, wheelTrim[1][0]), 2, TRIM_MIN, TRIM_MAX},
+    {"right_reverse_trim", offsetof(MotionCalibration, wheelTrim[1][1]), 2, TRIM_MIN, TRIM_MAX},
+    {"left_turn_left_trim", offsetof(MotionCalibration, wheelTrim[2][0]), 2, TRIM_MIN, TRIM_MAX},
+    {"right_turn_left_trim", offsetof(MotionCalibration, wheelTrim[2][1]), 2, TRIM_MIN, TRIM_MAX},
+    {"left_turn_right_trim", offsetof(MotionCalibration, wheelTrim[3][0]), 2, TRIM_MIN, TRIM_MAX},
+    {"right_turn_right_trim", offsetof(MotionCalibration, wheelTrim[3][1]), 2, TRIM_MIN, TRIM_MAX},
+    // Version 3.
+    {"arc_left_ms", offsetof(MotionCalibration, arcLeftMs), 2, 50, 10000},
+    {"arc_right_ms", offsetof(MotionCalibration, arcRightMs), 2, 50, 10000},
+    {"arc_pwm", offsetof(MotionCalibration, arcPwm), 1, 0, 255},
+    {"arc_inner_permille", offsetof(MotionCalibration, arcInnerPermille), 2, 0, 1000},
+    // Version 4.
+    {"supply_nominal_mv", offsetof(MotionCalibration, supplyNominalMv), 2, 0, 30000},
+    // Version 5.
+    {"encoder_ticks_cell", offsetof(MotionCalibration, encoderTicksCell), 2, 0, 10000},
+    {"encoder_ticks_turn", offsetof(MotionCalibration, encoderTicksTurn), 2, 0, 10000},
+    {"encoder_ticks_arc", offsetof(MotionCalibration, encoderTicksArc), 2, 0, 10000},
+    {"encoder_kp", offsetof(MotionCalibration, encoderKp), 2, 0, 1000},
+    {"encoder_ki", offsetof(MotionCalibration, encoderKi), 2, 0, 1000},
+};
+constexpr uint8_t FIELD_COUNT = sizeof(CALIBRATION_FIELDS) / sizeof(CALIBRATION_FIELDS[0]);
+
+constexpr size_t payloadSize(uint8_t index = 0) {
+  return index >= FIELD_COUNT ? 0 : CALIBRATION_FIELDS[index].width + payloadSize(index + 1);
+}
+
+// Header, payload and CRC must fit the buffer callers pass to encodeCalibration().
+static_assert(CALIBRATION_HEADER_SIZE + payloadSize() + 2 <= CALIBRATION_MAX_BLOCK_SIZE,
+              "Calibration block outgrew CALIBRATION_MAX_BLOCK_SIZE");
+
+uint16_t readField(const MotionCalibration &calibration, const CalibrationField &field) {
+  const uint8_t *base = reinterpret_cast<const uint8_t *>(&calibration) + field.offset;
+  if (field.width == 1) {
+    return base[0];
+  }
+  uint16_t value;
+  memcpy(&value, base, sizeof(value));
+  return value;
+}
+
+void writeField(MotionCalibration &calibration, const CalibrationField &field, uint16_t value) {
+  uint8_t *base = reinterpret_cast<uint8_t *>(&calibration) + field.offset;
+  if (field.width == 1) {
+    base[0] = static_cast<uint8_t>(value);
+    return;
+  }
+  memcpy(base, &value, sizeof(value));
+}
+}  // namespace
+
+size_t encodeCalibration(const MotionCalibration &calibration, uint8_t *block) {
+  size_t length = CALIBRATION_HEADER_SIZE;
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    const uint16_t value = readField(calibration, CALIBRATION_FIELDS[i]);
+    block[length++] = static_cast<uint8_t>(value);
+    if (CALIBRATION_FIELDS[i].width == 2) {
+      block[length++] = static_cast<uint8_t>(value >> 8);
+    }
+  }
+  block[0] = MAGIC_0;
+  block[1] = MAGIC_1;
+  block[2] = CALIBRATION_VERSION;
+  block[3] = static_cast<uint8_t>(length - CALIBRATION_HEADER_SIZE);
+  const uint16_t crc = crc16Ccitt(block, length);
+  block[length++] = static_cast<uint8_t>(crc >> 8);
+  block[length++] = static_cast<uint8_t>(crc);
+  return length;
+}
+
+bool decodeCalibration(const uint8_t *block, size_t length, MotionCalibration &calibration) {
+  if (length < CALIBRATION_HEADER_SIZE + 2 || block[0] != MAGIC_0 || block[1] != MAGIC_1 ||
+      block[2] == 0) {
+    return false;
+  }
+  const size_t payloadLength = block[3];
+  const size_t crcAt = CALIBRATION_HEADER_SIZE + payloadLength;
+  if (crcAt + 2 > length) {
+    return false;
+  }
+  const uint16_t crc = static_cast<uint16_t>((block[crcAt] << 8) | block[crcAt + 1]);
+  if (crc16Ccitt(block, crcAt) != crc) {
+    return false;
+  }
+
+  MotionCalibration decoded = calibration;
+  size_t at = CALIBRATION_HEADER_SIZE;
+  for (uint8_t i = 0; i < FIELD_COUNT && at + CALIBRATION_FIELDS[i].width <= crcAt; i++) {
+    const CalibrationField &field = CALIBRATION_FIELDS[i];
+    uint16_t value = block[at++];
+    if (field.width == 2) {
+      value |= static_cast<uint16_t>(block[at++] << 8);
+    }
+    if (value < field.min || value > field.max) {
+      return false;
+    }
+    writeField(decoded, field, value);
+  }
+  calibration = decoded;
+  return true;
+}
+
+uint8_t calibrationFieldCount() { return FIELD_COUNT; }
+
+const char *calibrationFieldName(uint8_t index) { return CALIBRATION_FIELDS[index].name; }
+
+uint8_t findCalibrationField(const char *name, size_t length) {
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    if (strlen(CALIBRATION_FIELDS[i].name) == length &&
+        memcmp(CALIBRATION_FIELDS[i].name, name, length) == 0) {
+      return i;
+    }
+  }
+  return NO_CALIBRATION_FIELD;
+}
+
+uint16_t calibrationFieldMin(uint8_t index) { return CALIBRATION_FIELDS[index].min; }
+
+uint16_t calibrationFieldMax(uint8_t index) { return CALIBRATION_FIELDS[index].max; }
+
+uint16_t getCalibrationField(const MotionCalibration &calibration, uint8_t index) {
+  return readField(calibration, CALIBRATION_FIELDS[index]);
+}
+
+bool setCalibrationField(MotionCalibration &calibration, uint8_t index, long value) {
+  const CalibrationField &field = CALIBRATION_FIELDS[index];
+  if (value < field.min || value > field.max) {
+    return false;
+  }
+  writeField(calibration, field, static_cast<uint16_t>(value));
+  return true;
+}
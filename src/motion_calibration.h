@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Rows of the trim table: one per MotionAction from forward_cell to
+// turn_right, in enum order. Arcs use the forward_cell row.
+static constexpr uint8_t MOTION_TRIM_ACTIONS = 4;
+static constexpr uint16_t TRIM_UNITY = 1000;
+static constexpr uint16_t TRIM_MIN = 500;
+static constexpr uint16_t TRIM_MAX = 1500;
+
+enum class Wheel : uint8_t { Left, Right };
+
+// Motion tuning that can change without a reflash. DriveController starts
+// from the compile-time defaults in runtime_config.h and overlays whatever
+// valid block CalibrationStore finds in EEPROM.
+struct MotionCalibration {
+  uint16_t forwardCellMs;
+  uint16_t reverseCellMs;
+  uint16_t turnLeftMs;
+  uint16_t turnRightMs;
+  uint8_t forwardPwm;
+  uint8_t turnPwm;
+  uint8_t rampProfile;  // RampProfile
+  uint16_t rampMs;
+  // PWM scale per action and wheel, in permille: wheelTrim[action - 1][wheel].
+  uint16_t wheelTrim[MOTION_TRIM_ACTIONS][2];
+  uint16_t arcLeftMs;
+  uint16_t arcRightMs;
+  // Outer wheel PWM of an arc; the inner wheel runs at arcInnerPermille of it.
+  uint8_t arcPwm;
+  uint16_t arcInnerPermille;
+  // Supply voltage the timings were calibrated at; PWM is scaled to hold the
+  // motor voltage there. 0 turns compensation off.
+  uint16_t supplyNominalMv;
+  // Encoder ticks per cell, per pivot quarter turn and per arc (outer wheel);
+  // 0 leaves that kind of step timed. Ignored without encoders.
+  uint16_t encoderTicksCell;
+  uint16_t encoderTicksTurn;
+  uint16_t encoderTicksArc;
+  // Encoder PI gains, permille of PWM per tick.
+  uint16_t encoderKp;
+  uint16_t encoderKi;
+};
+
+// Stored layout: 'M' 'C' <version> <payload length> <fields, little-endian, in
+// CALIBRATION_FIELDS order> <crc16 hi> <crc16 lo>, CRC over everything before
+// it. Fields are only ever appended, so a block written by an older version
+// still loads; the fields it lacks keep their defaults.
+static constexpr uint8_t CALIBRATION_VERSION = 5;
+static constexpr size_t CALIBRATION_HEADER_SIZE = 4;
+static constexpr size_t CALIBRATION_MAX_BLOCK_SIZE = 64;
+static constexpr uint8_t NO_CALIBRATION_FIELD = 0xFF;
+
+// Writes the block to `block` (CALIBRATION_MAX_BLOCK_SIZE bytes) and returns
+// its size.
+size_t encodeCalibration(const MotionCalibration &calibration, uint8_t *block);
+// Overwrites `calibration` only if the block is intact and every value in it
+// is in range; `length` is how many bytes are available.
+bool decodeCalibration(const uint8_t *block, size_t length, MotionCalibration &calibration);
+
+uint8_t calibrationFieldCount();
+const char *calibrationFieldName(uint8_t index);
+uint8_t findCalibrationField(const char *name, size_t length);
+uint16_t calibrationFieldMin(uint8_t index);
+uint16_t calibrationFieldMax(uint8_t index);
+uint16_t getCalibrationField(const MotionCalibration &calibration, uint8_t index);
+// Fails, leaving `calibration` unchanged, when `value` is out of range.
+bool setCalibrationField(MotionCalibration &calibration, uint8_t index, long value);
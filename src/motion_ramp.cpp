@@ -0,0 +1,75 @@
+#include "motion_ramp.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t *>(address))
+#endif
+
+namespace {
+const uint8_t LINEAR_RAMP[RAMP_SEGMENTS + 1] PROGMEM = {
+    0, 16, 32, 48, 64, 80, 96, 112, 128, 143, 159, 175, 191, 207, 223, 239, 255,
+};
+
+// 3t^2 - 2t^3: zero slope at both ends, so there is no jerk at start or cruise.
+const uint8_t SCURVE_RAMP[RAMP_SEGMENTS + 1] PROGMEM = {
+    0, 3, 11, 24, 40, 59, 81, 104, 128, 151, 174, 196, 215, 231, 244, 252, 255,
+};
+
+const uint8_t *rampTable(RampProfile profile) {
+  return profile == RampProfile::SCurve ? SCURVE_RAMP : LINEAR_RAMP;
+}
+}  // namespace
+
+uint8_t rampPwm(RampProfile profile, uint32_t elapsedUs, uint32_t rampUs, uint8_t targetPwm) {
+  if (profile == RampProfile::Step || elapsedUs >= rampUs) {
+    return targetPwm;
+  }
+  // Position in 1/256ths of a segment.
+  const uint32_t position = elapsedUs * (RAMP_SEGMENTS * 256UL) / rampUs;
+  const uint8_t segment = static_cast<uint8_t>(position >> 8);
+  const uint8_t fraction = static_cast<uint8_t>(position);
+  const uint8_t *table = rampTable(profile);
+  const uint8_t from = pgm_read_byte(&table[segment]);
+  const uint8_t to = pgm_read_byte(&table[segment + 1]);
+  const uint16_t level = from + static_cast<uint16_t>(((to - from) * fraction) >> 8);
+  return static_cast<uint8_t>((level * targetPwm + 127) / 255);
+}
+
+uint16_t rampAreaPermille(RampProfile profile) {
+  if (profile == RampProfile::Step) {
+    return 1000;
+  }
+  // Trapezoid rule over the table.
+  const uint8_t *table = rampTable(profile);
+  uint32_t doubled = 0;
+  for (uint8_t i = 0; i < RAMP_SEGMENTS; i++) {
+    doubled += pgm_read_byte(&table[i]) + pgm_read_byte(&table[i + 1]);
+  }
+  return static_cast<uint16_t>(doubled * 1000UL / (2UL * 255 * RAMP_SEGMENTS));
+}
+
+RampPlan planRampedStep(uint32_t nominalMs, RampProfile profile, uint16_t rampMs, bool rampUp,
+                        bool rampDown) {
+  const uint8_t rampCount = (rampUp ? 1 : 0) + (rampDown ? 1 : 0);
+  if (profile == RampProfile::Step || rampCount == 0 || rampMs == 0) {
+    return RampPlan{nominalMs, 0, 0};
+  }
+  if (rampMs > RAMP_MAX_US / 1000) {
+    rampMs = RAMP_MAX_US / 1000;
+  }
+  const uint32_t area = rampAreaPermille(profile);
+  // Each ramp covers rampMs * area of full-speed distance.
+  const uint32_t rampDistance = static_cast<uint32_t>(rampMs) * area * rampCount;
+  uint32_t rampLength = rampMs;
+  uint32_t durationMs;
+  if (rampDistance > nominalMs * 1000UL) {
+    rampLength = nominalMs * 1000UL / (area * rampCount);
+    durationMs = rampLength * rampCount;
+  } else {
+    durationMs = nominalMs + rampLength * rampCount * (1000 - area) / 1000;
+  }
+  return RampPlan{durationMs, static_cast<uint16_t>(rampUp ? rampLength : 0),
+                  static_cast<uint16_t>(rampDown ? rampLength : 0)};
+}
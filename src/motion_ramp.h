@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Acceleration shape applied at the start and end of a move. Step keeps the
+// old behaviour: full PWM at once, cut to zero at the deadline.
+enum class RampProfile : uint8_t { Step, Linear, SCurve };
+
+// Ramp tables hold RAMP_SEGMENTS + 1 points from 0 to 255 (full target PWM).
+static constexpr uint8_t RAMP_SEGMENTS = 16;
+// Longer ramps would overflow the 32-bit interpolation in rampPwm();
+// planRampedStep() never plans one.
+static constexpr uint32_t RAMP_MAX_US = 1000000UL;
+
+// PWM `elapsedUs` into a ramp of `rampUs` towards `targetPwm`; a ramp-down is
+// the same curve read with the time left to the deadline.
+uint8_t rampPwm(RampProfile profile, uint32_t elapsedUs, uint32_t rampUs, uint8_t targetPwm);
+
+// Distance covered during a ramp relative to the same time at full speed.
+uint16_t rampAreaPermille(RampProfile profile);
+
+struct RampPlan {
+  uint32_t durationMs;
+  uint16_t rampUpMs;
+  uint16_t rampDownMs;
+};
+
+// Stretches a move calibrated at full speed (`nominalMs`) so that it covers
+// the same distance with the requested ramps, taking distance as proportional
+// to PWM. Ramps that would not fit are shortened until the move has no cruise.
+RampPlan planRampedStep(uint32_t nominalMs, RampProfile profile, uint16_t rampMs, bool rampUp,
+                        bool rampDown);
@@ -0,0 +1,114 @@
+#include "motion_route.h"
+
+#include <string.h>
+
+namespace {
+struct ActionName {
+  MotionAction action;
+  char alias;
+  const char *name;
+};
+
+const ActionName ACTION_NAMES[] = {
+    {MotionAction::ForwardCell, 'f', "forward_cell"},
+    {MotionAction::ReverseCell, 'b', "reverse_cell"},
+    {MotionAction::TurnLeft, 'l', "turn_left"},
+    {MotionAction::TurnRight, 'r', "turn_right"},
+    {MotionAction::ArcLeft, 'L', "arc_left"},
+    {MotionAction::ArcRight, 'R', "arc_right"},
+    {MotionAction::ForwardCell, 'f', "forward_n"},
+    {MotionAction::ReverseCell, 'b', "reverse_n"},
+};
+constexpr uint8_t ACTION_NAME_COUNT = sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]);
+
+bool parseNumber(const char *text, size_t length, uint32_t maxValue, uint32_t &valueOut) {
+  if (length == 0) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] < '0' || text[i] > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<uint32_t>(text[i] - '0');
+    if (value > maxValue) {
+      return false;
+    }
+  }
+  valueOut = value;
+  return true;
+}
+
+bool drivesForward(MotionAction action) {
+  return action == MotionAction::ForwardCell || action == MotionAction::ArcLeft ||
+         action == MotionAction::ArcRight;
+}
+
+bool parseStep(const char *text, size_t length, MotionStep &stepOut) {
+  const char *duration = static_cast<const char *>(memchr(text, ROUTE_DURATION_SEPARATOR, length));
+  const size_t headLength = duration != nullptr ? static_cast<size_t>(duration - text) : length;
+  const char *repeat = static_cast<const char *>(memchr(text, ROUTE_REPEAT_SEPARATOR, headLength));
+  const size_t nameLength = repeat != nullptr ? static_cast<size_t>(repeat - text) : headLength;
+  if (!findMotionAction(text, nameLength, stepOut.action)) {
+    return false;
+  }
+  uint32_t cells = 1;
+  if (repeat != nullptr &&
+      (!parseNumber(repeat + 1, headLength - nameLength - 1, 0xFF, cells) || cells == 0)) {
+    return false;
+  }
+  stepOut.cells = static_cast<uint8_t>(cells);
+  stepOut.durationMs = 0;
+  return duration == nullptr ||
+         parseNumber(duration + 1, length - headLength - 1, MAX_STEP_MS, stepOut.durationMs);
+}
+}  // namespace
+
+bool findMotionAction(const char *name, size_t length, MotionAction &actionOut) {
+  for (uint8_t i = 0; i < ACTION_NAME_COUNT; i++) {
+    const ActionName &entry = ACTION_NAMES[i];
+    if ((length == 1 && name[0] == entry.alias) ||
+        (length == strlen(entry.name) && memcmp(name, entry.name, length) == 0)) {
+      actionOut = entry.action;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *motionActionName(MotionAction action) {
+  for (uint8_t i = 0; i < ACTION_NAME_COUNT; i++) {
+    if (ACTION_NAMES[i].action == action) {
+      return ACTION_NAMES[i].name;
+    }
+  }
+  return "idle";
+}
+
+bool runsOnAtSpeed(MotionAction current, MotionAction next) {
+  return current != MotionAction::Idle &&
+         (next == current || (drivesForward(current) && drivesForward(next)));
+}
+
+uint8_t parseRoute(const char *text, size_t length, MotionStep *steps, uint8_t capacity,
+                   uint8_t &errorIndex) {
+  uint8_t count = 0;
+  size_t start = 0;
+  while (start <= length) {
+    const char *separator =
+        static_cast<const char *>(memchr(text + start, ROUTE_STEP_SEPARATOR, length - start));
+    const size_t end = separator != nullptr ? static_cast<size_t>(separator - text) : length;
+    if (count >= capacity || !parseStep(text + start, end - start, steps[count])) {
+      errorIndex = count;
+      return ROUTE_INVALID;
+    }
+    count++;
+    start = end + 1;
+  }
+  return count;
+}
+
+uint8_t stoppedRouteDropped(uint8_t length, uint8_t next, bool runningEnded) {
+  const uint8_t after = length - next;
+  return runningEnded ? after : after + 1;
+}
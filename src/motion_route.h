@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Arcs drive both wheels forward at different speeds, a quarter circle from
+// the centre of one cell to the centre of the diagonal one, replacing
+// forward_cell, turn_*, forward_cell.
+enum class MotionAction : uint8_t {
+  Idle,
+  ForwardCell,
+  ReverseCell,
+  TurnLeft,
+  TurnRight,
+  ArcLeft,
+  ArcRight,
+};
+
+// One queued move covering `cells` repeats of its action as a single timed
+// segment; durationMs 0 means `cells` times the action's calibrated default.
+struct MotionStep {
+  MotionAction action;
+  uint8_t cells;
+  uint32_t durationMs;
+};
+
+// Longest route DriveController holds at once.
+static constexpr uint8_t MOTION_QUEUE_CAPACITY = 16;
+static constexpr uint8_t ROUTE_INVALID = 0xFF;
+static constexpr char ROUTE_STEP_SEPARATOR = ',';
+static constexpr char ROUTE_REPEAT_SEPARATOR = '*';
+static constexpr char ROUTE_DURATION_SEPARATOR = ':';
+// Longest step or segment, about 18 minutes; keeps its time in microseconds,
+// plus the encoder grace, inside the signed 32-bit deadline arithmetic.
+static constexpr uint32_t MAX_STEP_MS = 1000000UL;
+
+// Accepts the `move` action names, the segment names forward_n and reverse_n,
+// and the one-letter route aliases f, b, l, r, L (arc_left), R (arc_right).
+bool findMotionAction(const char *name, size_t length, MotionAction &actionOut);
+const char *motionActionName(MotionAction action);
+// Whether `next` can take over from `current` without stopping: the same
+// action, or a change between forward_cell and the arcs, which turn no wheel
+// backwards.
+bool runsOnAtSpeed(MotionAction current, MotionAction next);
+
+// Parses a route such as `f*3,l:480,forward_cell`: comma-separated actions,
+// each optionally followed by `*<cells>` (1-255) and then `:<ms>`. Returns the number of steps, or
+// ROUTE_INVALID with `errorIndex` set to the first bad step; a route longer
+// than `capacity` fails at index `capacity`.
+uint8_t parseRoute(const char *text, size_t length, MotionStep *steps, uint8_t capacity,
+                   uint8_t &errorIndex);
+
+// Steps of a route that will not complete when it is stopped, `next` being
+// the index after the running step. The running one is not counted when its
+// deadline alarm already cut it: it ended, update() just had not retired it.
+uint8_t stoppedRouteDropped(uint8_t length, uint8_t next, bool runningEnded);
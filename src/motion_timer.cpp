@@ -0,0 +1,89 @@
+#include "motion_timer.h"
+
+#include <util/atomic.h>
+
+#include "runtime_config.h"
+
+namespace {
+// Ticks closer than this to TCNT1 could be passed before OCR1A is written.
+constexpr uint16_t MIN_TICKS = 2;
+
+// Full 16-bit counter laps still to go before the compare that matters.
+volatile uint16_t gLapsLeft = 0;
+volatile bool gFired = false;
+volatile bool gAlarmFired = false;
+volatile uint32_t gFiredAtUs = 0;
+}  // namespace
+
+ISR(TIMER1_COMPA_vect) {
+  if (gLapsLeft > 0) {
+    gLapsLeft--;
+    return;
+  }
+  analogWrite(MOTOR_RIGHT_PWM_PIN, 0);
+  analogWrite(MOTOR_LEFT_PWM_PIN, 0);
+  TIMSK1 &= ~_BV(OCIE1A);
+  gFiredAtUs = micros();
+  gFired = true;
+  gAlarmFired = true;
+}
+
+void MotionTimer::begin() {
+  TIMSK1 = 0;
+  TCCR1A = 0;
+  // Normal mode, clk/64: one tick per 4 us, one lap per 262 ms.
+  TCCR1B = _BV(CS11) | _BV(CS10);
+}
+
+void MotionTimer::arm(uint32_t durationUs) {
+  uint32_t ticks = durationUs / TICK_US;
+  if (ticks < MIN_TICKS) {
+    ticks = MIN_TICKS;
+  }
+  uint16_t laps = static_cast<uint16_t>(ticks >> 16);
+  uint16_t remainder = static_cast<uint16_t>(ticks);
+  if (remainder == 0) {
+    // A compare at TCNT1 itself next matches a full lap from now.
+    laps--;
+  } else if (remainder < MIN_TICKS) {
+    remainder = MIN_TICKS;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    gLapsLeft = laps;
+    gFired = false;
+    gAlarmFired = false;
+    OCR1A = TCNT1 + remainder;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+  }
+}
+
+void MotionTimer::disarm() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TIMSK1 &= ~_BV(OCIE1A);
+    gFired = false;
+    gAlarmFired = false;
+  }
+}
+
+void MotionTimer::trip() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (!gFired) {
+      analogWrite(MOTOR_RIGHT_PWM_PIN, 0);
+      analogWrite(MOTOR_LEFT_PWM_PIN, 0);
+      TIMSK1 &= ~_BV(OCIE1A);
+      gFiredAtUs = micros();
+      gFired = true;
+    }
+  }
+}
+
+bool MotionTimer::fired() { return gFired; }
+
+bool MotionTimer::alarmFired() { return gAlarmFired; }
+
+uint32_t MotionTimer::firedAtUs() {
+  uint32_t firedAt;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { firedAt = gFiredAtUs; }
+  return firedAt;
+}
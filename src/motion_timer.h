@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// One-shot Timer1 compare alarm that zeroes both drive PWM outputs at a
+// motion deadline, however long the main loop happens to be blocked. Timer1
+// is otherwise unused: the motor PWM pins sit on Timers 3 and 4, and Servo
+// only takes Timer1 beyond 12 servos (Timer5 first).
+class MotionTimer {
+ public:
+  // Switches Timer1 from the core's 8-bit PWM mode to a free-running counter.
+  static void begin();
+  // Cuts the motors durationUs from now, to the 4 us timer resolution.
+  static void arm(uint32_t durationUs);
+  static void disarm();
+  // Cuts the motors now, exactly as the alarm would; an alarm that already
+  // fired keeps its time. Interrupt-safe and cheap enough for the RX scan.
+  static void trip();
+  // True once the alarm has cut the motors; stays set until arm() or disarm().
+  static bool fired();
+  // Same, but only when the armed deadline cut them, not trip().
+  static bool alarmFired();
+  // micros() taken right after the PWM outputs were zeroed.
+  static uint32_t firedAtUs();
+
+  static constexpr uint8_t TICK_US = 4;
+};
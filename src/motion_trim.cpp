@@ -0,0 +1,67 @@
+#include "motion_trim.h"
+
+namespace {
+// x * num / den, rounded to nearest.
+uint32_t scaleRounded(uint32_t x, uint32_t num, uint32_t den) { return (x * num + den / 2) / den; }
+}  // namespace
+
+uint8_t scalePwm(uint8_t pwm, uint16_t permille) {
+  const uint32_t scaled = (static_cast<uint32_t>(pwm) * permille + TRIM_UNITY / 2) / TRIM_UNITY;
+  return scaled > 255 ? 255 : static_cast<uint8_t>(scaled);
+}
+
+WheelPwm trimWheelPwm(const MotionCalibration &calibration, MotionAction action, uint8_t pwm) {
+  if (action == MotionAction::Idle) {
+    return WheelPwm{0, 0};
+  }
+  const bool arc = action == MotionAction::ArcLeft || action == MotionAction::ArcRight;
+  const uint8_t row = arc ? 0 : static_cast<uint8_t>(action) - 1;
+  const uint16_t *trim = calibration.wheelTrim[row];
+  WheelPwm wheels{scalePwm(pwm, trim[static_cast<uint8_t>(Wheel::Left)]),
+                  scalePwm(pwm, trim[static_cast<uint8_t>(Wheel::Right)])};
+  if (action == MotionAction::ArcLeft) {
+    wheels.left = scalePwm(wheels.left, calibration.arcInnerPermille);
+  } else if (action == MotionAction::ArcRight) {
+    wheels.right = scalePwm(wheels.right, calibration.arcInnerPermille);
+  }
+  return wheels;
+}
+
+bool deriveDriftTrim(MotionCalibration &calibration, MotionAction action, int32_t driftMm,
+                     uint32_t runMm, uint16_t trackMm) {
+  if ((action != MotionAction::ForwardCell && action != MotionAction::ReverseCell) ||
+      runMm == 0 || trackMm == 0) {
+    return false;
+  }
+  // Either way round, drifting left means the right wheel covered more ground.
+  const bool rightFaster = driftMm > 0;
+  const uint32_t drift = static_cast<uint32_t>(rightFaster ? driftMm : -driftMm);
+  if (drift >= runMm) {
+    return false;
+  }
+  // Relative speed error (fast - slow) / mean, in permille.
+  const uint64_t errorNum = 2ULL * TRIM_UNITY * drift * trackMm;
+  const uint64_t errorDen = static_cast<uint64_t>(runMm) * runMm;
+  const uint32_t error = static_cast<uint32_t>((errorNum + errorDen / 2) / errorDen);
+  if (error >= 2 * TRIM_UNITY) {
+    return false;
+  }
+
+  uint16_t *trim = calibration.wheelTrim[static_cast<uint8_t>(action) - 1];
+  uint32_t left = trim[static_cast<uint8_t>(Wheel::Left)];
+  uint32_t right = trim[static_cast<uint8_t>(Wheel::Right)];
+  // fast / slow = (2 + e) / (2 - e), so fast is scaled by (2 - e) / (2 + e).
+  uint32_t &fast = rightFaster ? right : left;
+  fast = scaleRounded(fast, 2 * TRIM_UNITY - error, 2 * TRIM_UNITY + error);
+  const uint32_t top = left > right ? left : right;
+  if (top < TRIM_UNITY) {
+    left = scaleRounded(left, TRIM_UNITY, top);
+    right = scaleRounded(right, TRIM_UNITY, top);
+  }
+  if (left < TRIM_MIN || right < TRIM_MIN || left > TRIM_MAX || right > TRIM_MAX) {
+    return false;
+  }
+  trim[static_cast<uint8_t>(Wheel::Left)] = static_cast<uint16_t>(left);
+  trim[static_cast<uint8_t>(Wheel::Right)] = static_cast<uint16_t>(right);
+  return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "motion_calibration.h"
+#include "motion_route.h"
+
+struct WheelPwm {
+  uint8_t left;
+  uint8_t right;
+};
+
+// pwm * permille / 1000, rounded and saturating at 255.
+uint8_t scalePwm(uint8_t pwm, uint16_t permille);
+
+// Scales the shared ramp output by the action's per-wheel trims, saturating
+// at 255. Arcs take the forward_cell trims and scale the inner wheel further
+// by arcInnerPermille. Idle gives zero on both wheels.
+WheelPwm trimWheelPwm(const MotionCalibration &calibration, MotionAction action, uint8_t pwm);
+
+// Corrects the trims of a straight action (forward_cell or reverse_cell) from
+// one measured run: `driftMm` is how far the robot ended up to its own left
+// (negative: right) of the line after `runMm` of travel. Over a straight run a
+// relative wheel-speed error e bends the path into an arc with lateral offset
+// run^2 * e / (2 * track), so e = 2 * track * drift / run^2. The faster wheel
+// is slowed by that ratio, then both are scaled so the stronger one is back at
+// TRIM_UNITY unless it was set above it. PWM is taken as proportional to
+// wheel speed, so repeat the run and apply the residual until it settles.
+// Fails, leaving the trims unchanged, when the action is not straight or the
+// correction would leave [TRIM_MIN, TRIM_MAX].
+bool deriveDriftTrim(MotionCalibration &calibration, MotionAction action, int32_t driftMm,
+                     uint32_t runMm, uint16_t trackMm);
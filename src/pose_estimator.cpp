@@ -0,0 +1,151 @@
+#include "pose_estimator.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_word(address) (*(address))
+#endif
+
+namespace {
+// sin(0..90 degrees) in whole degrees, scaled to 10000.
+const uint16_t QUARTER_SINE[91] PROGMEM = {
+    0,    175,  349,  523,  698,  872,  1045, 1219, 1392, 1564, 1736, 1908, 2079, 2250,
+    2419, 2588, 2756, 2924, 3090, 3256, 3420, 3584, 3746, 3907, 4067, 4226, 4384, 4540,
+    4695, 4848, 5000, 5150, 5299, 5446, 5592, 5736, 5878, 6018, 6157, 6293, 6428, 6561,
+    6691, 6820, 6947, 7071, 7193, 7314, 7431, 7547, 7660, 7771, 7880, 7986, 8090, 8192,
+    8290, 8387, 8480, 8572, 8660, 8746, 8829, 8910, 8988, 9063, 9135, 9205, 9272, 9336,
+    9397, 9455, 9511, 9563, 9613, 9659, 9703, 9744, 9781, 9816, 9848, 9877, 9903, 9925,
+    9945, 9962, 9976, 9986, 9994, 9998, 10000,
+};
+
+constexpr uint32_t VAR_MAX = 0xFFFFFFFFUL;
+// Tenths of a degree to radians, times 1e6.
+constexpr uint32_t MICRORAD_PER_DD = 1745;
+
+uint16_t quarterSine(uint16_t angle) {
+  // angle in 0..900; linear between whole degrees.
+  const uint16_t degree = angle / 10;
+  const uint16_t low = pgm_read_word(&QUARTER_SINE[degree]);
+  if (degree == 90) {
+    return low;
+  }
+  const uint16_t high = pgm_read_word(&QUARTER_SINE[degree + 1]);
+  return static_cast<uint16_t>(low + (static_cast<uint32_t>(high - low) * (angle % 10) + 5) / 10);
+}
+
+uint16_t wrapHeading(int32_t heading) {
+  heading %= POSE_FULL_TURN;
+  return static_cast<uint16_t>(heading < 0 ? heading + POSE_FULL_TURN : heading);
+}
+
+uint32_t addVar(uint32_t variance, uint32_t sd) {
+  const uint32_t square = sd >= 0xFFFF ? VAR_MAX : sd * sd;
+  return VAR_MAX - variance < square ? VAR_MAX : variance + square;
+}
+
+int32_t scaleBy(int32_t value, int16_t factor) {
+  // 255 cells times a unit factor already overflows 32 bits.
+  const int64_t product = static_cast<int64_t>(value) * factor;
+  return static_cast<int32_t>(product >= 0 ? (product + 5000) / 10000 : (product - 5000) / 10000);
+}
+}  // namespace
+
+int16_t poseSin(uint16_t heading) {
+  heading = wrapHeading(heading);
+  if (heading <= 900) {
+    return static_cast<int16_t>(quarterSine(heading));
+  }
+  if (heading <= 1800) {
+    return static_cast<int16_t>(quarterSine(1800 - heading));
+  }
+  if (heading <= 2700) {
+    return -static_cast<int16_t>(quarterSine(heading - 1800));
+  }
+  return -static_cast<int16_t>(quarterSine(3600 - heading));
+}
+
+int16_t poseCos(uint16_t heading) { return poseSin(wrapHeading(static_cast<int32_t>(heading) + 900)); }
+
+uint16_t isqrt32(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return static_cast<uint16_t>(root);
+}
+
+uint16_t PoseEstimate::positionSd() const { return isqrt32(positionVar); }
+
+uint16_t PoseEstimate::headingSd() const { return isqrt32(headingVar); }
+
+void PoseEstimator::reset(int32_t x, int32_t y, uint16_t heading) {
+  pose_ = PoseEstimate{x, y, wrapHeading(heading), 0, 0};
+}
+
+void PoseEstimator::integrate(MotionAction action, uint32_t milliUnits) {
+  // One step never covers more than 255 cells.
+  if (milliUnits > 255UL * POSE_CELL) {
+    milliUnits = 255UL * POSE_CELL;
+  }
+  const int32_t units = static_cast<int32_t>(milliUnits);
+  const int32_t angle = units * POSE_QUARTER_TURN / POSE_CELL;
+  switch (action) {
+    case MotionAction::ForwardCell:
+      move_(units, pose_.heading);
+      break;
+    case MotionAction::ReverseCell:
+      move_(-units, pose_.heading);
+      break;
+    case MotionAction::TurnLeft:
+      turn_(-angle);
+      break;
+    case MotionAction::TurnRight:
+      turn_(angle);
+      break;
+    case MotionAction::ArcLeft:
+    case MotionAction::ArcRight: {
+      // A circular arc of angle a and radius r ends one chord, 2 r sin(a / 2),
+      // away along the heading it had halfway through.
+      const int32_t signedAngle = action == MotionAction::ArcLeft ? -angle : angle;
+      const int32_t half = angle / 2;
+      const int32_t chord = scaleBy(2 * POSE_CELL, poseSin(static_cast<uint16_t>(half % POSE_FULL_TURN)));
+      move_(chord, wrapHeading(pose_.heading + signedAngle / 2));
+      turn_(signedAngle);
+      break;
+    }
+    case MotionAction::Idle:
+    default:
+      break;
+  }
+}
+
+void PoseEstimator::move_(int32_t distance, uint16_t heading) {
+  pose_.x += scaleBy(distance, poseSin(heading));
+  pose_.y -= scaleBy(distance, poseCos(heading));
+  const uint32_t driven = static_cast<uint32_t>(distance < 0 ? -distance : distance);
+  // Along-track error, plus the sideways error the heading uncertainty causes
+  // over this distance.
+  const uint32_t lateral =
+      static_cast<uint32_t>((static_cast<uint64_t>(driven) * pose_.headingSd() * MICRORAD_PER_DD) /
+                            1000000UL);
+  pose_.positionVar = addVar(pose_.positionVar, driven * POSE_DISTANCE_SD_PERMILLE / 1000);
+  pose_.positionVar = addVar(pose_.positionVar, lateral);
+  pose_.headingVar = addVar(pose_.headingVar, driven * POSE_DRIFT_DD_PER_CELL / POSE_CELL);
+}
+
+void PoseEstimator::turn_(int32_t angle) {
+  pose_.heading = wrapHeading(pose_.heading + angle);
+  const uint32_t turned = static_cast<uint32_t>(angle < 0 ? -angle : angle);
+  pose_.headingVar = addVar(pose_.headingVar, turned * POSE_TURN_SD_PERMILLE / 1000);
+}
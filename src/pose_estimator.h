@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "motion_route.h"
+
+// Grid frame of config/map.json: x grows east, y grows south, both in
+// thousandths of a cell; heading in tenths of a degree clockwise from north
+// (N 0, E 900, S 1800, W 2700).
+static constexpr int32_t POSE_CELL = 1000;
+static constexpr uint16_t POSE_FULL_TURN = 3600;
+static constexpr uint16_t POSE_QUARTER_TURN = 900;
+
+// Open-loop error model, one standard deviation: distance errs by 5 % of the
+// distance driven, a pivot or arc by 5 % of its angle, and a straight run
+// wanders 1 degree per cell. Rough guesses until measured; they only shape
+// how fast the reported uncertainty grows.
+static constexpr uint16_t POSE_DISTANCE_SD_PERMILLE = 50;
+static constexpr uint16_t POSE_TURN_SD_PERMILLE = 50;
+static constexpr uint16_t POSE_DRIFT_DD_PER_CELL = 10;
+
+struct PoseEstimate {
+  int32_t x;
+  int32_t y;
+  uint16_t heading;
+  // Variances of the position (per axis, thousandths of a cell squared) and
+  // of the heading (tenths of a degree squared); saturate rather than wrap.
+  uint32_t positionVar;
+  uint32_t headingVar;
+
+  uint16_t positionSd() const;
+  uint16_t headingSd() const;
+};
+
+// sin and cos of a heading, scaled to +-10000.
+int16_t poseSin(uint16_t heading);
+int16_t poseCos(uint16_t heading);
+uint16_t isqrt32(uint32_t value);
+
+// Integrates executed motion into a pose. Straight moves advance along the
+// heading, pivots turn in place and arcs move along a quarter circle of one
+// cell radius; partial steps count as the fraction actually driven.
+class PoseEstimator {
+ public:
+  // Sets a known pose with no uncertainty.
+  void reset(int32_t x, int32_t y, uint16_t heading);
+  // `milliUnits` is how much of the action was executed: thousandths of a
+  // cell for forward_cell / reverse_cell, thousandths of a quarter turn for
+  // pivots and arcs.
+  void integrate(MotionAction action, uint32_t milliUnits);
+  const PoseEstimate &pose() const { return pose_; }
+
+ private:
+  PoseEstimate pose_ = {0, 0, 0, 0, 0};
+
+  void move_(int32_t distance, uint16_t heading);
+  void turn_(int32_t angle);
+};
@@ -12,7 +12,7 @@ void RfidReader::begin() {
   recover_();
 }
 
-RfidReader::PollStatus RfidReader::pollUid(String &uidOut) {
+RfidReader::PollStatus RfidReader::pollUid(const char *&uidOut) {
   if (!reader_->PICC_IsNewCardPresent()) {
     return PollStatus::NoCard;
   }
@@ -23,17 +23,17 @@ RfidReader::PollStatus RfidReader::pollUid(String &uidOut) {
     return PollStatus::ReadFailed;
   }
 
-  const String uid = uidToHex_(*reader_);
+  uidToHex_(*reader_, uid_);
   reader_->PICC_HaltA();
   reader_->PCD_StopCrypto1();
 
-  if (uid == last_uid_ && millis() - last_uid_ms_ < RFID_REPEAT_SUPPRESS_MS) {
+  if (strcmp(uid_, last_uid_) == 0 && millis() - last_uid_ms_ < RFID_REPEAT_SUPPRESS_MS) {
     return PollStatus::RepeatSuppressed;
   }
 
-  last_uid_ = uid;
+  strcpy(last_uid_, uid_);
   last_uid_ms_ = millis();
-  uidOut = uid;
+  uidOut = last_uid_;
   return PollStatus::ScanSuccess;
 }
 
@@ -52,14 +52,12 @@ void RfidReader::recover_() {
   recovered_since_last_poll_ = true;
 }
 
-String RfidReader::uidToHex_(const MFRC522 &reader) {
-  String out;
-  for (byte i = 0; i < reader.uid.size; i++) {
-    if (reader.uid.uidByte[i] < 0x10) {
-      out += '0';
-    }
-    out += String(reader.uid.uidByte[i], HEX);
+void RfidReader::uidToHex_(const MFRC522 &reader, char *out) {
+  static const char kHex[] = "0123456789ABCDEF";
+  const byte size = reader.uid.size < 10 ? reader.uid.size : 10;
+  for (byte i = 0; i < size; i++) {
+    *out++ = kHex[reader.uid.uidByte[i] >> 4];
+    *out++ = kHex[reader.uid.uidByte[i] & 0x0F];
   }
-  out.toUpperCase();
-  return out;
+  *out = '\0';
 }
@@ -16,16 +16,19 @@ class RfidReader {
   RfidReader();
 
   void begin();
-  PollStatus pollUid(String &uidOut);
+  PollStatus pollUid(const char *&uidOut);
   bool consumeRecoveredSinceLastPoll();
 
  private:
+  static constexpr uint8_t UID_HEX_CAPACITY = 21;
+
   MFRC522 *reader_ = nullptr;
-  String last_uid_;
+  char uid_[UID_HEX_CAPACITY] = "";
+  char last_uid_[UID_HEX_CAPACITY] = "";
   unsigned long last_uid_ms_ = 0;
   unsigned long last_recovery_ms_ = 0;
   bool recovered_since_last_poll_ = false;
 
   void recover_();
-  static String uidToHex_(const MFRC522 &reader);
+  static void uidToHex_(const MFRC522 &reader, char *out);
 };
@@ -2,8 +2,25 @@
 
 #include <Arduino.h>
 
+#include "encoder_control.h"
+#include "motion_ramp.h"
+
 static constexpr unsigned long SERIAL_BAUD = 115200;
 static constexpr unsigned long SERIAL_WAIT_MS = 3000;
+// Rates the Pi may move to with set_baud; each divides 16 MHz exactly. After
+// a switch the Pi must send a command within BAUD_CONFIRM_TIMEOUT_MS or the
+// link falls back to SERIAL_BAUD.
+static constexpr unsigned long SERIAL_FAST_BAUDS[] = {250000, 500000, 1000000};
+static constexpr uint8_t SERIAL_FAST_BAUD_COUNT = sizeof(SERIAL_FAST_BAUDS) / sizeof(SERIAL_FAST_BAUDS[0]);
+static constexpr unsigned long BAUD_CONFIRM_TIMEOUT_MS = 1000;
+// Sized by -D SERIAL_RX_BUFFER_SIZE in platformio.ini; holds ~22 ms of
+// back-to-back Pi commands at 115200 baud while the loop is blocked.
+static constexpr uint16_t SERIAL_RX_RING_BYTES = SERIAL_RX_BUFFER_SIZE;
+// Above 256 the core's ring index is 16 bits, which the RX ISR updates while
+// available() and read() load it a byte at a time; the rx_bytes credit count
+// relies on those reads.
+static_assert(SERIAL_RX_RING_BYTES <= 256,
+              "SERIAL_RX_BUFFER_SIZE above 256 is read non-atomically");
 
 static constexpr uint8_t RC522_SS_PIN = 53;
 static constexpr uint8_t RC522_RST_PIN = 49;
@@ -26,11 +43,85 @@ static constexpr bool MOTOR_LEFT_REVERSE_DIR = HIGH;
 
 static constexpr uint8_t MOTOR_FORWARD_PWM = 110;
 static constexpr uint8_t MOTOR_TURN_PWM = 120;
+// Arcs: outer wheel PWM and the inner wheel's share of it. With track w and
+// cell size c the geometric ratio is (c - w/2) / (c + w/2); friction and the
+// motors' dead band move the right value, so measure it.
+static constexpr uint8_t MOTOR_ARC_PWM = 130;
+static constexpr uint16_t MOTION_ARC_INNER_PERMILLE = 450;
+// Default per-wheel PWM scale in permille; it seeds every action's row of the
+// trim table in MotionCalibration. Lower the faster motor.
+static constexpr uint16_t MOTOR_LEFT_TRIM_PERMILLE = 1000;
+static constexpr uint16_t MOTOR_RIGHT_TRIM_PERMILLE = 1000;
+// Wheel track (centre to centre), used to turn a measured drift into trims.
+static constexpr uint16_t DRIVE_TRACK_MM = 170;
 
 static constexpr unsigned long MOTION_FORWARD_CELL_MS = 900;
 static constexpr unsigned long MOTION_TURN_LEFT_MS = 500;
 static constexpr unsigned long MOTION_TURN_RIGHT_MS = 500;
 static constexpr unsigned long MOTION_REVERSE_CELL_MS = 900;
+// A quarter circle through one cell; replaces ~2.3 s of forward, pivot,
+// forward plus the stops between them.
+static constexpr unsigned long MOTION_ARC_LEFT_MS = 1650;
+static constexpr unsigned long MOTION_ARC_RIGHT_MS = 1650;
+// Timings above are full-speed equivalents: DriveController stretches each
+// move so the ramps cover the same distance. Consecutive steps of a route
+// that keep every wheel turning the same way (identical steps, or forward_cell
+// and arcs) run through at speed, with no ramp between them.
+static constexpr RampProfile MOTION_RAMP_PROFILE = RampProfile::SCurve;
+static constexpr uint16_t MOTION_RAMP_MS = 120;
+
+// Optional wheel encoders. Channel A of each wheel goes to an external
+// interrupt, pins 18 / 19 (INT3 / INT2: 2, 3, 20 and 21 are taken by the
+// servos and I2C); channel B, for quadrature, to A8 / A9. With encoders a step
+// ends on its tick count rather than its time, and a PI loop per wheel keeps
+// both at the same speed. A step whose encoders stop counting finishes on
+// time, and the rest of its route runs timed.
+static constexpr EncoderMode ENCODER_MODE = EncoderMode::None;
+static constexpr uint8_t ENCODER_LEFT_A_PIN = 18;
+static constexpr uint8_t ENCODER_RIGHT_A_PIN = 19;
+static constexpr uint8_t ENCODER_LEFT_B_PIN = 62;
+static constexpr uint8_t ENCODER_RIGHT_B_PIN = 63;
+// Quadrature only: the motors are mirrored, so one encoder counts down when
+// its wheel drives forward.
+static constexpr bool ENCODER_LEFT_REVERSED = false;
+static constexpr bool ENCODER_RIGHT_REVERSED = true;
+// Ticks per cell, per quarter-turn pivot and per arc (outer wheel). 0 leaves
+// that kind of step timed.
+static constexpr uint16_t ENCODER_TICKS_PER_CELL = 0;
+static constexpr uint16_t ENCODER_TICKS_PER_TURN = 0;
+static constexpr uint16_t ENCODER_TICKS_PER_ARC = 0;
+// PI gains in permille of PWM per tick, tuned against the host simulation in
+// test/test_host_motion_06_encoder_loop at about 16 ticks per period.
+static constexpr uint16_t ENCODER_KP_PERMILLE = 20;
+static constexpr uint16_t ENCODER_KI_PERMILLE = 30;
+static constexpr uint16_t ENCODER_PERIOD_MS = 20;
+static constexpr uint16_t ENCODER_STALL_MS = 300;
+static constexpr uint16_t ENCODER_MAX_CORRECTION_PERMILLE = 300;
+// Timer1 still cuts a step that runs this far past its timed duration.
+static constexpr uint16_t ENCODER_TIMEOUT_PERMILLE = 1500;
+// The ramp-down follows the ticks left but keeps this much PWM, so a slow
+// wheel still reaches its count.
+static constexpr uint8_t ENCODER_MIN_PWM = 60;
+
+// The values above are defaults; a calibration block saved at this EEPROM
+// address overrides them (see src/motion_calibration.h).
+static constexpr int CALIBRATION_EEPROM_ADDRESS = 0;
+
+// Motor supply sensed through a 30k / 10k divider on A2 (pin 56): up to 20 V
+// at the pack reads as 5 V at the pin. Sampled every 50 ms by the motion task
+// (one analogRead, ~112 us) and filtered with a 1/8 weight, about 0.4 s.
+static constexpr uint8_t SUPPLY_SENSE_PIN = 56;
+static constexpr uint16_t SUPPLY_ADC_FULL_SCALE_MV = 5000;
+static constexpr uint16_t SUPPLY_DIVIDER_PERMILLE = 4000;
+static constexpr uint16_t SUPPLY_MIN_VALID_MV = 3000;
+static constexpr uint16_t SUPPLY_SAMPLE_PERIOD_MS = 50;
+static constexpr uint8_t SUPPLY_FILTER_SHIFT = 3;
+// Bounds of the compensation factor, in permille. PWM still saturates at 255,
+// so calibrate with headroom if a drained pack must be fully made up for.
+static constexpr uint16_t SUPPLY_MIN_SCALE_PERMILLE = 700;
+static constexpr uint16_t SUPPLY_MAX_SCALE_PERMILLE = 1400;
+// Off until a nominal is set or captured with the calibration command.
+static constexpr uint16_t SUPPLY_NOMINAL_MV = 0;
 
 static constexpr uint8_t SWITCH1_PIN = 54;
 static constexpr uint8_t SWITCH2_PIN = 55;
@@ -52,3 +143,7 @@ static constexpr unsigned long KEYPAD_HOLD_MS = 500;
 static constexpr unsigned long KEYPAD_DEBOUNCE_MS = 20;
 static constexpr unsigned long RFID_REPEAT_SUPPRESS_MS = 1200;
 static constexpr unsigned long RFID_RECOVERY_COOLDOWN_MS = 250;
+
+// The loop profiler records one scheduler pass in this many (a power of two);
+// the others only pay a branch per phase boundary.
+static constexpr uint8_t PROFILE_SAMPLE_EVERY = 8;
@@ -0,0 +1,62 @@
+#include "rx_line_buffer.h"
+
+#include <ctype.h>
+#include <string.h>
+
+RxByte RxLineBuffer::push(char ch) {
+  if (ch == EMERGENCY_STOP_BYTE) {
+    dropWaiting_();
+    return RxByte::EmergencyStop;
+  }
+  if (ch == '\r') {
+    return RxByte::Skipped;
+  }
+  buffer_[used_++] = ch;
+  if (ch == '\n') {
+    lines_++;
+  }
+  return RxByte::Stored;
+}
+
+bool RxLineBuffer::takeLine(LineView &line) {
+  while (lines_ > 0) {
+    char *start = buffer_ + taken_;
+    char *end = static_cast<char *>(memchr(start, '\n', used_ - taken_));
+    lines_--;
+    taken_ = static_cast<size_t>(end - buffer_) + 1;
+    while (start < end && isspace(static_cast<unsigned char>(*start))) {
+      start++;
+    }
+    while (end > start && isspace(static_cast<unsigned char>(end[-1]))) {
+      end--;
+    }
+    // At worst this overwrites the '\n' itself.
+    *end = '\0';
+    if (end > start) {
+      line.data = start;
+      line.length = static_cast<size_t>(end - start);
+      return true;
+    }
+  }
+  return false;
+}
+
+void RxLineBuffer::release() {
+  if (taken_ == 0) {
+    return;
+  }
+  used_ -= taken_;
+  memmove(buffer_, buffer_ + taken_, used_);
+  taken_ = 0;
+}
+
+void RxLineBuffer::clear() {
+  used_ = 0;
+  taken_ = 0;
+  lines_ = 0;
+}
+
+void RxLineBuffer::dropWaiting_() {
+  used_ = taken_;
+  lines_ = 0;
+}
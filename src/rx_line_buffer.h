@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A received, whitespace-trimmed line inside SerialProtocol's RX buffer. The
+// bytes are writable and NUL-terminated; the view is valid until the next
+// pollLine() call.
+struct LineView {
+  char *data;
+  size_t length;
+};
+
+// Reserved control byte (ASCII CAN). No command line can contain it, so the
+// RX scan acts on it the moment it is read, even in the middle of a line.
+static constexpr char EMERGENCY_STOP_BYTE = 0x18;
+
+enum class RxByte : uint8_t {
+  Stored,
+  Skipped,        // '\r', which line endings may carry
+  // Never stored. Every byte not yet handed out is dropped: complete lines
+  // and the partial line it interrupted were all sent before the stop.
+  EmergencyStop,
+};
+
+// Bytes moved out of the UART ring ahead of parsing. Several complete lines
+// may be waiting; takeLine() hands them out oldest first, in place.
+class RxLineBuffer {
+ public:
+  static constexpr size_t CAPACITY = 384;
+
+  // Only call while !full().
+  RxByte push(char ch);
+  // Trims the oldest complete line, NUL-terminates it and returns true.
+  // Empty lines are skipped. The view stays valid until release().
+  bool takeLine(LineView &line);
+  // Drops every byte handed out by takeLine() and moves the rest down.
+  void release();
+  void clear();
+
+  bool full() const { return used_ == CAPACITY; }
+  // Full with no line end in sight: the line cannot fit and must be dropped.
+  bool overlong() const { return full() && taken_ == 0 && lines_ == 0; }
+  uint16_t lines() const { return lines_; }
+
+ private:
+  char buffer_[CAPACITY];
+  size_t used_ = 0;
+  // Bytes at the front already handed out by takeLine().
+  size_t taken_ = 0;
+  uint16_t lines_ = 0;
+
+  void dropWaiting_();
+};
@@ -1,235 +1,237 @@
 #include "serial_protocol.h"
 
-#include <ctype.h>
-#include <stdlib.h>
+#include <string.h>
 
-void SerialProtocol::begin(Stream &stream) {
+void SerialProtocol::begin(Stream &stream, size_t rxRingCapacity) {
   stream_ = &stream;
-  used_ = 0;
+  rx_.clear();
+  rx_ring_capacity_ = rxRingCapacity;
+  rx_overflows_ = 0;
+  rx_bytes_ = 0;
+  rx_reported_ = 0;
+  rx_idle_us_ = micros();
+  emergency_stop_pending_ = false;
 }
 
-bool SerialProtocol::pollLine(String &line) {
+bool SerialProtocol::pollLine(LineView &line) {
   if (stream_ == nullptr) {
     return false;
   }
 
-  while (stream_->available() > 0) {
-    const char ch = static_cast<char>(stream_->read());
-    if (ch == '\r') {
-      continue;
-    }
-    if (ch == '\n') {
-      buffer_[used_] = '\0';
-      line = String(buffer_);
-      used_ = 0;
-      line.trim();
-      return line.length() > 0;
-    }
-
-    if (used_ + 1 < BUFFER_CAPACITY) {
-      buffer_[used_++] = ch;
-    } else {
-      used_ = 0;
-      sendError("line_too_long", "Input line exceeded buffer capacity");
-      return false;
-    }
+  if (rx_ring_capacity_ > 0 &&
+      static_cast<size_t>(stream_->available()) + 1 >= rx_ring_capacity_) {
+    rx_overflows_++;
   }
 
+  rx_.release();
+  pumpRx(micros());
+  if (rx_.takeLine(line)) {
+    return input_mode_ != LinkMode::Binary || checkLineCrc_(line);
+  }
+  if (rx_.overlong()) {
+    rx_.clear();
+    sendError("line_too_long", "Input line exceeded buffer capacity");
+  }
   return false;
 }
 
-void SerialProtocol::sendAck(const char *command, const String &extraFields) {
-  String fields = String("\"command\":\"") + escape(command) + "\"";
-  if (extraFields.length() > 0) {
-    fields += ",";
-    fields += extraFields;
+void SerialProtocol::pumpRx(uint32_t nowUs) {
+  if (stream_ == nullptr) {
+    return;
+  }
+  // nowUs predates the look at the ring, so a byte missing from this scan
+  // arrived after it.
+  // A full buffer leaves the rest in the ring, where credit still covers it.
+  while (!rx_.full() && stream_->available() > 0) {
+    const char ch = static_cast<char>(stream_->read());
+    rx_bytes_++;
+    if (rx_.push(ch) == RxByte::EmergencyStop) {
+      if (emergency_stop_handler_ != nullptr) {
+        emergency_stop_handler_();
+      }
+      emergency_stops_++;
+      if (!emergency_stop_pending_) {
+        emergency_stop_pending_ = true;
+        emergency_stop_after_us_ = rx_idle_us_;
+      }
+    }
+  }
+  if (stream_->available() == 0) {
+    rx_idle_us_ = nowUs;
   }
-  sendObject_("ack", fields);
 }
 
-void SerialProtocol::sendError(const char *code, const String &message, const String &extraFields) {
-  String fields = String("\"code\":\"") + escape(code) + "\",\"message\":\"" +
-                  escape(message) + "\"";
-  if (extraFields.length() > 0) {
-    fields += ",";
-    fields += extraFields;
+bool SerialProtocol::takeEmergencyStop(uint32_t &arrivedAfterUs) {
+  if (!emergency_stop_pending_) {
+    return false;
   }
-  sendObject_("error", fields);
+  emergency_stop_pending_ = false;
+  arrivedAfterUs = emergency_stop_after_us_;
+  return true;
 }
 
-void SerialProtocol::sendEvent(const char *eventType, const String &extraFields) {
-  String fields = String("\"event\":\"") + escape(eventType) + "\"";
-  if (extraFields.length() > 0) {
-    fields += ",";
-    fields += extraFields;
-  }
-  sendObject_("event", fields);
+FrameWriter &SerialProtocol::beginAck(const char *command, TxPriority priority) {
+  FrameWriter &writer = beginFrame_("ack", priority).field("command", command);
+  captureStatus_("ok");
+  return appendCredit_(appendSequence_(writer));
 }
 
-bool SerialProtocol::extractString(const String &json, const char *key, String &valueOut) {
-  const int start = findKeyValueStart_(json, key);
-  if (start < 0 || start >= json.length() || json[start] != '"') {
-    return false;
-  }
+FrameWriter &SerialProtocol::beginError(const char *code, const char *message) {
+  FrameWriter &writer =
+      beginFrame_("error", TxPriority::Ack).field("code", code).field("message", message);
+  captureStatus_(code);
+  return appendCredit_(appendSequence_(writer));
+}
 
-  String value;
-  bool escaped = false;
-  for (int i = start + 1; i < json.length(); i++) {
-    const char ch = json[i];
-    if (escaped) {
-      value += ch;
-      escaped = false;
-      continue;
-    }
-    if (ch == '\\') {
-      escaped = true;
-      continue;
-    }
-    if (ch == '"') {
-      valueOut = value;
-      return true;
-    }
-    value += ch;
-  }
+FrameWriter &SerialProtocol::beginEvent(const char *eventType) {
+  const bool debug = strncmp(eventType, "debug_", 6) == 0;
+  return beginEvent(eventType, debug ? TxPriority::Debug : TxPriority::Event);
+}
 
-  return false;
+FrameWriter &SerialProtocol::beginEvent(const char *eventType, TxPriority priority) {
+  return beginFrame_("event", priority).field("event", eventType);
 }
 
-bool SerialProtocol::extractInt(const String &json, const char *key, int &valueOut) {
-  const int start = findKeyValueStart_(json, key);
-  if (start < 0) {
-    return false;
+void SerialProtocol::send() {
+  writer_->endObject();
+  if (stream_ == nullptr || frame_captured_) {
+    return;
   }
-
-  int end = start;
-  while (end < json.length() && (json[end] == '-' || isdigit(json[end]))) {
-    end++;
+  if (writer_->overflowed()) {
+    sendError("tx_frame_overflow", "Outgoing frame exceeded TX buffer");
+    return;
   }
-  if (end == start) {
-    return false;
+  size_t length = writer_->length();
+  if (output_mode_ == LinkMode::Binary) {
+    length = sealBinaryFrame(reinterpret_cast<uint8_t *>(tx_frame_), length);
+  } else {
+    tx_frame_[length++] = '\n';
   }
-
-  valueOut = json.substring(start, end).toInt();
-  return true;
+  tx_.push(frame_priority_, tx_frame_, length);
 }
 
-bool SerialProtocol::extractBool(const String &json, const char *key, bool &valueOut) {
-  const int start = findKeyValueStart_(json, key);
-  if (start < 0) {
-    return false;
-  }
+void SerialProtocol::beginCapture() {
+  capturing_ = true;
+  captured_status_ = "ok";
+}
 
-  if (json.startsWith("true", start)) {
-    valueOut = true;
-    return true;
-  }
-  if (json.startsWith("false", start)) {
-    valueOut = false;
-    return true;
-  }
-  return false;
+const char *SerialProtocol::endCapture() {
+  capturing_ = false;
+  frame_captured_ = false;
+  return captured_status_;
 }
 
-bool SerialProtocol::extractStringArray(const String &json, const char *key, String *valuesOut,
-                                        size_t maxValues, size_t &countOut) {
-  countOut = 0;
-  const int start = findKeyValueStart_(json, key);
-  if (start < 0 || start >= json.length() || json[start] != '[') {
-    return false;
+void SerialProtocol::drainTx() {
+  if (stream_ == nullptr) {
+    return;
   }
-
-  int i = start + 1;
-  while (i < json.length()) {
-    while (i < json.length() && isspace(json[i])) {
-      i++;
-    }
-    if (i >= json.length()) {
-      return false;
-    }
-    if (json[i] == ']') {
-      return true;
+  if (output_mode_ != input_mode_ && tx_.idle()) {
+    switchOutputMode_();
+  }
+  int room = stream_->availableForWrite();
+  const uint8_t *chunk = nullptr;
+  while (room > 0) {
+    size_t length = tx_.peek(chunk);
+    if (length == 0) {
+      return;
     }
-    if (json[i] != '"' || countOut >= maxValues) {
-      return false;
+    if (length > static_cast<size_t>(room)) {
+      length = static_cast<size_t>(room);
     }
+    stream_->write(chunk, length);
+    tx_.consume(length);
+    room -= static_cast<int>(length);
+  }
+}
 
-    i++;
-    String item;
-    bool escaped = false;
-    while (i < json.length()) {
-      const char ch = json[i++];
-      if (escaped) {
-        item += ch;
-        escaped = false;
-        continue;
-      }
-      if (ch == '\\') {
-        escaped = true;
-        continue;
-      }
-      if (ch == '"') {
-        break;
-      }
-      item += ch;
-    }
-    valuesOut[countOut++] = item;
+void SerialProtocol::sendAck(const char *command) {
+  beginAck(command);
+  send();
+}
 
-    while (i < json.length() && isspace(json[i])) {
-      i++;
-    }
-    if (i < json.length() && json[i] == ',') {
-      i++;
-      continue;
-    }
-    if (i < json.length() && json[i] == ']') {
-      return true;
-    }
-  }
+void SerialProtocol::sendError(const char *code, const char *message) {
+  beginError(code, message);
+  send();
+}
 
-  return false;
+void SerialProtocol::sendEvent(const char *eventType) {
+  beginEvent(eventType);
+  send();
 }
 
-String SerialProtocol::escape(const String &value) {
-  String out;
-  out.reserve(value.length() + 8);
-  for (size_t i = 0; i < value.length(); i++) {
-    const char ch = value[i];
-    if (ch == '\\' || ch == '"') {
-      out += '\\';
-    }
-    out += ch;
-  }
-  return out;
+FrameWriter &SerialProtocol::beginFrame_(const char *type, TxPriority priority) {
+  frame_priority_ = priority;
+  frame_captured_ = false;
+  if (output_mode_ == LinkMode::Binary) {
+    // Payload starts after the COBS code byte; the CRC and the delimiter
+    // follow it.
+    binary_writer_.reset(tx_frame_ + 1, TX_FRAME_CAPACITY - 3);
+  } else {
+    json_writer_.reset(tx_frame_, TX_FRAME_CAPACITY);
+  }
+  return writer_->beginObject().field("type", type);
 }
 
-void SerialProtocol::sendObject_(const char *type, const String &fields) {
-  if (stream_ == nullptr) {
-    return;
+FrameWriter &SerialProtocol::appendSequence_(FrameWriter &writer) {
+  if (sequence_ != NO_SEQUENCE) {
+    writer.field("seq", sequence_);
   }
+  return writer;
+}
+
+const char *SerialProtocol::linkModeName(LinkMode mode) {
+  return mode == LinkMode::Binary ? "binary" : "json";
+}
 
-  String line = String("{\"type\":\"") + escape(type) + "\"";
-  if (fields.length() > 0) {
-    line += ",";
-    line += fields;
+bool SerialProtocol::checkLineCrc_(LineView &line) {
+  static constexpr size_t SUFFIX_LENGTH = 5;
+  uint16_t expected = 0;
+  bool valid = line.length > SUFFIX_LENGTH && line.data[line.length - SUFFIX_LENGTH] == '*';
+  for (size_t i = line.length - SUFFIX_LENGTH + 1; valid && i < line.length; i++) {
+    const char ch = line.data[i];
+    const uint8_t nibble = ch >= '0' && ch <= '9'   ? ch - '0'
+                           : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10
+                                                    : 0xFF;
+    valid = nibble != 0xFF;
+    expected = static_cast<uint16_t>((expected << 4) | nibble);
+  }
+  const size_t body = valid ? line.length - SUFFIX_LENGTH : line.length;
+  if (!valid || crc16Ccitt(reinterpret_cast<const uint8_t *>(line.data), body) != expected) {
+    sendError("crc_mismatch", "Line CRC missing or wrong");
+    return false;
   }
-  line += "}";
-  stream_->println(line);
+  line.length = body;
+  line.data[body] = '\0';
+  return true;
 }
 
-int SerialProtocol::findKeyValueStart_(const String &json, const char *key) {
-  const String pattern = String("\"") + key + "\"";
-  const int keyIndex = json.indexOf(pattern);
-  if (keyIndex < 0) {
-    return -1;
+void SerialProtocol::switchOutputMode_() {
+  output_mode_ = input_mode_;
+  if (output_mode_ == LinkMode::Binary) {
+    writer_ = &binary_writer_;
+  } else {
+    writer_ = &json_writer_;
   }
+  beginEvent("link_mode", TxPriority::Ack).field("mode", linkModeName(output_mode_));
+  send();
+}
 
-  int colonIndex = json.indexOf(':', keyIndex + pattern.length());
-  if (colonIndex < 0) {
-    return -1;
+FrameWriter &SerialProtocol::appendCredit_(FrameWriter &writer) {
+  // Captured frames are never sent, so they must not consume a report.
+  const uint16_t unreported = static_cast<uint16_t>(rx_bytes_ - rx_reported_);
+  if (capturing_ || stream_ == nullptr || unreported == 0) {
+    return writer;
+  }
+  if (unreported >= RX_CREDIT_REPORT_BYTES || stream_->available() == 0) {
+    writer.field("rx_bytes", rx_bytes_);
+    rx_reported_ = rx_bytes_;
   }
-  colonIndex++;
-  while (colonIndex < json.length() && isspace(json[colonIndex])) {
-    colonIndex++;
+  return writer;
+}
+
+void SerialProtocol::captureStatus_(const char *status) {
+  if (capturing_) {
+    frame_captured_ = true;
+    captured_status_ = status;
   }
-  return colonIndex;
 }
@@ -2,28 +2,123 @@
 
 #include <Arduino.h>
 
+#include "binary_frame.h"
+#include "compact_fields.h"
+#include "json_writer.h"
+#include "rx_line_buffer.h"
+#include "tx_queue.h"
+
+// Json: newline-terminated JSON out, plain lines in. Binary: COBS frames out
+// (binary_frame.h), and every line in must end with "*XXXX", the uppercase
+// hex CRC-16 of the bytes before the '*'.
+enum class LinkMode : uint8_t { Json, Binary };
+
 class SerialProtocol {
  public:
-  void begin(Stream &stream);
-  bool pollLine(String &line);
+  // `rxRingCapacity` is the size of the stream's interrupt-filled RX ring.
+  // Finding that ring full counts as an RX overflow: the ISR discards bytes
+  // that arrive while it is full.
+  void begin(Stream &stream, size_t rxRingCapacity = 0);
+  bool pollLine(LineView &line);
+  uint16_t rxOverflows() const { return rx_overflows_; }
+
+  // Moves waiting bytes from the RX ring into the line buffer. pollLine()
+  // does this itself; calling it between long phases bounds how long an
+  // EMERGENCY_STOP_BYTE can sit unread. The handler runs as soon as the byte
+  // is read, before anything is parsed, so it must not send frames.
+  // `nowUs` is micros() taken just before the call; callers that have one
+  // pass it on rather than pay for another read.
+  void pumpRx(uint32_t nowUs);
+  typedef void (*EmergencyStopHandler)();
+  void setEmergencyStopHandler(EmergencyStopHandler handler) { emergency_stop_handler_ = handler; }
+  // True once after each EMERGENCY_STOP_BYTE. `arrivedAfterUs` is when the RX
+  // ring was last seen empty before it: the byte cannot be older than that.
+  bool takeEmergencyStop(uint32_t &arrivedAfterUs);
+  // Running count of EMERGENCY_STOP_BYTEs read (mod 256). A line is stale
+  // once it changes after pollLine() handed the line out.
+  uint8_t emergencyStops() const { return emergency_stops_; }
+
+  // Credit flow control: the Pi may have at most rxWindow() bytes that the
+  // firmware has not read yet. Acks and errors carry "rx_bytes", the running
+  // count of bytes read (mod 2^16), whenever RX_CREDIT_REPORT_BYTES have been
+  // read since the last report or the RX ring has run empty.
+  uint16_t rxWindow() const { return rx_ring_capacity_ > 0 ? rx_ring_capacity_ - 1 : 0; }
+
+  // Input checks change at once. Output changes once the TX queue is empty so
+  // queued frames keep their framing; the first frame in the new mode is a
+  // link_mode event.
+  void setLinkMode(LinkMode mode) { input_mode_ = mode; }
+  LinkMode linkMode() const { return input_mode_; }
+  static const char *linkModeName(LinkMode mode);
 
-  void sendAck(const char *command, const String &extraFields = "");
-  void sendError(const char *code, const String &message, const String &extraFields = "");
-  void sendEvent(const char *eventType, const String &extraFields = "");
+  // begin*() open a frame in the TX buffer; add fields on the returned writer,
+  // then call send(), which queues the frame without waiting for the UART.
+  // Only one frame can be open at a time. Events default to TxPriority::Event,
+  // or TxPriority::Debug when the type starts with "debug_".
+  FrameWriter &beginAck(const char *command, TxPriority priority = TxPriority::Ack);
+  FrameWriter &beginError(const char *code, const char *message);
+  FrameWriter &beginEvent(const char *eventType);
+  FrameWriter &beginEvent(const char *eventType, TxPriority priority);
+  void send();
 
-  static bool extractString(const String &json, const char *key, String &valueOut);
-  static bool extractInt(const String &json, const char *key, int &valueOut);
-  static bool extractBool(const String &json, const char *key, bool &valueOut);
-  static bool extractStringArray(const String &json, const char *key, String *valuesOut,
-                                 size_t maxValues, size_t &countOut);
-  static String escape(const String &value);
+  // Sequence id of the command being handled; echoed as "seq" in every ack
+  // and error until it is reset to NO_SEQUENCE.
+  void setSequence(int32_t sequence) { sequence_ = sequence; }
+
+  // While capturing, acks and errors are not sent; the last one is recorded
+  // instead. endCapture() returns "ok" for an ack (or nothing sent) and the
+  // error code otherwise. Events are sent as usual.
+  void beginCapture();
+  const char *endCapture();
+
+  // Moves queued frames into the UART, never more than availableForWrite().
+  void drainTx();
+  bool txIdle() const { return tx_.idle(); }
+  // Drops a partially received line, e.g. after the UART changed rate.
+  void discardInput() { rx_.clear(); }
+  uint16_t txDropped(TxPriority priority) const { return tx_.dropped(priority); }
+
+  void sendAck(const char *command);
+  void sendError(const char *code, const char *message);
+  void sendEvent(const char *eventType);
 
  private:
   Stream *stream_ = nullptr;
-  static constexpr size_t BUFFER_CAPACITY = 384;
-  char buffer_[BUFFER_CAPACITY];
-  size_t used_ = 0;
+  static constexpr size_t TX_FRAME_CAPACITY = 192;
+  RxLineBuffer rx_;
+  size_t rx_ring_capacity_ = 0;
+  uint16_t rx_overflows_ = 0;
+  static constexpr uint16_t RX_CREDIT_REPORT_BYTES = 64;
+  uint16_t rx_bytes_ = 0;
+  uint16_t rx_reported_ = 0;
+  uint32_t rx_idle_us_ = 0;
+  EmergencyStopHandler emergency_stop_handler_ = nullptr;
+  bool emergency_stop_pending_ = false;
+  uint8_t emergency_stops_ = 0;
+  uint32_t emergency_stop_after_us_ = 0;
+  // One spare byte for the '\n' terminator appended by send().
+  char tx_frame_[TX_FRAME_CAPACITY + 1];
+  JsonWriter json_writer_;
+  BinaryFrameWriter binary_writer_;
+  FrameWriter *writer_ = &json_writer_;
+  LinkMode input_mode_ = LinkMode::Json;
+  LinkMode output_mode_ = LinkMode::Json;
+  TxPriority frame_priority_ = TxPriority::Ack;
+  int32_t sequence_ = NO_SEQUENCE;
+  bool capturing_ = false;
+  bool frame_captured_ = false;
+  const char *captured_status_ = nullptr;
+  TxQueue tx_;
+
+  static_assert(TX_FRAME_CAPACITY + 1 <= TxQueue::MAX_FRAME_LENGTH,
+                "A full TX frame must fit in the TX queue");
+  static_assert(TX_FRAME_CAPACITY - 3 <= binary_frame::MAX_PAYLOAD,
+                "A full binary payload must fit in one COBS block");
 
-  void sendObject_(const char *type, const String &fields);
-  static int findKeyValueStart_(const String &json, const char *key);
+  FrameWriter &beginFrame_(const char *type, TxPriority priority);
+  FrameWriter &appendSequence_(FrameWriter &writer);
+  FrameWriter &appendCredit_(FrameWriter &writer);
+  void captureStatus_(const char *status);
+  bool checkLineCrc_(LineView &line);
+  void switchOutputMode_();
 };
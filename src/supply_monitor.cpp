@@ -0,0 +1,52 @@
+#include "supply_monitor.h"
+
+namespace {
+constexpr uint16_t ADC_MAX = 1023;
+constexpr uint16_t NEUTRAL_SCALE = 1000;
+}  // namespace
+
+void SupplyMonitor::begin(const SupplyConfig &config, AdcReader reader) {
+  config_ = config;
+  reader_ = reader;
+  filtered_ = 0;
+  primed_ = false;
+}
+
+bool SupplyMonitor::update(uint32_t nowMs) {
+  if (reader_ == nullptr || (primed_ && nowMs - last_sample_ms_ < config_.samplePeriodMs)) {
+    return false;
+  }
+  last_sample_ms_ = nowMs;
+  const uint32_t sample = toMillivolts(config_, reader_());
+  if (!primed_) {
+    filtered_ = sample << config_.filterShift;
+    primed_ = true;
+  } else {
+    filtered_ = filtered_ - (filtered_ >> config_.filterShift) + sample;
+  }
+  return true;
+}
+
+uint16_t SupplyMonitor::millivolts() const {
+  return static_cast<uint16_t>(filtered_ >> config_.filterShift);
+}
+
+uint16_t SupplyMonitor::scalePermille(uint16_t nominalMv) const {
+  const uint16_t measured = millivolts();
+  if (nominalMv == 0 || !primed_ || measured < config_.minValidMv) {
+    return NEUTRAL_SCALE;
+  }
+  uint32_t scale = (static_cast<uint32_t>(nominalMv) * 1000UL + measured / 2) / measured;
+  if (scale < config_.minScalePermille) {
+    scale = config_.minScalePermille;
+  } else if (scale > config_.maxScalePermille) {
+    scale = config_.maxScalePermille;
+  }
+  return static_cast<uint16_t>(scale);
+}
+
+uint16_t SupplyMonitor::toMillivolts(const SupplyConfig &config, uint16_t raw) {
+  const uint32_t pinMv = (static_cast<uint32_t>(raw) * config.adcFullScaleMv + ADC_MAX / 2) / ADC_MAX;
+  const uint32_t supplyMv = (pinMv * config.dividerPermille + 500) / 1000;
+  return supplyMv > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(supplyMv);
+}
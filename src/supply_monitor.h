@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// How a raw divider reading becomes a supply voltage, and how far the PWM
+// may be stretched to make up for a sagging or fresh pack.
+struct SupplyConfig {
+  // Pin voltage at a reading of 1023 (the ADC reference).
+  uint16_t adcFullScaleMv;
+  // Supply voltage over pin voltage, times 1000.
+  uint16_t dividerPermille;
+  // Readings below this mean no pack is connected (USB power, divider
+  // missing); compensation is then off.
+  uint16_t minValidMv;
+  uint16_t minScalePermille;
+  uint16_t maxScalePermille;
+  uint16_t samplePeriodMs;
+  // Exponential filter weight of a new sample: 1 / 2^filterShift.
+  uint8_t filterShift;
+};
+
+// Returns a raw 10-bit ADC reading; analogRead on the robot, a fake in tests.
+typedef uint16_t (*AdcReader)();
+
+// Low-rate, filtered supply voltage and the PWM factor that holds the motor
+// voltage at what it was when the timings were calibrated.
+class SupplyMonitor {
+ public:
+  void begin(const SupplyConfig &config, AdcReader reader);
+  // Takes a sample once samplePeriodMs has passed; returns whether it did.
+  bool update(uint32_t nowMs);
+  // Filtered supply voltage; 0 before the first sample.
+  uint16_t millivolts() const;
+  // nominalMv / measured, in permille and clamped to the configured range;
+  // 1000 (no change) when nominalMv is 0 or there is no valid reading.
+  uint16_t scalePermille(uint16_t nominalMv) const;
+
+  static uint16_t toMillivolts(const SupplyConfig &config, uint16_t raw);
+
+ private:
+  SupplyConfig config_ = {};
+  AdcReader reader_ = nullptr;
+  uint32_t last_sample_ms_ = 0;
+  // Filtered millivolts, shifted left by filterShift.
+  uint32_t filtered_ = 0;
+  bool primed_ = false;
+};
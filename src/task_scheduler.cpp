@@ -0,0 +1,73 @@
+#include "task_scheduler.h"
+
+#include <string.h>
+
+namespace {
+constexpr uint16_t COUNTER_MAX = 0xFFFF;
+}  // namespace
+
+void TaskScheduler::begin(const TaskSpec *specs, uint8_t count, uint32_t nowUs) {
+  specs_ = specs;
+  count_ = count < MAX_TASKS ? count : MAX_TASKS;
+  memset(stats_, 0, sizeof(stats_));
+  for (uint8_t i = 0; i < count_; i++) {
+    release_us_[i] = nowUs;
+  }
+}
+
+uint8_t TaskScheduler::nextDue(uint32_t nowUs) const {
+  uint8_t best = NO_TASK;
+  int32_t bestSlack = 0;
+  bool bestCritical = false;
+  for (uint8_t i = 0; i < count_; i++) {
+    if (!due_(i, nowUs)) {
+      continue;
+    }
+    // Time left until the deadline; negative once it has passed.
+    const int32_t slack = static_cast<int32_t>(release_us_[i] + specs_[i].periodUs - nowUs);
+    const bool critical = specs_[i].critical;
+    if (best == NO_TASK || (critical && !bestCritical) ||
+        (critical == bestCritical && slack < bestSlack)) {
+      best = i;
+      bestSlack = slack;
+      bestCritical = critical;
+    }
+  }
+  return best;
+}
+
+bool TaskScheduler::criticalDue(uint32_t nowUs) const {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (specs_[i].critical && due_(i, nowUs)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::finish(uint8_t index, uint32_t startUs, uint32_t endUs) {
+  if (index >= count_) {
+    return;
+  }
+  TaskStats &stats = stats_[index];
+  const uint32_t runUs = endUs - startUs;
+  stats.lastRunUs = runUs;
+  if (runUs > stats.maxRunUs) {
+    stats.maxRunUs = runUs;
+  }
+  if (stats.runs < COUNTER_MAX) {
+    stats.runs++;
+  }
+  if (runUs > specs_[index].budgetUs && stats.overruns < COUNTER_MAX) {
+    stats.overruns++;
+  }
+
+  const uint32_t deadline = release_us_[index] + specs_[index].periodUs;
+  if (static_cast<int32_t>(endUs - deadline) > 0 && stats.late < COUNTER_MAX) {
+    stats.late++;
+  }
+  // Releases missed while the loop was blocked are dropped, not replayed: a
+  // late task is re-anchored to the time it actually started.
+  release_us_[index] =
+      static_cast<int32_t>(endUs - deadline) > 0 ? startUs + specs_[index].periodUs : deadline;
+}
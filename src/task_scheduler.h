@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Static description of one main-loop task. `budgetUs` is the longest a single
+// run should take; longer runs are counted as overruns.
+struct TaskSpec {
+  const char *name;
+  uint32_t periodUs;
+  uint32_t budgetUs;
+  bool critical;
+};
+
+struct TaskStats {
+  uint32_t lastRunUs;
+  uint32_t maxRunUs;
+  uint16_t runs;
+  uint16_t overruns;
+  // Runs that finished after their deadline (release + period).
+  uint16_t late;
+};
+
+// Cooperative earliest-deadline-first scheduler. It only decides which task
+// runs next and keeps statistics; the caller runs the task and reports the
+// start and end times. A due critical task always goes before any other, and
+// long-running tasks can poll criticalDue() to yield between work items.
+// Times are micros() values and may wrap.
+class TaskScheduler {
+ public:
+  static constexpr uint8_t MAX_TASKS = 8;
+  static constexpr uint8_t NO_TASK = 0xFF;
+
+  // `specs` must outlive the scheduler. Every task is due at `nowUs`.
+  void begin(const TaskSpec *specs, uint8_t count, uint32_t nowUs);
+
+  // Index of the task to run now, or NO_TASK when nothing is due.
+  uint8_t nextDue(uint32_t nowUs) const;
+  bool criticalDue(uint32_t nowUs) const;
+  void finish(uint8_t index, uint32_t startUs, uint32_t endUs);
+
+  uint8_t count() const { return count_; }
+  const TaskSpec &spec(uint8_t index) const { return specs_[index]; }
+  const TaskStats &stats(uint8_t index) const { return stats_[index]; }
+
+ private:
+  const TaskSpec *specs_ = nullptr;
+  uint8_t count_ = 0;
+  uint32_t release_us_[MAX_TASKS];
+  TaskStats stats_[MAX_TASKS];
+
+  bool due_(uint8_t index, uint32_t nowUs) const {
+    return static_cast<int32_t>(nowUs - release_us_[index]) >= 0;
+  }
+};
@@ -0,0 +1,98 @@
+#include "tx_queue.h"
+
+bool TxQueue::push(TxPriority priority, const char *data, size_t length) {
+  Ring &ring = rings_[static_cast<uint8_t>(priority)];
+  if (length == 0 || length > MAX_FRAME_LENGTH) {
+    ring.dropped++;
+    return false;
+  }
+
+  const uint16_t needed = static_cast<uint16_t>(length + 1);
+  if (priority == TxPriority::Debug) {
+    while (ring.capacity - ring.used < needed) {
+      dropOldest_(ring);
+    }
+  }
+  if (ring.capacity - ring.used < needed) {
+    ring.dropped++;
+    return false;
+  }
+
+  pushByte_(ring, static_cast<uint8_t>(length));
+  for (size_t i = 0; i < length; i++) {
+    pushByte_(ring, static_cast<uint8_t>(data[i]));
+  }
+  return true;
+}
+
+size_t TxQueue::peek(const uint8_t *&dataOut) {
+  if (active_sent_ >= active_length_ && !activateNext_()) {
+    return 0;
+  }
+  dataOut = active_ + active_sent_;
+  return active_length_ - active_sent_;
+}
+
+void TxQueue::consume(size_t count) {
+  const size_t remaining = active_length_ - active_sent_;
+  active_sent_ += static_cast<uint8_t>(count < remaining ? count : remaining);
+}
+
+bool TxQueue::idle() const {
+  if (active_sent_ < active_length_) {
+    return false;
+  }
+  for (const Ring &ring : rings_) {
+    if (ring.used > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint16_t TxQueue::dropped(TxPriority priority) const {
+  return rings_[static_cast<uint8_t>(priority)].dropped;
+}
+
+uint8_t TxQueue::popByte_(Ring &ring) {
+  const uint8_t value = storage_[ring.base + ring.head];
+  ring.head = ring.head + 1 == ring.capacity ? 0 : ring.head + 1;
+  ring.used--;
+  return value;
+}
+
+void TxQueue::pushByte_(Ring &ring, uint8_t value) {
+  uint16_t tail = ring.head + ring.used;
+  if (tail >= ring.capacity) {
+    tail -= ring.capacity;
+  }
+  storage_[ring.base + tail] = value;
+  ring.used++;
+}
+
+void TxQueue::dropOldest_(Ring &ring) {
+  const uint16_t skip = popByte_(ring);
+  ring.used -= skip;
+  ring.head += skip;
+  if (ring.head >= ring.capacity) {
+    ring.head -= ring.capacity;
+  }
+  ring.dropped++;
+}
+
+bool TxQueue::activateNext_() {
+  active_length_ = 0;
+  active_sent_ = 0;
+  for (Ring &ring : rings_) {
+    if (ring.used == 0) {
+      continue;
+    }
+    const uint8_t length = popByte_(ring);
+    for (uint8_t i = 0; i < length; i++) {
+      active_[i] = popByte_(ring);
+    }
+    active_length_ = length;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Outbound frame classes, highest priority first.
+enum class TxPriority : uint8_t {
+  Motion,  // motion_done events and stop acks
+  Ack,     // command acks and errors
+  Event,   // keypad, switch, RFID and state events
+  Debug,   // debug_* events
+};
+
+static constexpr uint8_t TX_PRIORITY_COUNT = 4;
+
+// Per-priority byte rings of complete outbound frames. The transmitter always
+// takes the oldest frame of the highest non-empty class and finishes it before
+// starting another, so frames are never interleaved on the wire. Full rings
+// drop the incoming frame, except Debug, which evicts its oldest frames first.
+// Nothing here blocks; callers drain as much as the UART can take.
+class TxQueue {
+ public:
+  static constexpr size_t MAX_FRAME_LENGTH = 200;
+
+  // Copies `length` bytes in as one frame. Returns false (and counts a drop)
+  // if the frame could not be queued.
+  bool push(TxPriority priority, const char *data, size_t length);
+
+  // Exposes the unsent part of the frame currently on the wire, promoting the
+  // next queued frame when the previous one has finished. Returns 0 when idle.
+  size_t peek(const uint8_t *&dataOut);
+  void consume(size_t count);
+
+  bool idle() const;
+  uint16_t dropped(TxPriority priority) const;
+
+ private:
+  // A motion_done, the stop ack that cuts its route and an estop event can
+  // all be waiting at once; none of them may be dropped.
+  static constexpr uint16_t MOTION_FRAMES = 3;
+  static constexpr uint16_t MOTION_CAPACITY = MOTION_FRAMES * (MAX_FRAME_LENGTH + 1);
+  static constexpr uint16_t ACK_CAPACITY = 384;
+  static constexpr uint16_t EVENT_CAPACITY = 384;
+  static constexpr uint16_t DEBUG_CAPACITY = 256;
+  static constexpr uint16_t STORAGE_CAPACITY =
+      MOTION_CAPACITY + ACK_CAPACITY + EVENT_CAPACITY + DEBUG_CAPACITY;
+
+  struct Ring {
+    uint16_t base;
+    uint16_t capacity;
+    uint16_t head;
+    uint16_t used;
+    uint16_t dropped;
+  };
+
+  uint8_t storage_[STORAGE_CAPACITY];
+  Ring rings_[TX_PRIORITY_COUNT] = {
+      {0, MOTION_CAPACITY, 0, 0, 0},
+      {MOTION_CAPACITY, ACK_CAPACITY, 0, 0, 0},
+      {MOTION_CAPACITY + ACK_CAPACITY, EVENT_CAPACITY, 0, 0, 0},
+      {MOTION_CAPACITY + ACK_CAPACITY + EVENT_CAPACITY, DEBUG_CAPACITY, 0, 0, 0},
+  };
+  uint8_t active_[MAX_FRAME_LENGTH];
+  uint8_t active_length_ = 0;
+  uint8_t active_sent_ = 0;
+
+  static_assert(MAX_FRAME_LENGTH <= 0xFF, "Frame lengths are stored in one byte");
+  static_assert(MOTION_CAPACITY > MAX_FRAME_LENGTH && ACK_CAPACITY > MAX_FRAME_LENGTH &&
+                    EVENT_CAPACITY > MAX_FRAME_LENGTH && DEBUG_CAPACITY > MAX_FRAME_LENGTH,
+                "Every ring must hold at least one maximum-size frame");
+  static_assert(MOTION_CAPACITY >= MOTION_FRAMES * (MAX_FRAME_LENGTH + 1),
+                "The Motion ring must hold MOTION_FRAMES maximum-size frames");
+
+  uint8_t popByte_(Ring &ring);
+  void pushByte_(Ring &ring, uint8_t value);
+  void dropOldest_(Ring &ring);
+  bool activateNext_();
+};
@@ -0,0 +1,66 @@
+#include "wheel_encoders.h"
+
+#include <util/atomic.h>
+
+#include "encoder_control.h"
+#include "runtime_config.h"
+
+namespace {
+volatile int32_t gTicks[2] = {0, 0};
+volatile int8_t gDriven[2] = {1, 1};
+// Input registers and bit masks of both channels, [wheel][channel], read
+// directly: digitalRead() would triple the time spent in the interrupt.
+volatile uint8_t *gInput[2][2] = {{nullptr, nullptr}, {nullptr, nullptr}};
+uint8_t gMask[2][2] = {{0, 0}, {0, 0}};
+
+void mapPin(uint8_t wheel, uint8_t channel, uint8_t pin) {
+  pinMode(pin, INPUT_PULLUP);
+  gInput[wheel][channel] = portInputRegister(digitalPinToPort(pin));
+  gMask[wheel][channel] = digitalPinToBitMask(pin);
+}
+
+inline bool readChannel(uint8_t wheel, uint8_t channel) {
+  return (*gInput[wheel][channel] & gMask[wheel][channel]) != 0;
+}
+
+inline void countEdge(uint8_t wheel, bool reversed) {
+  if (ENCODER_MODE == EncoderMode::Quadrature) {
+    const int8_t step = quadratureStep(readChannel(wheel, 0), readChannel(wheel, 1));
+    gTicks[wheel] += reversed ? -step : step;
+  } else {
+    gTicks[wheel] += gDriven[wheel];
+  }
+}
+
+void onLeftEdge() { countEdge(0, ENCODER_LEFT_REVERSED); }
+
+void onRightEdge() { countEdge(1, ENCODER_RIGHT_REVERSED); }
+}  // namespace
+
+void WheelEncoders::begin() {
+  if (ENCODER_MODE == EncoderMode::None) {
+    return;
+  }
+  mapPin(0, 0, ENCODER_LEFT_A_PIN);
+  mapPin(1, 0, ENCODER_RIGHT_A_PIN);
+  // Both edges of A in quadrature mode double the resolution.
+  const int edge = ENCODER_MODE == EncoderMode::Quadrature ? CHANGE : RISING;
+  if (ENCODER_MODE == EncoderMode::Quadrature) {
+    mapPin(0, 1, ENCODER_LEFT_B_PIN);
+    mapPin(1, 1, ENCODER_RIGHT_B_PIN);
+  }
+  attachInterrupt(digitalPinToInterrupt(ENCODER_LEFT_A_PIN), onLeftEdge, edge);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_RIGHT_A_PIN), onRightEdge, edge);
+}
+
+void WheelEncoders::setDirection(bool leftForward, bool rightForward) {
+  gDriven[0] = singleChannelStep(leftForward);
+  gDriven[1] = singleChannelStep(rightForward);
+}
+
+void WheelEncoders::read(int32_t &left, int32_t &right) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    left = gTicks[0];
+    right = gTicks[1];
+  }
+}
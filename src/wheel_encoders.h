@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Wheel encoder counts, kept by the external interrupts on each wheel's
+// channel A. With ENCODER_MODE None nothing is attached and both counts stay
+// 0, so the drive runs on time alone.
+class WheelEncoders {
+ public:
+  static void begin();
+  // Single-channel encoders cannot tell direction: their edges count the way
+  // the wheels were last driven, as set here. Quadrature ignores it.
+  static void setDirection(bool leftForward, bool rightForward);
+  // Counts since begin(), forward positive.
+  static void read(int32_t &left, int32_t &right);
+};
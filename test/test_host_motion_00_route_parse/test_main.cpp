@@ -0,0 +1,117 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/motion_route.h"
+
+static MotionStep gSteps[MOTION_QUEUE_CAPACITY];
+
+static uint8_t parse(const char *route, uint8_t &errorIndex) {
+  return parseRoute(route, strlen(route), gSteps, MOTION_QUEUE_CAPACITY, errorIndex);
+}
+
+void test_aliases_names_and_durations() {
+  uint8_t errorIndex = 0;
+  TEST_ASSERT_EQUAL_UINT8(5, parse("f,b,l:480,turn_right,forward_cell:1800", errorIndex));
+  TEST_ASSERT_EQUAL(MotionAction::ForwardCell, gSteps[0].action);
+  TEST_ASSERT_EQUAL_UINT32(0, gSteps[0].durationMs);
+  TEST_ASSERT_EQUAL(MotionAction::ReverseCell, gSteps[1].action);
+  TEST_ASSERT_EQUAL(MotionAction::TurnLeft, gSteps[2].action);
+  TEST_ASSERT_EQUAL_UINT32(480, gSteps[2].durationMs);
+  TEST_ASSERT_EQUAL(MotionAction::TurnRight, gSteps[3].action);
+  TEST_ASSERT_EQUAL(MotionAction::ForwardCell, gSteps[4].action);
+  TEST_ASSERT_EQUAL_UINT32(1800, gSteps[4].durationMs);
+}
+
+void test_segments_carry_a_cell_count() {
+  uint8_t errorIndex = 0;
+  TEST_ASSERT_EQUAL_UINT8(4, parse("f*5,forward_n*3:2400,b,l*2", errorIndex));
+  TEST_ASSERT_EQUAL(MotionAction::ForwardCell, gSteps[0].action);
+  TEST_ASSERT_EQUAL_UINT8(5, gSteps[0].cells);
+  TEST_ASSERT_EQUAL_UINT32(0, gSteps[0].durationMs);
+  TEST_ASSERT_EQUAL(MotionAction::ForwardCell, gSteps[1].action);
+  TEST_ASSERT_EQUAL_UINT8(3, gSteps[1].cells);
+  TEST_ASSERT_EQUAL_UINT32(2400, gSteps[1].durationMs);
+  TEST_ASSERT_EQUAL_UINT8(1, gSteps[2].cells);
+  TEST_ASSERT_EQUAL(MotionAction::TurnLeft, gSteps[3].action);
+  TEST_ASSERT_EQUAL_UINT8(2, gSteps[3].cells);
+
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f*0", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f,f*256", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(1, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f*:100", errorIndex));
+  TEST_ASSERT_EQUAL_STRING("forward_cell", motionActionName(gSteps[0].action));
+}
+
+void test_bad_step_reports_its_index() {
+  uint8_t errorIndex = 0;
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f,f,x", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(2, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f,l:", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(1, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f:12a", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(0, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f:99999999", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(0, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f,", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(1, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(0, errorIndex);
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("forward", errorIndex));
+}
+
+void test_route_longer_than_the_queue_is_rejected() {
+  uint8_t errorIndex = 0;
+  TEST_ASSERT_EQUAL_UINT8(16, parse("f,f,f,f,f,f,f,f,f,f,f,f,f,f,f,f", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(ROUTE_INVALID, parse("f,f,f,f,f,f,f,f,f,f,f,f,f,f,f,f,f", errorIndex));
+  TEST_ASSERT_EQUAL_UINT8(MOTION_QUEUE_CAPACITY, errorIndex);
+}
+
+void test_action_names_round_trip() {
+  MotionAction action = MotionAction::Idle;
+  TEST_ASSERT_TRUE(findMotionAction("turn_left", 9, action));
+  TEST_ASSERT_EQUAL_STRING("turn_left", motionActionName(action));
+  TEST_ASSERT_FALSE(findMotionAction("stop", 4, action));
+  TEST_ASSERT_EQUAL_STRING("idle", motionActionName(MotionAction::Idle));
+}
+
+void test_arcs_parse_and_run_on_from_forward_cells() {
+  uint8_t errorIndex = 0;
+  TEST_ASSERT_EQUAL_UINT8(4, parse("f*2,L,arc_right:1500,l", errorIndex));
+  TEST_ASSERT_EQUAL(MotionAction::ArcLeft, gSteps[1].action);
+  TEST_ASSERT_EQUAL(MotionAction::ArcRight, gSteps[2].action);
+  TEST_ASSERT_EQUAL_UINT32(1500, gSteps[2].durationMs);
+  TEST_ASSERT_EQUAL_STRING("arc_left", motionActionName(MotionAction::ArcLeft));
+
+  TEST_ASSERT_TRUE(runsOnAtSpeed(MotionAction::ForwardCell, MotionAction::ArcLeft));
+  TEST_ASSERT_TRUE(runsOnAtSpeed(MotionAction::ArcLeft, MotionAction::ArcRight));
+  TEST_ASSERT_TRUE(runsOnAtSpeed(MotionAction::TurnLeft, MotionAction::TurnLeft));
+  TEST_ASSERT_FALSE(runsOnAtSpeed(MotionAction::ArcRight, MotionAction::TurnLeft));
+  TEST_ASSERT_FALSE(runsOnAtSpeed(MotionAction::ReverseCell, MotionAction::ForwardCell));
+  TEST_ASSERT_FALSE(runsOnAtSpeed(MotionAction::Idle, MotionAction::Idle));
+}
+
+void test_stop_counts_a_step_the_alarm_cut_as_done() {
+  // Route of 5, running step 2 (next is 3).
+  TEST_ASSERT_EQUAL_UINT8(3, stoppedRouteDropped(5, 3, false));
+  TEST_ASSERT_EQUAL_UINT8(2, stoppedRouteDropped(5, 3, true));
+  // The last step, cut by its deadline but not yet retired: nothing is lost.
+  TEST_ASSERT_EQUAL_UINT8(0, stoppedRouteDropped(5, 5, true));
+  TEST_ASSERT_EQUAL_UINT8(1, stoppedRouteDropped(1, 1, false));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_aliases_names_and_durations);
+  RUN_TEST(test_segments_carry_a_cell_count);
+  RUN_TEST(test_bad_step_reports_its_index);
+  RUN_TEST(test_route_longer_than_the_queue_is_rejected);
+  RUN_TEST(test_action_names_round_trip);
+  RUN_TEST(test_arcs_parse_and_run_on_from_forward_cells);
+  RUN_TEST(test_stop_counts_a_step_the_alarm_cut_as_done);
+  return UNITY_END();
+}
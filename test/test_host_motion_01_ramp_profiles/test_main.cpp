@@ -0,0 +1,76 @@
+#include <unity.h>
+
+#include "../../src/motion_ramp.h"
+
+void test_ramps_start_at_zero_and_reach_the_target() {
+  TEST_ASSERT_EQUAL_UINT8(0, rampPwm(RampProfile::Linear, 0, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(0, rampPwm(RampProfile::SCurve, 0, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(55, rampPwm(RampProfile::Linear, 60000, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(55, rampPwm(RampProfile::SCurve, 60000, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(110, rampPwm(RampProfile::Linear, 120000, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(110, rampPwm(RampProfile::SCurve, 500000, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(110, rampPwm(RampProfile::Step, 0, 120000, 110));
+  TEST_ASSERT_EQUAL_UINT8(110, rampPwm(RampProfile::Linear, 0, 0, 110));
+}
+
+void test_ramps_are_monotonic_and_s_curve_starts_gently() {
+  uint8_t previousLinear = 0;
+  uint8_t previousCurve = 0;
+  for (uint32_t t = 0; t <= 120000; t += 1000) {
+    const uint8_t linear = rampPwm(RampProfile::Linear, t, 120000, 255);
+    const uint8_t curve = rampPwm(RampProfile::SCurve, t, 120000, 255);
+    TEST_ASSERT_TRUE(linear >= previousLinear);
+    TEST_ASSERT_TRUE(curve >= previousCurve);
+    previousLinear = linear;
+    previousCurve = curve;
+  }
+  TEST_ASSERT_TRUE(rampPwm(RampProfile::SCurve, 15000, 120000, 255) <
+                   rampPwm(RampProfile::Linear, 15000, 120000, 255));
+  TEST_ASSERT_TRUE(rampPwm(RampProfile::SCurve, 105000, 120000, 255) >
+                   rampPwm(RampProfile::Linear, 105000, 120000, 255));
+}
+
+void test_ramp_area_is_half_for_symmetric_tables() {
+  TEST_ASSERT_EQUAL_UINT16(500, rampAreaPermille(RampProfile::Linear));
+  TEST_ASSERT_EQUAL_UINT16(500, rampAreaPermille(RampProfile::SCurve));
+  TEST_ASSERT_EQUAL_UINT16(1000, rampAreaPermille(RampProfile::Step));
+}
+
+void test_duration_grows_by_the_distance_lost_in_ramps() {
+  RampPlan plan = planRampedStep(900, RampProfile::SCurve, 120, true, true);
+  TEST_ASSERT_EQUAL_UINT32(1020, plan.durationMs);
+  TEST_ASSERT_EQUAL_UINT16(120, plan.rampUpMs);
+  TEST_ASSERT_EQUAL_UINT16(120, plan.rampDownMs);
+
+  // A cell chained into the next one only ramps up.
+  plan = planRampedStep(900, RampProfile::SCurve, 120, true, false);
+  TEST_ASSERT_EQUAL_UINT32(960, plan.durationMs);
+  TEST_ASSERT_EQUAL_UINT16(0, plan.rampDownMs);
+
+  plan = planRampedStep(900, RampProfile::Linear, 120, false, false);
+  TEST_ASSERT_EQUAL_UINT32(900, plan.durationMs);
+  plan = planRampedStep(900, RampProfile::Step, 120, true, true);
+  TEST_ASSERT_EQUAL_UINT32(900, plan.durationMs);
+  TEST_ASSERT_EQUAL_UINT16(0, plan.rampUpMs);
+}
+
+void test_short_moves_get_shorter_ramps_and_no_cruise() {
+  const RampPlan plan = planRampedStep(100, RampProfile::Linear, 120, true, true);
+  TEST_ASSERT_EQUAL_UINT16(100, plan.rampUpMs);
+  TEST_ASSERT_EQUAL_UINT16(100, plan.rampDownMs);
+  TEST_ASSERT_EQUAL_UINT32(200, plan.durationMs);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramps_start_at_zero_and_reach_the_target);
+  RUN_TEST(test_ramps_are_monotonic_and_s_curve_starts_gently);
+  RUN_TEST(test_ramp_area_is_half_for_symmetric_tables);
+  RUN_TEST(test_duration_grows_by_the_distance_lost_in_ramps);
+  RUN_TEST(test_short_moves_get_shorter_ramps_and_no_cruise);
+  return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <string.h>
+#include <unity.h>
+
+#include "../../src/binary_frame.h"
+#include "../../src/motion_calibration.h"
+
+namespace {
+MotionCalibration tuned() {
+  return MotionCalibration{
+      820, 840, 470, 490, 120, 95, 2, 150, {{1000, 962}, {985, 1000}, {1000, 1000}, {1010, 990}},
+      1600, 1640, 125, 430, 7600, 360, 210, 610, 18, 9};
+}
+
+MotionCalibration defaults() {
+  return MotionCalibration{
+      900, 900, 520, 520, 110, 105, 2, 120, {{1000, 1000}, {1000, 1000}, {1000, 1000}, {1000, 1000}},
+      1650, 1650, 130, 450, 0, 0, 0, 0, 20, 30};
+}
+
+void resealCrc(uint8_t *block, size_t crcAt) {
+  const uint16_t crc = crc16Ccitt(block, crcAt);
+  block[crcAt] = static_cast<uint8_t>(crc >> 8);
+  block[crcAt + 1] = static_cast<uint8_t>(crc);
+}
+}  // namespace
+
+void test_block_round_trips() {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  const size_t length = encodeCalibration(tuned(), block);
+  TEST_ASSERT_EQUAL_UINT32(54, length);
+  TEST_ASSERT_EQUAL_UINT8('M', block[0]);
+  TEST_ASSERT_EQUAL_UINT8(CALIBRATION_VERSION, block[2]);
+  TEST_ASSERT_EQUAL_UINT8(48, block[3]);
+  // Little-endian, in field-table order.
+  TEST_ASSERT_EQUAL_UINT8(820 & 0xFF, block[4]);
+  TEST_ASSERT_EQUAL_UINT8(820 >> 8, block[5]);
+
+  MotionCalibration loaded = defaults();
+  TEST_ASSERT_TRUE(decodeCalibration(block, sizeof(block), loaded));
+  for (uint8_t i = 0; i < calibrationFieldCount(); i++) {
+    TEST_ASSERT_EQUAL_UINT16(getCalibrationField(tuned(), i), getCalibrationField(loaded, i));
+  }
+}
+
+void test_damaged_or_blank_blocks_leave_the_defaults() {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  const size_t length = encodeCalibration(tuned(), block);
+  block[6] ^= 0x01;
+  MotionCalibration loaded = defaults();
+  TEST_ASSERT_FALSE(decodeCalibration(block, length, loaded));
+  TEST_ASSERT_EQUAL_UINT16(900, loaded.forwardCellMs);
+
+  memset(block, 0xFF, sizeof(block));  // erased EEPROM
+  TEST_ASSERT_FALSE(decodeCalibration(block, sizeof(block), loaded));
+
+  encodeCalibration(tuned(), block);
+  TEST_ASSERT_FALSE(decodeCalibration(block, length - 1, loaded));
+  TEST_ASSERT_EQUAL_UINT16(900, loaded.forwardCellMs);
+}
+
+void test_out_of_range_values_reject_the_whole_block() {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  const size_t length = encodeCalibration(tuned(), block);
+  block[14] = 3;  // ramp_profile
+  resealCrc(block, length - 2);
+  MotionCalibration loaded = defaults();
+  TEST_ASSERT_FALSE(decodeCalibration(block, length, loaded));
+  TEST_ASSERT_EQUAL_UINT16(900, loaded.forwardCellMs);
+  TEST_ASSERT_EQUAL_UINT8(2, loaded.rampProfile);
+}
+
+void test_older_shorter_blocks_keep_defaults_for_missing_fields() {
+  // A block from before ramp_ms existed: payload stops after ramp_profile.
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  encodeCalibration(tuned(), block);
+  block[3] = 11;
+  resealCrc(block, CALIBRATION_HEADER_SIZE + 11);
+  MotionCalibration loaded = defaults();
+  TEST_ASSERT_TRUE(decodeCalibration(block, CALIBRATION_HEADER_SIZE + 13, loaded));
+  TEST_ASSERT_EQUAL_UINT16(820, loaded.forwardCellMs);
+  TEST_ASSERT_EQUAL_UINT8(95, loaded.turnPwm);
+  TEST_ASSERT_EQUAL_UINT16(120, loaded.rampMs);
+}
+
+void test_version_1_blocks_load_without_trims() {
+  uint8_t block[CALIBRATION_MAX_BLOCK_SIZE];
+  encodeCalibration(tuned(), block);
+  block[2] = 1;
+  block[3] = 13;
+  resealCrc(block, CALIBRATION_HEADER_SIZE + 13);
+  MotionCalibration loaded = defaults();
+  TEST_ASSERT_TRUE(decodeCalibration(block, sizeof(block), loaded));
+  TEST_ASSERT_EQUAL_UINT16(150, loaded.rampMs);
+  TEST_ASSERT_EQUAL_UINT16(1000, loaded.wheelTrim[0][1]);
+  TEST_ASSERT_EQUAL_UINT16(1000, loaded.wheelTrim[3][0]);
+  TEST_ASSERT_EQUAL_UINT16(1650, loaded.arcLeftMs);
+  TEST_ASSERT_EQUAL_UINT16(450, loaded.arcInnerPermille);
+}
+
+void test_fields_are_found_by_name_and_range_checked() {
+  const uint8_t rampMs = findCalibrationField("ramp_ms", 7);
+  TEST_ASSERT_EQUAL_UINT8(7, rampMs);
+  TEST_ASSERT_EQUAL_STRING("ramp_ms", calibrationFieldName(rampMs));
+  TEST_ASSERT_EQUAL_UINT8(NO_CALIBRATION_FIELD, findCalibrationField("ramp", 4));
+  TEST_ASSERT_EQUAL_UINT8(NO_CALIBRATION_FIELD, findCalibrationField("ramp_ms_x", 9));
+
+  MotionCalibration calibration = defaults();
+  TEST_ASSERT_TRUE(setCalibrationField(calibration, rampMs, 200));
+  TEST_ASSERT_EQUAL_UINT16(200, calibration.rampMs);
+  TEST_ASSERT_FALSE(setCalibrationField(calibration, rampMs, 1001));
+  TEST_ASSERT_FALSE(setCalibrationField(calibration, rampMs, -1));
+  TEST_ASSERT_EQUAL_UINT16(200, calibration.rampMs);
+
+  const uint8_t forwardPwm = findCalibrationField("forward_pwm", 11);
+  TEST_ASSERT_TRUE(setCalibrationField(calibration, forwardPwm, 255));
+  TEST_ASSERT_EQUAL_UINT8(255, calibration.forwardPwm);
+  TEST_ASSERT_FALSE(setCalibrationField(calibration, forwardPwm, 256));
+
+  const uint8_t trim = findCalibrationField("right_turn_right_trim", 21);
+  TEST_ASSERT_TRUE(setCalibrationField(calibration, trim, 940));
+  TEST_ASSERT_EQUAL_UINT16(940, calibration.wheelTrim[3][1]);
+  TEST_ASSERT_FALSE(setCalibrationField(calibration, trim, 499));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_block_round_trips);
+  RUN_TEST(test_damaged_or_blank_blocks_leave_the_defaults);
+  RUN_TEST(test_out_of_range_values_reject_the_whole_block);
+  RUN_TEST(test_older_shorter_blocks_keep_defaults_for_missing_fields);
+  RUN_TEST(test_version_1_blocks_load_without_trims);
+  RUN_TEST(test_fields_are_found_by_name_and_range_checked);
+  return UNITY_END();
+}
@@ -0,0 +1,99 @@
+#include <unity.h>
+
+#include "../../src/motion_trim.h"
+
+namespace {
+MotionCalibration untrimmed() {
+  return MotionCalibration{
+      900, 900, 500, 500, 110, 120, 2, 120, {{1000, 1000}, {1000, 1000}, {1000, 1000}, {1000, 1000}},
+      1650, 1650, 130, 450, 0, 0, 0, 0, 20, 30};
+}
+}  // namespace
+
+void test_trims_scale_each_wheel_per_action() {
+  MotionCalibration calibration = untrimmed();
+  calibration.wheelTrim[0][1] = 950;
+  calibration.wheelTrim[2][0] = 1200;
+
+  WheelPwm forward = trimWheelPwm(calibration, MotionAction::ForwardCell, 110);
+  TEST_ASSERT_EQUAL_UINT8(110, forward.left);
+  TEST_ASSERT_EQUAL_UINT8(105, forward.right);  // 104.5 rounds up
+
+  WheelPwm reverse = trimWheelPwm(calibration, MotionAction::ReverseCell, 110);
+  TEST_ASSERT_EQUAL_UINT8(110, reverse.left);
+  TEST_ASSERT_EQUAL_UINT8(110, reverse.right);
+
+  WheelPwm turn = trimWheelPwm(calibration, MotionAction::TurnLeft, 240);
+  TEST_ASSERT_EQUAL_UINT8(255, turn.left);  // saturates
+  TEST_ASSERT_EQUAL_UINT8(240, turn.right);
+
+  WheelPwm idle = trimWheelPwm(calibration, MotionAction::Idle, 110);
+  TEST_ASSERT_EQUAL_UINT8(0, idle.left);
+  TEST_ASSERT_EQUAL_UINT8(0, idle.right);
+}
+
+void test_arcs_slow_the_inner_wheel_on_top_of_the_forward_trims() {
+  MotionCalibration calibration = untrimmed();
+  calibration.wheelTrim[0][0] = 980;
+
+  WheelPwm left = trimWheelPwm(calibration, MotionAction::ArcLeft, 130);
+  TEST_ASSERT_EQUAL_UINT8(57, left.left);  // 130 * 0.98 = 127, * 0.45
+  TEST_ASSERT_EQUAL_UINT8(130, left.right);
+
+  WheelPwm right = trimWheelPwm(calibration, MotionAction::ArcRight, 130);
+  TEST_ASSERT_EQUAL_UINT8(127, right.left);
+  TEST_ASSERT_EQUAL_UINT8(59, right.right);  // 58.5 rounds up
+}
+
+void test_drift_to_the_left_slows_the_right_wheel() {
+  // 200 mm left over a 1 m run on a 170 mm track: e = 2 * 170 * 200 / 1000^2
+  // = 6.8 %, so the right wheel is scaled by (2 - 0.068) / (2 + 0.068).
+  MotionCalibration calibration = untrimmed();
+  TEST_ASSERT_TRUE(deriveDriftTrim(calibration, MotionAction::ForwardCell, 200, 1000, 170));
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[0][0]);
+  TEST_ASSERT_EQUAL_UINT16(934, calibration.wheelTrim[0][1]);
+  // Other actions keep their trims.
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[1][1]);
+
+  TEST_ASSERT_TRUE(deriveDriftTrim(calibration, MotionAction::ReverseCell, -50, 2000, 170));
+  TEST_ASSERT_EQUAL_UINT16(996, calibration.wheelTrim[1][0]);
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[1][1]);
+}
+
+void test_overcorrection_gives_the_stronger_wheel_full_power_back() {
+  MotionCalibration calibration = untrimmed();
+  calibration.wheelTrim[0][1] = 900;
+  // The right trim overshot and it now drifts right. Slowing the left wheel
+  // alone (to 967) would leave both below unity, so both are scaled back up.
+  TEST_ASSERT_TRUE(deriveDriftTrim(calibration, MotionAction::ForwardCell, -100, 1000, 170));
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[0][0]);
+  TEST_ASSERT_EQUAL_UINT16(931, calibration.wheelTrim[0][1]);
+}
+
+void test_straight_runs_and_bad_input_leave_the_trims_alone() {
+  MotionCalibration calibration = untrimmed();
+  TEST_ASSERT_TRUE(deriveDriftTrim(calibration, MotionAction::ForwardCell, 0, 1000, 170));
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[0][0]);
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[0][1]);
+
+  TEST_ASSERT_FALSE(deriveDriftTrim(calibration, MotionAction::TurnLeft, 50, 1000, 170));
+  TEST_ASSERT_FALSE(deriveDriftTrim(calibration, MotionAction::ForwardCell, 50, 0, 170));
+  TEST_ASSERT_FALSE(deriveDriftTrim(calibration, MotionAction::ForwardCell, 1200, 1000, 170));
+  // Would need the right wheel below TRIM_MIN.
+  TEST_ASSERT_FALSE(deriveDriftTrim(calibration, MotionAction::ForwardCell, 900, 1000, 500));
+  TEST_ASSERT_EQUAL_UINT16(1000, calibration.wheelTrim[0][1]);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_trims_scale_each_wheel_per_action);
+  RUN_TEST(test_arcs_slow_the_inner_wheel_on_top_of_the_forward_trims);
+  RUN_TEST(test_drift_to_the_left_slows_the_right_wheel);
+  RUN_TEST(test_overcorrection_gives_the_stronger_wheel_full_power_back);
+  RUN_TEST(test_straight_runs_and_bad_input_leave_the_trims_alone);
+  return UNITY_END();
+}
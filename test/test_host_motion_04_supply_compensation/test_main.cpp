@@ -0,0 +1,95 @@
+#include <unity.h>
+
+#include "../../src/motion_trim.h"
+#include "../../src/supply_monitor.h"
+
+namespace {
+// 30k / 10k divider on a 5 V reference, as in runtime_config.h.
+const SupplyConfig CONFIG = {5000, 4000, 3000, 700, 1400, 50, 3};
+
+uint16_t gAdcRaw = 0;
+uint8_t gAdcReads = 0;
+
+uint16_t fakeAdc() {
+  gAdcReads++;
+  return gAdcRaw;
+}
+
+// Raw reading for a supply voltage, rounded like the real ADC.
+uint16_t rawFor(uint32_t supplyMv) { return static_cast<uint16_t>((supplyMv * 1023 + 10000) / 20000); }
+}  // namespace
+
+void test_readings_convert_through_the_divider() {
+  TEST_ASSERT_EQUAL_UINT16(20000, SupplyMonitor::toMillivolts(CONFIG, 1023));
+  TEST_ASSERT_EQUAL_UINT16(0, SupplyMonitor::toMillivolts(CONFIG, 0));
+  TEST_ASSERT_INT_WITHIN(20, 8400, SupplyMonitor::toMillivolts(CONFIG, rawFor(8400)));
+}
+
+void test_samples_at_the_configured_rate() {
+  SupplyMonitor monitor;
+  monitor.begin(CONFIG, fakeAdc);
+  gAdcReads = 0;
+  gAdcRaw = rawFor(8000);
+  TEST_ASSERT_TRUE(monitor.update(1000));  // first call samples at once
+  TEST_ASSERT_FALSE(monitor.update(1049));
+  TEST_ASSERT_TRUE(monitor.update(1050));
+  TEST_ASSERT_FALSE(monitor.update(1051));
+  TEST_ASSERT_EQUAL_UINT8(2, gAdcReads);
+}
+
+void test_filter_follows_a_drop_without_jumping() {
+  SupplyMonitor monitor;
+  monitor.begin(CONFIG, fakeAdc);
+  gAdcRaw = rawFor(8400);
+  monitor.update(0);
+  const uint16_t fresh = monitor.millivolts();
+  TEST_ASSERT_INT_WITHIN(20, 8400, fresh);
+
+  // A motor start sags the pack by 1 V: one sample only moves an eighth of it.
+  gAdcRaw = rawFor(7400);
+  monitor.update(50);
+  TEST_ASSERT_INT_WITHIN(20, 8275, monitor.millivolts());
+  for (uint32_t t = 100; t <= 2000; t += 50) {
+    monitor.update(t);
+  }
+  TEST_ASSERT_INT_WITHIN(30, 7400, monitor.millivolts());
+}
+
+void test_scale_holds_the_calibrated_motor_voltage() {
+  SupplyMonitor monitor;
+  monitor.begin(CONFIG, fakeAdc);
+  gAdcRaw = rawFor(7000);
+  monitor.update(0);
+  const uint16_t scale = monitor.scalePermille(8000);
+  TEST_ASSERT_INT_WITHIN(4, 1143, scale);
+  TEST_ASSERT_INT_WITHIN(1, 126, scalePwm(110, scale));
+
+  // Compensation off, or clamped at the configured bounds.
+  TEST_ASSERT_EQUAL_UINT16(1000, monitor.scalePermille(0));
+  TEST_ASSERT_EQUAL_UINT16(1400, monitor.scalePermille(12000));
+  TEST_ASSERT_EQUAL_UINT16(700, monitor.scalePermille(4000));
+  TEST_ASSERT_EQUAL_UINT8(255, scalePwm(220, 1400));
+}
+
+void test_missing_supply_turns_compensation_off() {
+  SupplyMonitor monitor;
+  monitor.begin(CONFIG, fakeAdc);
+  TEST_ASSERT_EQUAL_UINT16(1000, monitor.scalePermille(8000));  // no sample yet
+  gAdcRaw = rawFor(600);  // USB power only, divider floating low
+  monitor.update(0);
+  TEST_ASSERT_EQUAL_UINT16(1000, monitor.scalePermille(8000));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_readings_convert_through_the_divider);
+  RUN_TEST(test_samples_at_the_configured_rate);
+  RUN_TEST(test_filter_follows_a_drop_without_jumping);
+  RUN_TEST(test_scale_holds_the_calibrated_motor_voltage);
+  RUN_TEST(test_missing_supply_turns_compensation_off);
+  return UNITY_END();
+}
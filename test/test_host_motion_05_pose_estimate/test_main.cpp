@@ -0,0 +1,126 @@
+#include <unity.h>
+
+#include "../../src/pose_estimator.h"
+
+void test_trig_table_hits_the_cardinal_points() {
+  TEST_ASSERT_EQUAL_INT(0, poseSin(0));
+  TEST_ASSERT_EQUAL_INT(10000, poseSin(900));
+  TEST_ASSERT_EQUAL_INT(0, poseSin(1800));
+  TEST_ASSERT_EQUAL_INT(-10000, poseSin(2700));
+  TEST_ASSERT_EQUAL_INT(10000, poseCos(0));
+  TEST_ASSERT_EQUAL_INT(-10000, poseCos(1800));
+  TEST_ASSERT_EQUAL_INT(5000, poseSin(300));
+  TEST_ASSERT_EQUAL_INT(7071, poseCos(3150));
+  TEST_ASSERT_INT_WITHIN(1, 4924, poseSin(295));  // interpolated
+  TEST_ASSERT_EQUAL_UINT16(65535, isqrt32(0xFFFFFFFFUL));
+  TEST_ASSERT_EQUAL_UINT16(1000, isqrt32(1000000UL));
+}
+
+void test_square_route_returns_to_the_start() {
+  PoseEstimator estimator;
+  estimator.reset(2000, 3000, 900);  // facing east
+  for (int side = 0; side < 4; side++) {
+    estimator.integrate(MotionAction::ForwardCell, 2000);
+    estimator.integrate(MotionAction::TurnRight, 1000);
+  }
+  TEST_ASSERT_EQUAL_INT32(2000, estimator.pose().x);
+  TEST_ASSERT_EQUAL_INT32(3000, estimator.pose().y);
+  TEST_ASSERT_EQUAL_UINT16(900, estimator.pose().heading);
+}
+
+void test_moves_follow_the_grid_axes() {
+  PoseEstimator estimator;
+  estimator.reset(0, 0, 0);
+  estimator.integrate(MotionAction::ForwardCell, 3000);  // north is -y
+  TEST_ASSERT_EQUAL_INT32(0, estimator.pose().x);
+  TEST_ASSERT_EQUAL_INT32(-3000, estimator.pose().y);
+  estimator.integrate(MotionAction::TurnLeft, 1000);
+  TEST_ASSERT_EQUAL_UINT16(2700, estimator.pose().heading);
+  estimator.integrate(MotionAction::ReverseCell, 500);  // backs off east
+  TEST_ASSERT_EQUAL_INT32(500, estimator.pose().x);
+}
+
+void test_a_cut_turn_leaves_a_partial_heading() {
+  PoseEstimator estimator;
+  estimator.reset(0, 0, 0);
+  estimator.integrate(MotionAction::TurnRight, 500);
+  TEST_ASSERT_EQUAL_UINT16(450, estimator.pose().heading);
+  estimator.integrate(MotionAction::ForwardCell, 1000);
+  TEST_ASSERT_EQUAL_INT32(707, estimator.pose().x);
+  TEST_ASSERT_EQUAL_INT32(-707, estimator.pose().y);
+}
+
+void test_arcs_end_one_cell_over_and_one_up() {
+  PoseEstimator estimator;
+  estimator.reset(0, 0, 0);
+  estimator.integrate(MotionAction::ArcRight, 1000);
+  TEST_ASSERT_INT_WITHIN(1, 1000, estimator.pose().x);
+  TEST_ASSERT_INT_WITHIN(1, -1000, estimator.pose().y);
+  TEST_ASSERT_EQUAL_UINT16(900, estimator.pose().heading);
+
+  estimator.reset(0, 0, 0);
+  estimator.integrate(MotionAction::ArcLeft, 1000);
+  TEST_ASSERT_INT_WITHIN(1, -1000, estimator.pose().x);
+  TEST_ASSERT_INT_WITHIN(1, -1000, estimator.pose().y);
+  TEST_ASSERT_EQUAL_UINT16(2700, estimator.pose().heading);
+}
+
+void test_uncertainty_grows_with_motion_and_resets() {
+  PoseEstimator estimator;
+  estimator.reset(0, 0, 0);
+  TEST_ASSERT_EQUAL_UINT16(0, estimator.pose().positionSd());
+
+  estimator.integrate(MotionAction::ForwardCell, 1000);
+  // 5 % of a cell along track, and 1 degree of drift.
+  TEST_ASSERT_EQUAL_UINT16(50, estimator.pose().positionSd());
+  TEST_ASSERT_EQUAL_UINT16(10, estimator.pose().headingSd());
+  const uint16_t oneCell = estimator.pose().positionSd();
+
+  estimator.integrate(MotionAction::TurnRight, 1000);
+  TEST_ASSERT_GREATER_THAN(40, estimator.pose().headingSd());
+  estimator.integrate(MotionAction::ForwardCell, 1000);
+  TEST_ASSERT_GREATER_THAN(oneCell + 50, estimator.pose().positionSd());
+
+  for (int i = 0; i < 2000; i++) {
+    estimator.integrate(MotionAction::ForwardCell, 255000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, estimator.pose().positionVar);  // saturates
+
+  estimator.reset(1000, 1000, 3690);
+  TEST_ASSERT_EQUAL_UINT16(90, estimator.pose().heading);
+  TEST_ASSERT_EQUAL_UINT32(0, estimator.pose().positionVar);
+  TEST_ASSERT_EQUAL_UINT32(0, estimator.pose().headingVar);
+}
+
+void test_longest_step_lands_exactly_at_the_clamp() {
+  // 255 cells at a unit factor is 2.55e9 before rounding: past int32.
+  PoseEstimator estimator;
+  estimator.reset(0, 0, 900);
+  estimator.integrate(MotionAction::ForwardCell, 255UL * POSE_CELL);
+  TEST_ASSERT_EQUAL_INT32(255L * POSE_CELL, estimator.pose().x);
+  TEST_ASSERT_EQUAL_INT32(0, estimator.pose().y);
+
+  estimator.reset(0, 0, 2700);
+  estimator.integrate(MotionAction::ForwardCell, 400UL * POSE_CELL);  // clamped
+  TEST_ASSERT_EQUAL_INT32(-255L * POSE_CELL, estimator.pose().x);
+
+  estimator.reset(0, 0, 0);
+  estimator.integrate(MotionAction::ReverseCell, 255UL * POSE_CELL);  // backs off south
+  TEST_ASSERT_EQUAL_INT32(255L * POSE_CELL, estimator.pose().y);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_trig_table_hits_the_cardinal_points);
+  RUN_TEST(test_square_route_returns_to_the_start);
+  RUN_TEST(test_moves_follow_the_grid_axes);
+  RUN_TEST(test_a_cut_turn_leaves_a_partial_heading);
+  RUN_TEST(test_arcs_end_one_cell_over_and_one_up);
+  RUN_TEST(test_uncertainty_grows_with_motion_and_resets);
+  RUN_TEST(test_longest_step_lands_exactly_at_the_clamp);
+  return UNITY_END();
+}
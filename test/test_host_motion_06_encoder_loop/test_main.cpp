@@ -0,0 +1,183 @@
+#include <unity.h>
+
+#include "../../src/encoder_control.h"
+
+namespace {
+// runtime_config.h defaults, kept in step by hand: that header needs Arduino.h.
+constexpr EncoderLoopConfig CONFIG = {20, 30, 20, 300, 300};
+
+// A DC motor with a dead band and a first-order response, driving a
+// quadrature encoder. Every change of channel A goes through quadratureStep,
+// as in the interrupt handler, so the counts include its direction logic.
+struct SimWheel {
+  float ticksPerMsAtFull;
+  bool reversed;
+  float speed;
+  // Position in quarter cycles of the A/B pattern; one A edge per two.
+  float phase;
+  uint8_t state;
+  int32_t ticks;
+
+  void run(uint8_t pwm, bool forward, float dtMs) {
+    const float drive = pwm > 40 ? (pwm - 40) / 215.0f : 0.0f;
+    const float target = ticksPerMsAtFull * drive;
+    speed += (target - speed) * dtMs / 30.0f;
+    phase += speed * dtMs * 2.0f;
+    while (phase >= 1.0f) {
+      phase -= 1.0f;
+      quarterStep((forward != reversed) ? 1 : 3);
+    }
+  }
+
+  // Forward pattern (A, B): 00 -> 10 -> 11 -> 01.
+  void quarterStep(uint8_t by) {
+    static const bool A[4] = {false, true, true, false};
+    static const bool B[4] = {false, false, true, true};
+    const uint8_t next = static_cast<uint8_t>((state + by) % 4);
+    if (A[next] != A[state]) {
+      ticks += quadratureStep(A[next], B[next]);
+    }
+    state = next;
+  }
+};
+
+SimWheel wheel(float ticksPerMsAtFull) { return SimWheel{ticksPerMsAtFull, false, 0, 0, 0, 0}; }
+
+struct SimResult {
+  EncoderStatus status;
+  uint32_t ms;
+};
+
+// Runs one step at `pwm` (right wheel at `rightPwm`) until the loop ends it.
+SimResult simulate(EncoderLoop &loop, SimWheel &left, SimWheel &right, uint8_t pwm,
+                   uint8_t rightPwm, bool closedLoop, bool forward = true,
+                   uint32_t stallRightAtMs = 0) {
+  for (uint32_t ms = 1; ms < 10000; ms++) {
+    WheelPwm out = {pwm, rightPwm};
+    if (closedLoop) {
+      out = loop.apply(out);
+    }
+    left.run(out.left, forward, 1.0f);
+    if (stallRightAtMs == 0 || ms < stallRightAtMs) {
+      right.run(out.right, forward, 1.0f);
+    }
+    const EncoderStatus status = loop.update(ms, left.ticks, right.ticks);
+    if (status != EncoderStatus::Running) {
+      return SimResult{status, ms};
+    }
+  }
+  return SimResult{EncoderStatus::Running, 10000};
+}
+
+int32_t magnitude(int32_t value) { return value < 0 ? -value : value; }
+}  // namespace
+
+void test_quadrature_edges_count_both_ways() {
+  SimWheel forward = wheel(0);
+  for (int i = 0; i < 40; i++) {
+    forward.quarterStep(1);
+  }
+  TEST_ASSERT_EQUAL_INT32(20, forward.ticks);  // two A edges per cycle of four
+  for (int i = 0; i < 12; i++) {
+    forward.quarterStep(3);
+  }
+  TEST_ASSERT_EQUAL_INT32(14, forward.ticks);
+  TEST_ASSERT_EQUAL_INT(1, singleChannelStep(true));
+  TEST_ASSERT_EQUAL_INT(-1, singleChannelStep(false));
+}
+
+void test_open_loop_pair_drifts_apart() {
+  // The left motor is 15 % weaker; without the loop it falls well behind.
+  SimWheel left = wheel(2.04f);
+  SimWheel right = wheel(2.4f);
+  EncoderLoop loop;
+  loop.begin(CONFIG, 800, 800, 0, 0, 0);
+  const SimResult result = simulate(loop, left, right, 110, 110, false);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(EncoderStatus::Reached),
+                          static_cast<uint8_t>(result.status));
+  TEST_ASSERT_GREATER_THAN(80, right.ticks - left.ticks);
+}
+
+void test_pi_loop_keeps_mismatched_wheels_together() {
+  SimWheel left = wheel(2.04f);
+  SimWheel right = wheel(2.4f);
+  EncoderLoop loop;
+  loop.begin(CONFIG, 800, 800, 0, 0, 0);
+  const SimResult result = simulate(loop, left, right, 110, 110, true);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(EncoderStatus::Reached),
+                          static_cast<uint8_t>(result.status));
+  TEST_ASSERT_LESS_OR_EQUAL(6, magnitude(right.ticks - left.ticks));
+  TEST_ASSERT_GREATER_OR_EQUAL(800, (left.ticks + right.ticks) / 2);
+  TEST_ASSERT_EQUAL_UINT16(1000, loop.progressPermille());
+  // The weak wheel ends up pushed harder than the strong one.
+  TEST_ASSERT_GREATER_THAN(loop.correctionPermille(Wheel::Right),
+                           loop.correctionPermille(Wheel::Left));
+}
+
+void test_arc_keeps_the_inner_wheel_in_proportion() {
+  SimWheel left = wheel(2.4f);
+  SimWheel right = wheel(2.4f);
+  EncoderLoop loop;
+  // Right arc: the inner (right) wheel covers 45 % of the outer's distance,
+  // but 45 % of the PWM makes it too slow in the dead band.
+  loop.begin(CONFIG, 800, 360, 0, 0, 0);
+  const SimResult result = simulate(loop, left, right, 130, 72, true);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(EncoderStatus::Reached),
+                          static_cast<uint8_t>(result.status));
+  TEST_ASSERT_INT_WITHIN(12, 360, right.ticks);
+  TEST_ASSERT_INT_WITHIN(24, 800, left.ticks);
+}
+
+void test_reverse_counts_down_and_still_ends_on_distance() {
+  SimWheel left = wheel(2.4f);
+  SimWheel right = wheel(2.4f);
+  right.reversed = true;  // mirrored motor, its encoder counts the other way
+  EncoderLoop loop;
+  loop.begin(CONFIG, 400, 400, 1000, -1000, 0);
+  left.ticks = 1000;
+  right.ticks = -1000;
+  const SimResult result = simulate(loop, left, right, 110, 110, true, false);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(EncoderStatus::Reached),
+                          static_cast<uint8_t>(result.status));
+  TEST_ASSERT_LESS_THAN(1000, left.ticks);
+  TEST_ASSERT_GREATER_THAN(-1000, right.ticks);
+}
+
+void test_a_silent_encoder_reports_a_stall() {
+  SimWheel left = wheel(2.4f);
+  SimWheel right = wheel(2.4f);
+  EncoderLoop loop;
+  loop.begin(CONFIG, 800, 800, 0, 0, 0);
+  const SimResult result = simulate(loop, left, right, 110, 110, true, true, 200);
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(EncoderStatus::Stalled),
+                          static_cast<uint8_t>(result.status));
+  TEST_ASSERT_INT_WITHIN(10, 500, result.ms);
+  TEST_ASSERT_LESS_THAN(1000, loop.progressPermille());
+}
+
+void test_corrections_are_clamped_and_saturate_pwm() {
+  EncoderLoop loop;
+  loop.begin(CONFIG, 800, 800, 0, 0, 0);
+  loop.update(20, 0, 200);
+  const WheelPwm pwm = loop.apply(WheelPwm{240, 100});
+  TEST_ASSERT_EQUAL_INT(300, loop.correctionPermille(Wheel::Left));
+  TEST_ASSERT_EQUAL_INT(-300, loop.correctionPermille(Wheel::Right));
+  TEST_ASSERT_EQUAL_UINT8(255, pwm.left);
+  TEST_ASSERT_EQUAL_UINT8(70, pwm.right);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_quadrature_edges_count_both_ways);
+  RUN_TEST(test_open_loop_pair_drifts_apart);
+  RUN_TEST(test_pi_loop_keeps_mismatched_wheels_together);
+  RUN_TEST(test_arc_keeps_the_inner_wheel_in_proportion);
+  RUN_TEST(test_reverse_counts_down_and_still_ends_on_distance);
+  RUN_TEST(test_a_silent_encoder_reports_a_stall);
+  RUN_TEST(test_corrections_are_clamped_and_saturate_pwm);
+  return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+
+#include "../../src/loop_profiler.h"
+
+static LoopProfiler gProfiler;
+
+void test_bucket_boundaries_are_powers_of_two() {
+  TEST_ASSERT_EQUAL_UINT8(0, LoopProfiler::bucketFor(0));
+  TEST_ASSERT_EQUAL_UINT8(0, LoopProfiler::bucketFor(3));
+  TEST_ASSERT_EQUAL_UINT8(1, LoopProfiler::bucketFor(4));
+  TEST_ASSERT_EQUAL_UINT8(1, LoopProfiler::bucketFor(7));
+  TEST_ASSERT_EQUAL_UINT8(2, LoopProfiler::bucketFor(8));
+  TEST_ASSERT_EQUAL_UINT8(7, LoopProfiler::bucketFor(256));
+  TEST_ASSERT_EQUAL_UINT8(10, LoopProfiler::bucketFor(4095));
+  TEST_ASSERT_EQUAL_UINT8(11, LoopProfiler::bucketFor(4096));
+  TEST_ASSERT_EQUAL_UINT8(11, LoopProfiler::bucketFor(8191));
+  TEST_ASSERT_EQUAL_UINT8(PROFILE_BUCKETS - 1, LoopProfiler::bucketFor(0xFFFFFFFFUL));
+}
+
+void test_bucket_matches_a_reference_log2() {
+  for (uint32_t us = 0; us < 10000UL; us++) {
+    uint8_t log2 = 0;
+    while ((us >> (log2 + 1)) != 0) {
+      log2++;
+    }
+    uint8_t expected = log2 > 1 ? log2 - 1 : 0;
+    if (expected > PROFILE_BUCKETS - 1) {
+      expected = PROFILE_BUCKETS - 1;
+    }
+    TEST_ASSERT_EQUAL_UINT8(expected, LoopProfiler::bucketFor(us));
+  }
+}
+
+void test_min_max_mean_and_histogram() {
+  gProfiler.reset();
+  gProfiler.record(ProfilePhase::LcdI2c, 2400);
+  gProfiler.record(ProfilePhase::LcdI2c, 1200);
+  gProfiler.record(ProfilePhase::LcdI2c, 3000);
+  const PhaseProfile &lcd = gProfiler.phase(ProfilePhase::LcdI2c);
+  TEST_ASSERT_EQUAL_UINT32(3, lcd.samples);
+  TEST_ASSERT_EQUAL_UINT32(1200, lcd.minUs);
+  TEST_ASSERT_EQUAL_UINT32(3000, lcd.maxUs);
+  TEST_ASSERT_EQUAL_UINT32(2200, lcd.meanUs());
+  TEST_ASSERT_EQUAL_UINT16(1, lcd.histogram[9]);
+  TEST_ASSERT_EQUAL_UINT16(2, lcd.histogram[10]);
+  TEST_ASSERT_EQUAL_UINT32(0, gProfiler.phase(ProfilePhase::Rx).samples);
+}
+
+void test_zero_duration_sets_the_minimum() {
+  gProfiler.reset();
+  gProfiler.record(ProfilePhase::Tx, 12);
+  gProfiler.record(ProfilePhase::Tx, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, gProfiler.phase(ProfilePhase::Tx).minUs);
+  TEST_ASSERT_EQUAL_UINT32(6, gProfiler.phase(ProfilePhase::Tx).meanUs());
+}
+
+void test_reset_of_one_phase_keeps_the_others() {
+  gProfiler.reset();
+  gProfiler.record(ProfilePhase::Drive, 40);
+  gProfiler.record(ProfilePhase::Keypad, 300);
+  gProfiler.reset(ProfilePhase::Drive);
+  TEST_ASSERT_EQUAL_UINT32(0, gProfiler.phase(ProfilePhase::Drive).samples);
+  TEST_ASSERT_EQUAL_UINT32(0, gProfiler.phase(ProfilePhase::Drive).maxUs);
+  TEST_ASSERT_EQUAL_UINT32(1, gProfiler.phase(ProfilePhase::Keypad).samples);
+  TEST_ASSERT_EQUAL_UINT32(0, gProfiler.phase(ProfilePhase::Drive).meanUs());
+}
+
+void test_histogram_counters_saturate() {
+  gProfiler.reset();
+  for (uint32_t i = 0; i < 70000UL; i++) {
+    gProfiler.record(ProfilePhase::Switches, 5);
+  }
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, gProfiler.phase(ProfilePhase::Switches).histogram[1]);
+  TEST_ASSERT_EQUAL_UINT32(70000UL, gProfiler.phase(ProfilePhase::Switches).samples);
+}
+
+void test_total_and_samples_stop_together() {
+  gProfiler.reset();
+  for (int i = 0; i < 3; i++) {
+    gProfiler.record(ProfilePhase::Locks, 2000000000UL);
+  }
+  const PhaseProfile &locks = gProfiler.phase(ProfilePhase::Locks);
+  TEST_ASSERT_EQUAL_UINT32(2, locks.samples);
+  TEST_ASSERT_EQUAL_UINT32(4000000000UL, locks.totalUs);
+  TEST_ASSERT_EQUAL_UINT32(2000000000UL, locks.meanUs());
+  TEST_ASSERT_EQUAL_UINT16(3, locks.histogram[PROFILE_BUCKETS - 1]);
+  gProfiler.record(ProfilePhase::Locks, 5);
+  TEST_ASSERT_EQUAL_UINT32(5, locks.minUs);
+}
+
+void test_every_phase_has_a_name() {
+  for (uint8_t i = 0; i < PROFILE_PHASE_COUNT; i++) {
+    TEST_ASSERT_NOT_NULL(LoopProfiler::phaseName(static_cast<ProfilePhase>(i)));
+  }
+  TEST_ASSERT_EQUAL_STRING("rfid_spi", LoopProfiler::phaseName(ProfilePhase::RfidSpi));
+  TEST_ASSERT_EQUAL_STRING("tx", LoopProfiler::phaseName(ProfilePhase::Tx));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_boundaries_are_powers_of_two);
+  RUN_TEST(test_bucket_matches_a_reference_log2);
+  RUN_TEST(test_min_max_mean_and_histogram);
+  RUN_TEST(test_zero_duration_sets_the_minimum);
+  RUN_TEST(test_reset_of_one_phase_keeps_the_others);
+  RUN_TEST(test_histogram_counters_saturate);
+  RUN_TEST(test_total_and_samples_stop_together);
+  RUN_TEST(test_every_phase_has_a_name);
+  return UNITY_END();
+}
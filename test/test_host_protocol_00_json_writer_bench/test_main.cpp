@@ -0,0 +1,304 @@
+#include <unity.h>
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/json_writer.h"
+
+// Host benchmark for the TX path: the old String-concatenation emitters versus
+// the streaming JsonWriter. LegacyString models Arduino WString's allocation
+// policy (every growth is an exact-size realloc, every copy a fresh buffer) so
+// the allocation counts match what the Mega heap used to see per event.
+
+static unsigned long gOperatorNewCalls = 0;
+
+void *operator new(size_t size) {
+  gOperatorNewCalls++;
+  void *ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+struct HeapStats {
+  unsigned long allocations = 0;
+  unsigned long bytes = 0;
+};
+
+static HeapStats gLegacyHeap;
+
+class LegacyString {
+ public:
+  LegacyString(const char *text = "") { copy_(text, strlen(text)); }
+  LegacyString(const LegacyString &other) { copy_(other.buffer_, other.len_); }
+  LegacyString(LegacyString &&other) noexcept
+      : buffer_(other.buffer_), capacity_(other.capacity_), len_(other.len_) {
+    other.buffer_ = nullptr;
+    other.capacity_ = 0;
+    other.len_ = 0;
+  }
+  ~LegacyString() { free(buffer_); }
+  LegacyString &operator=(const LegacyString &) = delete;
+
+  LegacyString &operator+=(const LegacyString &other) { return concat_(other.buffer_, other.len_); }
+  LegacyString &operator+=(const char *text) { return concat_(text, strlen(text)); }
+  LegacyString &operator+=(char ch) { return concat_(&ch, 1); }
+  LegacyString &operator+=(long number) {
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%ld", number);
+    return concat_(digits, strlen(digits));
+  }
+
+  void reserve(size_t size) {
+    if (buffer_ != nullptr && capacity_ >= size) {
+      return;
+    }
+    buffer_ = static_cast<char *>(realloc(buffer_, size + 1));
+    capacity_ = size;
+    gLegacyHeap.allocations++;
+    gLegacyHeap.bytes += size + 1;
+  }
+
+  size_t length() const { return len_; }
+  const char *c_str() const { return buffer_; }
+  char operator[](size_t index) const { return buffer_[index]; }
+
+ private:
+  char *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t len_ = 0;
+
+  void copy_(const char *text, size_t length) {
+    reserve(length);
+    memcpy(buffer_, text, length);
+    len_ = length;
+    buffer_[len_] = '\0';
+  }
+
+  LegacyString &concat_(const char *text, size_t length) {
+    const size_t newLength = len_ + length;
+    if (length == 0 || newLength < len_) {
+      return *this;
+    }
+    reserve(newLength);
+    memcpy(buffer_ + len_, text, length);
+    len_ = newLength;
+    buffer_[len_] = '\0';
+    return *this;
+  }
+};
+
+// `String("a") + b` in WString copies the left operand into a StringSumHelper
+// and then concatenates in place; Sum reproduces that.
+struct Sum {
+  LegacyString value;
+  explicit Sum(const LegacyString &first) : value(first) {}
+  template <typename T>
+  Sum &operator+(const T &next) {
+    value += next;
+    return *this;
+  }
+};
+
+static LegacyString legacyEscape(const LegacyString &value) {
+  LegacyString out;
+  out.reserve(value.length() + 8);
+  for (size_t i = 0; i < value.length(); i++) {
+    const char ch = value[i];
+    if (ch == '\\' || ch == '"') {
+      out += '\\';
+    }
+    out += ch;
+  }
+  return out;
+}
+
+static char gLegacyWire[256];
+static size_t gLegacyWireLength = 0;
+
+static void legacySendObject(const char *type, const LegacyString &fields) {
+  LegacyString line = (Sum(LegacyString("{\"type\":\"")) + legacyEscape(type) + "\"").value;
+  if (fields.length() > 0) {
+    line += ",";
+    line += fields;
+  }
+  line += "}";
+  gLegacyWireLength = line.length();
+  memcpy(gLegacyWire, line.c_str(), gLegacyWireLength);
+  gLegacyWire[gLegacyWireLength++] = '\r';
+  gLegacyWire[gLegacyWireLength++] = '\n';
+}
+
+static void legacySendEvent(const char *eventType, const LegacyString &extraFields) {
+  LegacyString fields = (Sum(LegacyString("\"event\":\"")) + legacyEscape(eventType) + "\"").value;
+  if (extraFields.length() > 0) {
+    fields += ",";
+    fields += extraFields;
+  }
+  legacySendObject("event", fields);
+}
+
+static void legacySendAck(const char *command, const LegacyString &extraFields) {
+  LegacyString fields = (Sum(LegacyString("\"command\":\"")) + legacyEscape(command) + "\"").value;
+  if (extraFields.length() > 0) {
+    fields += ",";
+    fields += extraFields;
+  }
+  legacySendObject("ack", fields);
+}
+
+static void legacyKeyEvent() {
+  LegacyString key;
+  key += '5';
+  legacySendEvent("key_event", (Sum(LegacyString("\"key\":\"")) + legacyEscape(key) +
+                                "\",\"state\":\"" + "pressed" + "\"")
+                                   .value);
+}
+
+static void legacyLcdAck() {
+  const LegacyString text("Queue: 2 \"ready\"");
+  legacySendAck("lcd_set_line", (Sum(LegacyString("\"line\":")) + 2L + ",\"text\":\"" +
+                                 legacyEscape(text) + "\"")
+                                    .value);
+}
+
+static void legacyStateEvent() {
+  legacySendEvent("state", (Sum(LegacyString("\"drive_busy\":")) + "true" +
+                            ",\"drive_action\":\"" + "forward_cell" + "\"" + ",\"switches\":[" +
+                            "true" + "," + "false" + "]" + ",\"locks\":[\"" + "closed" +
+                            "\",\"" + "open" + "\"]")
+                               .value);
+}
+
+static char gTxFrame[192];
+static char gWriterWire[256];
+static size_t gWriterWireLength = 0;
+static JsonWriter gWriter;
+
+static FrameWriter &writerBegin(const char *type) {
+  gWriter.reset(gTxFrame, sizeof(gTxFrame));
+  return gWriter.beginObject().field("type", type);
+}
+
+static void writerSend() {
+  gWriter.endObject();
+  memcpy(gWriterWire, gWriter.data(), gWriter.length());
+  gWriterWireLength = gWriter.length();
+  gWriterWire[gWriterWireLength++] = '\n';
+}
+
+static void writerKeyEvent() {
+  writerBegin("event").field("event", "key_event").field("key", '5').field("state", "pressed");
+  writerSend();
+}
+
+static void writerLcdAck() {
+  writerBegin("ack")
+      .field("command", "lcd_set_line")
+      .field("line", 2)
+      .field("text", "Queue: 2 \"ready\"");
+  writerSend();
+}
+
+static void writerStateEvent() {
+  FrameWriter &state = writerBegin("event").field("event", "state");
+  state.field("drive_busy", true).field("drive_action", "forward_cell");
+  state.beginArray("switches").value(true).value(false).endArray();
+  state.beginArray("locks").value("closed").value("open").endArray();
+  writerSend();
+}
+
+struct EventCase {
+  const char *name;
+  void (*legacy)();
+  void (*writer)();
+};
+
+static const EventCase kCases[] = {
+    {"key_event", legacyKeyEvent, writerKeyEvent},
+    {"lcd_set_line ack", legacyLcdAck, writerLcdAck},
+    {"state", legacyStateEvent, writerStateEvent},
+};
+
+static constexpr unsigned long kIterations = 200000;
+
+template <typename Fn>
+static double nanosPerCall(Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < kIterations; i++) {
+    fn();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / kIterations;
+}
+
+void test_writer_matches_legacy_payload() {
+  for (const EventCase &eventCase : kCases) {
+    eventCase.legacy();
+    eventCase.writer();
+    // Legacy framing used println (CRLF); the writer terminates with LF only.
+    TEST_ASSERT_EQUAL_size_t(gLegacyWireLength - 1, gWriterWireLength);
+    TEST_ASSERT_EQUAL_MEMORY(gLegacyWire, gWriterWire, gWriterWireLength - 1);
+  }
+}
+
+void test_writer_never_allocates() {
+  const unsigned long before = gOperatorNewCalls;
+  const unsigned long legacyBefore = gLegacyHeap.allocations;
+  for (const EventCase &eventCase : kCases) {
+    eventCase.writer();
+  }
+  TEST_ASSERT_EQUAL(before, gOperatorNewCalls);
+  TEST_ASSERT_EQUAL(legacyBefore, gLegacyHeap.allocations);
+}
+
+void test_writer_escapes_and_reports_overflow() {
+  char small[24];
+  JsonWriter writer;
+  writer.reset(small, sizeof(small));
+  writer.beginObject().field("t", "a\"b\\c\n").endObject();
+  TEST_ASSERT_FALSE(writer.overflowed());
+  TEST_ASSERT_EQUAL_STRING_LEN("{\"t\":\"a\\\"b\\\\c\\n\"}", writer.data(), writer.length());
+
+  writer.reset(small, sizeof(small));
+  writer.beginObject().field("text", "this value will not fit in the frame").endObject();
+  TEST_ASSERT_TRUE(writer.overflowed());
+  TEST_ASSERT_EQUAL_size_t(sizeof(small), writer.length());
+}
+
+void test_report_bytes_allocations_and_time_per_event() {
+  printf("\n%-18s %12s %12s %12s %12s %12s %12s\n", "event", "legacy B", "writer B",
+         "legacy alloc", "legacy heapB", "legacy ns", "writer ns");
+  for (const EventCase &eventCase : kCases) {
+    gLegacyHeap = HeapStats();
+    eventCase.legacy();
+    const HeapStats perEvent = gLegacyHeap;
+    eventCase.writer();
+
+    const double legacyNs = nanosPerCall(eventCase.legacy);
+    const double writerNs = nanosPerCall(eventCase.writer);
+    printf("%-18s %12zu %12zu %12lu %12lu %12.1f %12.1f\n", eventCase.name, gLegacyWireLength,
+           gWriterWireLength, perEvent.allocations, perEvent.bytes, legacyNs, writerNs);
+    TEST_ASSERT_GREATER_THAN(0, perEvent.allocations);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_writer_matches_legacy_payload);
+  RUN_TEST(test_writer_never_allocates);
+  RUN_TEST(test_writer_escapes_and_reports_overflow);
+  RUN_TEST(test_report_bytes_allocations_and_time_per_event);
+  return UNITY_END();
+}
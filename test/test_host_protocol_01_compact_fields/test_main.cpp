@@ -0,0 +1,122 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/compact_fields.h"
+
+static char gLine[128];
+
+static uint8_t split(const char *text, CompactField *fields, uint8_t maxFields) {
+  strcpy(gLine, text);
+  return splitCompactFields(gLine, strlen(gLine), fields, maxFields);
+}
+
+void test_splits_plain_fields_in_place() {
+  CompactField fields[4];
+  const uint8_t count = split("L|2|Queue: 1", fields, 4);
+
+  TEST_ASSERT_EQUAL_UINT8(3, count);
+  TEST_ASSERT_EQUAL_STRING("L", fields[0].data);
+  TEST_ASSERT_EQUAL_STRING("2", fields[1].data);
+  TEST_ASSERT_EQUAL_STRING("Queue: 1", fields[2].data);
+  TEST_ASSERT_EQUAL_size_t(8, fields[2].length);
+  TEST_ASSERT_TRUE(fields[0].data == gLine);
+  int32_t sequence = 0;
+  TEST_ASSERT_EQUAL('L', compactOpcode(fields[0], sequence));
+  TEST_ASSERT_EQUAL_INT32(NO_SEQUENCE, sequence);
+}
+
+void test_resolves_escapes_without_copying() {
+  CompactField fields[4];
+  const uint8_t count = split("L|0|a\\|b\\\\c\\nd", fields, 4);
+
+  TEST_ASSERT_EQUAL_UINT8(3, count);
+  TEST_ASSERT_EQUAL_STRING("a|b\\c\nd", fields[2].data);
+  TEST_ASSERT_EQUAL_size_t(7, fields[2].length);
+  TEST_ASSERT_TRUE(fields[2].data >= gLine && fields[2].data < gLine + sizeof(gLine));
+}
+
+void test_keeps_empty_fields_and_drops_trailing_backslash() {
+  CompactField fields[4];
+  const uint8_t count = split("M||\\", fields, 4);
+
+  TEST_ASSERT_EQUAL_UINT8(3, count);
+  TEST_ASSERT_EQUAL_size_t(0, fields[1].length);
+  TEST_ASSERT_EQUAL_STRING("", fields[2].data);
+}
+
+void test_ignores_fields_beyond_capacity() {
+  CompactField fields[2];
+  const uint8_t count = split("A|1|90|extra", fields, 2);
+
+  TEST_ASSERT_EQUAL_UINT8(2, count);
+  TEST_ASSERT_EQUAL_STRING("1", fields[1].data);
+}
+
+void test_multi_char_opcode_is_rejected() {
+  CompactField fields[1];
+  int32_t sequence = 0;
+  split("PX", fields, 1);
+  TEST_ASSERT_EQUAL('\0', compactOpcode(fields[0], sequence));
+}
+
+void test_opcode_carries_optional_sequence_id() {
+  CompactField fields[3];
+  int32_t sequence = NO_SEQUENCE;
+  split("L#17|0|Hi", fields, 3);
+  TEST_ASSERT_EQUAL('L', compactOpcode(fields[0], sequence));
+  TEST_ASSERT_EQUAL_INT32(17, sequence);
+
+  split("T#65535", fields, 1);
+  TEST_ASSERT_EQUAL('T', compactOpcode(fields[0], sequence));
+  TEST_ASSERT_EQUAL_INT32(65535, sequence);
+
+  const char *const malformed[] = {"T#", "T#65536", "T#1a", "TT#1"};
+  for (const char *text : malformed) {
+    split(text, fields, 1);
+    TEST_ASSERT_EQUAL('\0', compactOpcode(fields[0], sequence));
+    TEST_ASSERT_EQUAL_INT32(NO_SEQUENCE, sequence);
+  }
+}
+
+void test_batch_splits_on_unescaped_separators_only() {
+  strcpy(gLine, "B#4;L|0|a\\;b;O|1;L|1|c\\\\;T");
+  CompactSegment segments[5];
+  const uint8_t count = splitCompactBatch(gLine, strlen(gLine), segments, 5);
+
+  TEST_ASSERT_EQUAL_UINT8(5, count);
+  TEST_ASSERT_EQUAL_STRING("B#4", segments[0].data);
+  TEST_ASSERT_EQUAL_STRING("L|0|a\\;b", segments[1].data);
+  TEST_ASSERT_EQUAL_STRING("O|1", segments[2].data);
+  TEST_ASSERT_EQUAL_STRING("L|1|c\\\\", segments[3].data);
+  TEST_ASSERT_EQUAL_STRING("T", segments[4].data);
+
+  // Escapes left in the segment are resolved by the field splitter.
+  CompactField fields[3];
+  splitCompactFields(segments[1].data, segments[1].length, fields, 3);
+  TEST_ASSERT_EQUAL_STRING("a;b", fields[2].data);
+}
+
+void test_batch_reports_segments_beyond_capacity() {
+  strcpy(gLine, "B;P;P;P");
+  CompactSegment segments[2];
+  TEST_ASSERT_EQUAL_UINT8(4, splitCompactBatch(gLine, strlen(gLine), segments, 2));
+  TEST_ASSERT_EQUAL_STRING("P", segments[1].data);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_splits_plain_fields_in_place);
+  RUN_TEST(test_resolves_escapes_without_copying);
+  RUN_TEST(test_keeps_empty_fields_and_drops_trailing_backslash);
+  RUN_TEST(test_ignores_fields_beyond_capacity);
+  RUN_TEST(test_multi_char_opcode_is_rejected);
+  RUN_TEST(test_opcode_carries_optional_sequence_id);
+  RUN_TEST(test_batch_splits_on_unescaped_separators_only);
+  RUN_TEST(test_batch_reports_segments_beyond_capacity);
+  return UNITY_END();
+}
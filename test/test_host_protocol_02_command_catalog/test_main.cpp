@@ -0,0 +1,112 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/command_catalog.h"
+
+static bool byName(const char *name, CommandSpec &spec) {
+  return findCommandByName(name, strlen(name), spec);
+}
+
+void test_every_opcode_resolves_to_its_command() {
+  static const struct {
+    char opcode;
+    const char *name;
+  } kOpcodes[] = {{'P', "ping"},         {'G', "get_state"},       {'R', "rfid_reset"},
+                  {'C', "lcd_clear"},    {'D', "lcd_demo"},        {'L', "lcd_set_line"},
+                  {'O', "servo_open"},   {'X', "servo_close"},     {'A', "servo_set_angle"},
+                  {'M', "move"},         {'T', "stop"},            {'Y', "link_mode"}};
+  for (const auto &entry : kOpcodes) {
+    CommandSpec spec;
+    TEST_ASSERT_TRUE(findCommandByOpcode(entry.opcode, spec));
+    TEST_ASSERT_EQUAL(entry.opcode, spec.opcode);
+    TEST_ASSERT_EQUAL_STRING(entry.name, spec.name);
+
+    CommandSpec named;
+    TEST_ASSERT_TRUE(byName(entry.name, named));
+    TEST_ASSERT_TRUE(named.id == spec.id);
+  }
+}
+
+void test_json_only_commands_have_no_opcode() {
+  CommandSpec spec;
+  TEST_ASSERT_TRUE(byName("lcd_backlight", spec));
+  TEST_ASSERT_EQUAL_UINT8(1, spec.minArgs);
+  TEST_ASSERT_EQUAL_STRING("enabled", spec.keys[0]);
+  TEST_ASSERT_TRUE(byName("lcd_set", spec));
+  TEST_ASSERT_FALSE(findCommandByOpcode('\0', spec));
+}
+
+void test_rejects_unknown_opcodes_and_names() {
+  CommandSpec spec;
+  TEST_ASSERT_FALSE(findCommandByOpcode('Z', spec));
+  TEST_ASSERT_FALSE(findCommandByOpcode('p', spec));
+  TEST_ASSERT_FALSE(byName("", spec));
+  TEST_ASSERT_FALSE(byName("pong", spec));
+  TEST_ASSERT_FALSE(byName("stop_now", spec));
+  TEST_ASSERT_FALSE(byName("a_command_name_longer_than_any_known_one", spec));
+  // Length is part of the match: a prefix of a known name is not that name.
+  TEST_ASSERT_FALSE(findCommandByName("lcd_set_line", 11, spec));
+  TEST_ASSERT_FALSE(findCommandByName("stop", 3, spec));
+  TEST_ASSERT_TRUE(findCommandByName("lcd_set_line", 7, spec));
+  TEST_ASSERT_TRUE(spec.id == CommandId::LcdSet);
+}
+
+void test_arity_and_argument_accessors() {
+  CommandSpec spec;
+  TEST_ASSERT_TRUE(findCommandByOpcode('M', spec));
+  TEST_ASSERT_EQUAL_UINT8(1, spec.minArgs);
+  TEST_ASSERT_EQUAL_UINT8(3, spec.maxArgs);
+  TEST_ASSERT_EQUAL_STRING("duration_ms", spec.keys[1]);
+  TEST_ASSERT_EQUAL_STRING("replace", spec.keys[2]);
+
+  const CompactField fields[] = {{"forward_cell", 12}, {"-250", 4}, {"true", 4}};
+  const CommandArgs args{fields, 3};
+  TEST_ASSERT_EQUAL_STRING("forward_cell", args.text(0));
+  TEST_ASSERT_EQUAL(-250L, args.integer(1));
+  TEST_ASSERT_TRUE(args.flag(2));
+  TEST_ASSERT_FALSE(args.flag(0));
+}
+
+void test_json_keys_are_collected_by_name_not_position() {
+  CommandSpec spec;
+  TEST_ASSERT_TRUE(findCommandByName("move", 4, spec));
+  char line[] = "{\"type\":\"move\",\"action\":\"forward_cell\",\"replace\":1}";
+  JsonFieldIndex json;
+  TEST_ASSERT_TRUE(json.parse(line, strlen(line)));
+
+  CompactField fields[COMMAND_MAX_ARGS];
+  const CommandArgs args{fields, collectJsonArgs(json, spec, fields)};
+  TEST_ASSERT_EQUAL_UINT8(3, args.count);
+  TEST_ASSERT_TRUE(args.has(0));
+  TEST_ASSERT_EQUAL_STRING("forward_cell", args.text(0));
+  TEST_ASSERT_FALSE(args.has(1));  // duration_ms omitted
+  TEST_ASSERT_TRUE(args.has(2));
+  TEST_ASSERT_TRUE(args.flag(2));
+  TEST_ASSERT_FALSE(args.has(3));
+
+  char bare[] = "{\"type\":\"move\",\"action\":\"stop\"}";
+  TEST_ASSERT_TRUE(json.parse(bare, strlen(bare)));
+  TEST_ASSERT_EQUAL_UINT8(1, collectJsonArgs(json, spec, fields));
+}
+
+void test_name_hash_is_usable_at_compile_time() {
+  static_assert(commandNameSlot("stop", 4) != commandNameSlot("move", 4),
+                "hash must be constexpr");
+  TEST_ASSERT_EQUAL_UINT32(commandNameHash("stop", 4), commandNameHash("stop!", 4));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_opcode_resolves_to_its_command);
+  RUN_TEST(test_json_only_commands_have_no_opcode);
+  RUN_TEST(test_rejects_unknown_opcodes_and_names);
+  RUN_TEST(test_arity_and_argument_accessors);
+  RUN_TEST(test_json_keys_are_collected_by_name_not_position);
+  RUN_TEST(test_name_hash_is_usable_at_compile_time);
+  return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/json_fields.h"
+
+static char gLine[256];
+static JsonFieldIndex gJson;
+
+static bool parse(const char *text) {
+  strcpy(gLine, text);
+  return gJson.parse(gLine, strlen(gLine));
+}
+
+void test_indexes_typed_fields_in_one_pass() {
+  TEST_ASSERT_TRUE(parse("{\"type\":\"servo_set_angle\", \"box\": 2, \"angle\":-15,\"hold\":true}"));
+  TEST_ASSERT_EQUAL_UINT8(4, gJson.count());
+
+  const char *text = nullptr;
+  size_t length = 0;
+  TEST_ASSERT_TRUE(gJson.getString("type", text, length));
+  TEST_ASSERT_EQUAL_STRING("servo_set_angle", text);
+  TEST_ASSERT_EQUAL_size_t(15, length);
+  TEST_ASSERT_TRUE(text > gLine && text < gLine + sizeof(gLine));
+
+  long number = 0;
+  TEST_ASSERT_TRUE(gJson.getInt("box", number));
+  TEST_ASSERT_EQUAL(2, number);
+  TEST_ASSERT_TRUE(gJson.getInt("angle", number));
+  TEST_ASSERT_EQUAL(-15, number);
+
+  bool flag = false;
+  TEST_ASSERT_TRUE(gJson.getBool("hold", flag));
+  TEST_ASSERT_TRUE(flag);
+
+  TEST_ASSERT_TRUE(gJson.getScalar("angle", text, length));
+  TEST_ASSERT_EQUAL_STRING("-15", text);
+  TEST_ASSERT_FALSE(gJson.getInt("type", number));
+  TEST_ASSERT_FALSE(gJson.getString("missing", text, length));
+}
+
+void test_keys_inside_values_do_not_match() {
+  TEST_ASSERT_TRUE(parse("{\"text\":\"line\",\"meta\":{\"line\":9,\"x\":[\"]\"]},\"x\":5,\"line\":2}"));
+  long number = 0;
+  TEST_ASSERT_TRUE(gJson.getInt("line", number));
+  TEST_ASSERT_EQUAL(2, number);
+  TEST_ASSERT_TRUE(gJson.getInt("x", number));
+  TEST_ASSERT_EQUAL(5, number);
+
+  const JsonField *meta = gJson.find("meta");
+  TEST_ASSERT_NOT_NULL(meta);
+  TEST_ASSERT_TRUE(meta->kind == JsonKind::Object);
+  TEST_ASSERT_EQUAL_STRING("{\"line\":9,\"x\":[\"]\"]}", meta->value);
+}
+
+void test_unescapes_strings_in_place() {
+  TEST_ASSERT_TRUE(parse("{\"text\":\"a\\\"b\\\\c\\n\\u0041\\u041f\"}"));
+  const char *text = nullptr;
+  size_t length = 0;
+  TEST_ASSERT_TRUE(gJson.getString("text", text, length));
+  TEST_ASSERT_EQUAL_STRING("a\"b\\c\nA\xD0\x9F", text);
+  TEST_ASSERT_EQUAL_size_t(9, length);
+}
+
+void test_rejects_malformed_objects() {
+  TEST_ASSERT_FALSE(parse("{\"type\":\"ping\""));
+  TEST_ASSERT_FALSE(parse("{\"type\":\"ping\",}"));
+  TEST_ASSERT_FALSE(parse("{\"type\" \"ping\"}"));
+  TEST_ASSERT_FALSE(parse("{\"type\":\"ping\"} trailing"));
+  TEST_ASSERT_FALSE(parse("{\"enabled\":tru}"));
+  TEST_ASSERT_FALSE(parse("[1,2]"));
+  TEST_ASSERT_TRUE(parse(" { } "));
+  TEST_ASSERT_EQUAL_UINT8(0, gJson.count());
+}
+
+void test_members_past_capacity_are_validated_but_not_indexed() {
+  TEST_ASSERT_TRUE(parse("{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9}"));
+  TEST_ASSERT_EQUAL_UINT8(JsonFieldIndex::MAX_FIELDS, gJson.count());
+  TEST_ASSERT_NULL(gJson.find("i"));
+  TEST_ASSERT_FALSE(parse("{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":}"));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_indexes_typed_fields_in_one_pass);
+  RUN_TEST(test_keys_inside_values_do_not_match);
+  RUN_TEST(test_unescapes_strings_in_place);
+  RUN_TEST(test_rejects_malformed_objects);
+  RUN_TEST(test_members_past_capacity_are_validated_but_not_indexed);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/tx_queue.h"
+
+static TxQueue gQueue;
+static char gWire[4096];
+static size_t gWireLength = 0;
+
+// Models Serial.availableForWrite(): at most `room` bytes leave per call.
+static void drain(size_t room) {
+  const uint8_t *chunk = nullptr;
+  while (room > 0) {
+    size_t length = gQueue.peek(chunk);
+    if (length == 0) {
+      return;
+    }
+    if (length > room) {
+      length = room;
+    }
+    memcpy(gWire + gWireLength, chunk, length);
+    gWireLength += length;
+    gQueue.consume(length);
+    room -= length;
+  }
+}
+
+static void drainAll() {
+  while (!gQueue.idle()) {
+    drain(7);
+  }
+  gWire[gWireLength] = '\0';
+}
+
+static bool push(TxPriority priority, const char *frame) {
+  return gQueue.push(priority, frame, strlen(frame));
+}
+
+void test_higher_priority_frames_go_first() {
+  push(TxPriority::Debug, "debug\n");
+  push(TxPriority::Event, "key\n");
+  push(TxPriority::Ack, "ack\n");
+  push(TxPriority::Motion, "motion_done\n");
+  drainAll();
+  TEST_ASSERT_EQUAL_STRING("motion_done\nack\nkey\ndebug\n", gWire);
+}
+
+void test_frame_in_flight_is_never_interleaved() {
+  push(TxPriority::Event, "switch_state\n");
+  drain(4);
+  push(TxPriority::Motion, "stop\n");
+  push(TxPriority::Event, "rfid\n");
+  drainAll();
+  TEST_ASSERT_EQUAL_STRING("switch_state\nstop\nrfid\n", gWire);
+}
+
+void test_debug_drops_oldest_and_counts() {
+  char frame[64];
+  for (int i = 0; i < 40; i++) {
+    snprintf(frame, sizeof(frame), "debug_%02d\n", i);
+    TEST_ASSERT_TRUE(push(TxPriority::Debug, frame));
+  }
+  const uint16_t dropped = gQueue.dropped(TxPriority::Debug);
+  TEST_ASSERT_GREATER_THAN(0, dropped);
+  drainAll();
+  // The survivors are the newest frames, still in order.
+  char expected[32];
+  snprintf(expected, sizeof(expected), "debug_%02u\n", dropped);
+  TEST_ASSERT_EQUAL_MEMORY(expected, gWire, strlen(expected));
+  TEST_ASSERT_EQUAL_STRING("debug_39\n", gWire + gWireLength - 9);
+}
+
+void test_other_classes_drop_newest_and_count() {
+  char frame[64];
+  int accepted = 0;
+  for (int i = 0; i < 40; i++) {
+    snprintf(frame, sizeof(frame), "ack_%02d\n", i);
+    accepted += push(TxPriority::Ack, frame) ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL_UINT16(40 - accepted, gQueue.dropped(TxPriority::Ack));
+  TEST_ASSERT_EQUAL_UINT16(0, gQueue.dropped(TxPriority::Motion));
+  drainAll();
+  TEST_ASSERT_EQUAL_MEMORY("ack_00\n", gWire, 7);
+}
+
+void test_rejects_oversized_frames() {
+  char frame[TxQueue::MAX_FRAME_LENGTH + 1];
+  memset(frame, 'x', sizeof(frame));
+  TEST_ASSERT_FALSE(gQueue.push(TxPriority::Motion, frame, sizeof(frame)));
+  TEST_ASSERT_TRUE(gQueue.push(TxPriority::Motion, frame, TxQueue::MAX_FRAME_LENGTH));
+  TEST_ASSERT_EQUAL_UINT16(1, gQueue.dropped(TxPriority::Motion));
+  drainAll();
+  TEST_ASSERT_EQUAL_size_t(TxQueue::MAX_FRAME_LENGTH, gWireLength);
+}
+
+static void fillFrame(char *frame, size_t length, const char *prefix) {
+  memset(frame, 'x', length);
+  memcpy(frame, prefix, strlen(prefix));
+  frame[length - 1] = '\n';
+  frame[length] = '\0';
+}
+
+void test_motion_done_stop_ack_and_estop_all_fit() {
+  // Sizes of a motion_done with pose, a stop ack and an estop event, then the
+  // same three at the maximum frame length.
+  const size_t lengths[2][3] = {{135, 100, 110},
+                                {TxQueue::MAX_FRAME_LENGTH, TxQueue::MAX_FRAME_LENGTH,
+                                 TxQueue::MAX_FRAME_LENGTH}};
+  const char *prefixes[3] = {"motion_done", "stop_ack", "estop"};
+  for (int set = 0; set < 2; set++) {
+    const size_t *row = lengths[set];
+    gQueue = TxQueue();
+    gWireLength = 0;
+    char frames[3][TxQueue::MAX_FRAME_LENGTH + 1];
+    for (int i = 0; i < 3; i++) {
+      fillFrame(frames[i], row[i], prefixes[i]);
+      TEST_ASSERT_TRUE(push(TxPriority::Motion, frames[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, gQueue.dropped(TxPriority::Motion));
+    drainAll();
+    TEST_ASSERT_EQUAL_size_t(row[0] + row[1] + row[2], gWireLength);
+    TEST_ASSERT_EQUAL_MEMORY(frames[0], gWire, row[0]);
+    TEST_ASSERT_EQUAL_MEMORY(frames[1], gWire + row[0], row[1]);
+    TEST_ASSERT_EQUAL_MEMORY(frames[2], gWire + row[0] + row[1], row[2]);
+  }
+}
+
+void test_rings_wrap_without_corruption() {
+  char frame[64];
+  for (int round = 0; round < 100; round++) {
+    snprintf(frame, sizeof(frame), "event_with_some_padding_%03d\n", round);
+    TEST_ASSERT_TRUE(push(TxPriority::Event, frame));
+    gWireLength = 0;
+    drainAll();
+    TEST_ASSERT_EQUAL_STRING(frame, gWire);
+  }
+}
+
+void setUp() {
+  gQueue = TxQueue();
+  gWireLength = 0;
+  gWire[0] = '\0';
+}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_higher_priority_frames_go_first);
+  RUN_TEST(test_frame_in_flight_is_never_interleaved);
+  RUN_TEST(test_debug_drops_oldest_and_counts);
+  RUN_TEST(test_other_classes_drop_newest_and_count);
+  RUN_TEST(test_rejects_oversized_frames);
+  RUN_TEST(test_motion_done_stop_ack_and_estop_all_fit);
+  RUN_TEST(test_rings_wrap_without_corruption);
+  return UNITY_END();
+}
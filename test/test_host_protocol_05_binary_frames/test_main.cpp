@@ -0,0 +1,181 @@
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../src/binary_frame.h"
+#include "../../src/json_writer.h"
+
+// Golden frames are shared with tests/test_binary_codec.py; the Pi decoder
+// must turn each one back into the JSON mode's message.
+
+static char gFrame[193];
+static JsonWriter gJson;
+static BinaryFrameWriter gBinary;
+static size_t gWireLength = 0;
+
+static FrameWriter &begin(FrameWriter &writer, const char *type) {
+  if (&writer == &gBinary) {
+    gBinary.reset(gFrame + 1, sizeof(gFrame) - 4);
+  } else {
+    gJson.reset(gFrame, sizeof(gFrame) - 1);
+  }
+  return writer.beginObject().field("type", type);
+}
+
+static void finish(FrameWriter &writer) {
+  writer.endObject();
+  TEST_ASSERT_FALSE(writer.overflowed());
+  if (&writer == &gBinary) {
+    gWireLength = sealBinaryFrame(reinterpret_cast<uint8_t *>(gFrame), writer.length());
+  } else {
+    gWireLength = writer.length();
+    gFrame[gWireLength++] = '\n';
+  }
+}
+
+static void keyEvent(FrameWriter &writer) {
+  begin(writer, "event").field("event", "key_event").field("key", '5').field("state", "pressed");
+  finish(writer);
+}
+
+static void lcdAck(FrameWriter &writer) {
+  begin(writer, "ack")
+      .field("command", "lcd_set_line")
+      .field("seq", 17)
+      .field("line", 2)
+      .field("text", "Queue: 2 \"ready\"");
+  finish(writer);
+}
+
+static void stateEvent(FrameWriter &writer) {
+  FrameWriter &state = begin(writer, "event").field("event", "state");
+  state.field("drive_busy", true).field("drive_action", "forward_cell");
+  state.beginArray("switches").value(true).value(false).endArray();
+  state.beginArray("locks").value("closed").value("open").endArray();
+  state.field("rx_overflows", 0);
+  state.beginArray("tx_dropped").value(0).value(0).value(3).value(120).endArray();
+  finish(writer);
+}
+
+static void busyError(FrameWriter &writer) {
+  begin(writer, "error")
+      .field("code", "drive_busy")
+      .field("message", "Drive controller is busy")
+      .field("current", "turn_left")
+      .field("seq", -1);
+  finish(writer);
+}
+
+struct FrameCase {
+  const char *name;
+  void (*emit)(FrameWriter &);
+  const char *golden;
+  size_t goldenLength;
+};
+
+#define GOLDEN(bytes) bytes, sizeof(bytes) - 1
+
+static const FrameCase kCases[] = {
+    {"key_event", keyEvent, GOLDEN("\x0C\x1A\x1A\x2B\x2A\xF0\x01\x35\x50\x44\xFF\x47\x00")},
+    {"lcd_set_line ack", lcdAck,
+     GOLDEN("\x01\x1E\x0C\x32\x4C\xF3\x22\x34\xF3\x04\x55\xF0\x10\x51\x75\x65\x75\x65\x3A\x20"
+            "\x32\x20\x22\x72\x65\x61\x64\x79\x22\x1D\x41\x00")},
+    {"state", stateEvent,
+     GOLDEN("\x14\x1A\x1A\x50\x16\xF1\x15\x1E\x54\xF5\xF1\xF2\xF7\x37\xF5\x0A\x42\xF7\x4B\xF3"
+            "\x04\x58\xF5\xF3\x02\xF3\x09\xF3\x06\xF3\xF0\x01\xF7\x80\x38\x00")},
+    {"drive_busy error", busyError,
+     GOLDEN("\x26\x19\x0B\x16\x38\xF0\x18\x44\x72\x69\x76\x65\x20\x63\x6F\x6E\x74\x72\x6F\x6C"
+            "\x6C\x65\x72\x20\x69\x73\x20\x62\x75\x73\x79\x0F\x56\x4C\xF3\x01\xC8\xFE\x00")},
+};
+
+void test_crc_matches_the_ccitt_false_check_value() {
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt(reinterpret_cast<const uint8_t *>("123456789"), 9));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, crc16Ccitt(nullptr, 0));
+}
+
+void test_symbols_are_found_by_binary_search() {
+  TEST_ASSERT_EQUAL_UINT8(0, findBinarySymbol("ack", 3));
+  TEST_ASSERT_EQUAL_UINT8(binarySymbolCount() - 1, findBinarySymbol("unsupported_command", 19));
+  TEST_ASSERT_EQUAL_UINT8(binary_frame::NO_SYMBOL, findBinarySymbol("ac", 2));
+  TEST_ASSERT_EQUAL_UINT8(binary_frame::NO_SYMBOL, findBinarySymbol("acks", 4));
+  TEST_ASSERT_EQUAL_UINT8(binary_frame::NO_SYMBOL, findBinarySymbol("", 0));
+  // Bounded: "lcd_set" is found inside the longer text.
+  TEST_ASSERT_EQUAL_UINT8(findBinarySymbol("lcd_set", 7), findBinarySymbol("lcd_set_line", 7));
+}
+
+void test_frames_match_golden_vectors() {
+  for (const FrameCase &frameCase : kCases) {
+    frameCase.emit(gBinary);
+    TEST_ASSERT_EQUAL_size_t(frameCase.goldenLength, gWireLength);
+    TEST_ASSERT_EQUAL_MEMORY(frameCase.golden, gFrame, gWireLength);
+    // Only the delimiter may be zero after COBS.
+    TEST_ASSERT_NULL(memchr(gFrame, 0, gWireLength - 1));
+  }
+}
+
+void test_seal_rejects_payloads_longer_than_one_cobs_block() {
+  uint8_t frame[binary_frame::MAX_PAYLOAD + 8] = {};
+  TEST_ASSERT_EQUAL_size_t(binary_frame::MAX_PAYLOAD + 4,
+                           sealBinaryFrame(frame, binary_frame::MAX_PAYLOAD));
+  TEST_ASSERT_NULL(memchr(frame, 0, binary_frame::MAX_PAYLOAD + 3));
+  TEST_ASSERT_EQUAL_size_t(0, sealBinaryFrame(frame, binary_frame::MAX_PAYLOAD + 1));
+}
+
+void test_long_strings_overflow_instead_of_truncating() {
+  char text[300];
+  memset(text, 'x', sizeof(text));
+  char payload[400];
+  gBinary.reset(payload, sizeof(payload));
+  gBinary.beginObject().field("text", text, sizeof(text)).endObject();
+  TEST_ASSERT_TRUE(gBinary.overflowed());
+}
+
+static constexpr unsigned long kIterations = 200000;
+
+template <typename Fn>
+static double nanosPerCall(Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < kIterations; i++) {
+    fn();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / kIterations;
+}
+
+void test_report_bytes_and_events_per_second() {
+  // At 115200 8N1 a byte costs 10 bit times; that, not encoding, bounds the
+  // event rate on the wire.
+  static constexpr double kBytesPerSecond = 115200.0 / 10.0;
+  printf("\n%-18s %8s %8s %10s %10s %10s %10s\n", "frame", "json B", "bin B", "json ev/s",
+         "bin ev/s", "json ns", "bin ns");
+  for (const FrameCase &frameCase : kCases) {
+    frameCase.emit(gJson);
+    const size_t jsonBytes = gWireLength;
+    frameCase.emit(gBinary);
+    const size_t binaryBytes = gWireLength;
+
+    const double jsonNs = nanosPerCall([&] { frameCase.emit(gJson); });
+    const double binaryNs = nanosPerCall([&] { frameCase.emit(gBinary); });
+    printf("%-18s %8zu %8zu %10.0f %10.0f %10.1f %10.1f\n", frameCase.name, jsonBytes,
+           binaryBytes, kBytesPerSecond / jsonBytes, kBytesPerSecond / binaryBytes, jsonNs,
+           binaryNs);
+    TEST_ASSERT_LESS_THAN(jsonBytes / 2, binaryBytes);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_matches_the_ccitt_false_check_value);
+  RUN_TEST(test_symbols_are_found_by_binary_search);
+  RUN_TEST(test_frames_match_golden_vectors);
+  RUN_TEST(test_seal_rejects_payloads_longer_than_one_cobs_block);
+  RUN_TEST(test_long_strings_overflow_instead_of_truncating);
+  RUN_TEST(test_report_bytes_and_events_per_second);
+  return UNITY_END();
+}
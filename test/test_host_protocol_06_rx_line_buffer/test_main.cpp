@@ -0,0 +1,114 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/rx_line_buffer.h"
+
+static RxLineBuffer gRx;
+
+static uint8_t pushText(const char *text) {
+  uint8_t stops = 0;
+  for (const char *ch = text; *ch != '\0'; ++ch) {
+    if (gRx.push(*ch) == RxByte::EmergencyStop) {
+      stops++;
+    }
+  }
+  return stops;
+}
+
+static void assertNextLine(const char *expected) {
+  LineView line;
+  TEST_ASSERT_TRUE(gRx.takeLine(line));
+  TEST_ASSERT_EQUAL_STRING(expected, line.data);
+  TEST_ASSERT_EQUAL_UINT(strlen(expected), line.length);
+}
+
+static void test_lines_are_trimmed_and_handed_out_in_order() {
+  pushText("  @P#1 \r\n\n@G#2\r\n@L#3|0|");
+  TEST_ASSERT_EQUAL_UINT16(3, gRx.lines());
+
+  assertNextLine("@P#1");
+  assertNextLine("@G#2");
+  LineView line;
+  TEST_ASSERT_FALSE(gRx.takeLine(line));
+
+  gRx.release();
+  pushText("Hi\n");
+  assertNextLine("@L#3|0|Hi");
+}
+
+static void test_stop_byte_drops_the_partial_line_it_interrupts() {
+  // The head of the line was sent before the stop; the Pi sends nothing
+  // after the stop byte that could complete it.
+  TEST_ASSERT_EQUAL_UINT8(1, pushText("@M#4|forward_\x18@P#5\n"));
+  TEST_ASSERT_EQUAL_UINT16(1, gRx.lines());
+  assertNextLine("@P#5");
+  LineView line;
+  TEST_ASSERT_FALSE(gRx.takeLine(line));
+}
+
+static void test_stop_byte_drops_lines_that_were_waiting() {
+  TEST_ASSERT_EQUAL_UINT8(1, pushText("@M#5|forward_cell\n@Q#6|f*3\n@L#7|\x18@P#8\n"));
+  TEST_ASSERT_EQUAL_UINT16(1, gRx.lines());
+  assertNextLine("@P#8");
+}
+
+static void test_stop_byte_keeps_the_line_being_handled() {
+  // Bytes pumped while a line is handled must not move it.
+  pushText("@O#9|1\n");
+  LineView handled;
+  TEST_ASSERT_TRUE(gRx.takeLine(handled));
+  pushText("@X#10|1\n\x18@T");
+  TEST_ASSERT_EQUAL_STRING("@O#9|1", handled.data);
+  TEST_ASSERT_EQUAL_UINT16(0, gRx.lines());
+
+  gRx.release();
+  pushText("#13\n");
+  assertNextLine("@T#13");
+}
+
+static void test_overlong_line_is_reported_once_the_buffer_fills() {
+  for (size_t i = 0; i + 1 < RxLineBuffer::CAPACITY; ++i) {
+    gRx.push('x');
+  }
+  TEST_ASSERT_FALSE(gRx.full());
+  gRx.push('\n');
+  TEST_ASSERT_TRUE(gRx.full());
+  TEST_ASSERT_FALSE(gRx.overlong());
+  LineView line;
+  TEST_ASSERT_TRUE(gRx.takeLine(line));
+  TEST_ASSERT_EQUAL_UINT(RxLineBuffer::CAPACITY - 1, line.length);
+
+  gRx.release();
+  for (size_t i = 0; i < RxLineBuffer::CAPACITY; ++i) {
+    gRx.push('y');
+  }
+  TEST_ASSERT_TRUE(gRx.overlong());
+}
+
+static void test_full_buffer_with_waiting_lines_is_not_overlong() {
+  pushText("@P#14\n");
+  while (!gRx.full()) {
+    gRx.push('z');
+  }
+  TEST_ASSERT_FALSE(gRx.overlong());
+  assertNextLine("@P#14");
+  TEST_ASSERT_FALSE(gRx.overlong());
+  gRx.release();
+  TEST_ASSERT_FALSE(gRx.full());
+}
+
+void setUp() { gRx.clear(); }
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lines_are_trimmed_and_handed_out_in_order);
+  RUN_TEST(test_stop_byte_drops_the_partial_line_it_interrupts);
+  RUN_TEST(test_stop_byte_drops_lines_that_were_waiting);
+  RUN_TEST(test_stop_byte_keeps_the_line_being_handled);
+  RUN_TEST(test_overlong_line_is_reported_once_the_buffer_fills);
+  RUN_TEST(test_full_buffer_with_waiting_lines_is_not_overlong);
+  return UNITY_END();
+}
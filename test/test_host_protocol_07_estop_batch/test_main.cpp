@@ -0,0 +1,104 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "../../src/batch_dispatch.h"
+#include "../../src/compact_fields.h"
+#include "../../src/rx_line_buffer.h"
+
+// Mirrors how the bridge runs a batch: the line is taken from the RX buffer,
+// the emergency stop count is noted, and sub-commands that lap_() may pump
+// more bytes (and take an emergency stop) before the next one runs.
+
+static constexpr uint8_t MAX_BATCH_COMMANDS = 6;
+
+static RxLineBuffer gRx;
+static uint8_t gStops = 0;
+static bool gMotorsStarted = false;
+
+static void pumpText(const char *text) {
+  for (const char *ch = text; *ch != '\0'; ++ch) {
+    if (gRx.push(*ch) == RxByte::EmergencyStop) {
+      gStops++;
+    }
+  }
+}
+
+struct BatchRun {
+  const char *statuses[MAX_BATCH_COMMANDS];
+  uint8_t count;
+  uint8_t ran;
+};
+
+static BatchRun runLine(const char *arrivingDuringLcd) {
+  BatchRun run;
+  LineView line;
+  TEST_ASSERT_TRUE(gRx.takeLine(line));
+  const uint8_t lineStops = gStops;
+
+  CompactSegment segments[MAX_BATCH_COMMANDS + 1];
+  const uint8_t count =
+      splitCompactBatch(line.data + 1, line.length - 1, segments, MAX_BATCH_COMMANDS + 1);
+  run.count = count - 1;
+  run.ran = runBatch(
+      run.count, run.statuses,
+      [&](uint8_t i) -> const char * {
+        const char opcode = segments[i + 1].data[0];
+        if (opcode == 'L') {
+          // The LCD write laps, and the lap pumps what arrived meanwhile.
+          pumpText(arrivingDuringLcd);
+        } else if (opcode == 'M') {
+          gMotorsStarted = true;
+        }
+        return "ok";
+      },
+      [&]() { return gStops != lineStops; });
+  return run;
+}
+
+static void test_batch_runs_in_full_without_an_emergency_stop() {
+  pumpText("@B#1;L|0|Hi;M|forward_cell\n");
+  const BatchRun run = runLine("");
+
+  TEST_ASSERT_EQUAL_UINT8(2, run.ran);
+  TEST_ASSERT_EQUAL_STRING("ok", run.statuses[1]);
+  TEST_ASSERT_TRUE(gMotorsStarted);
+}
+
+static void test_emergency_stop_between_lcd_and_move_drops_the_move() {
+  pumpText("@B#2;L|0|Hi;M|forward_cell;P\n");
+  const BatchRun run = runLine("@P#3\n\x18");
+
+  TEST_ASSERT_EQUAL_UINT8(3, run.count);
+  TEST_ASSERT_EQUAL_UINT8(1, run.ran);
+  TEST_ASSERT_EQUAL_STRING("ok", run.statuses[0]);
+  TEST_ASSERT_EQUAL_STRING(DROPPED_STATUS, run.statuses[1]);
+  TEST_ASSERT_EQUAL_STRING(DROPPED_STATUS, run.statuses[2]);
+  TEST_ASSERT_FALSE(gMotorsStarted);
+  // The line that arrived during the LCD write was sent before the stop too.
+  TEST_ASSERT_EQUAL_UINT16(0, gRx.lines());
+}
+
+static void test_emergency_stop_before_the_line_does_not_drop_it() {
+  pumpText("\x18@B#4;L|0|Hi;M|forward_cell\n");
+  const BatchRun run = runLine("");
+
+  TEST_ASSERT_EQUAL_UINT8(2, run.ran);
+  TEST_ASSERT_TRUE(gMotorsStarted);
+}
+
+void setUp() {
+  gRx.clear();
+  gStops = 0;
+  gMotorsStarted = false;
+}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_runs_in_full_without_an_emergency_stop);
+  RUN_TEST(test_emergency_stop_between_lcd_and_move_drops_the_move);
+  RUN_TEST(test_emergency_stop_before_the_line_does_not_drop_it);
+  return UNITY_END();
+}
@@ -0,0 +1,91 @@
+#include <unity.h>
+
+#include "../../src/task_scheduler.h"
+
+static const TaskSpec kTasks[] = {
+    {"motion", 1000, 200, true},
+    {"rx", 1000, 5000, false},
+    {"keypad", 10000, 500, false},
+    {"rfid", 50000, 3000, false},
+};
+
+static TaskScheduler gScheduler;
+
+// Runs whatever is due at `now` for `runUs`, returns its index.
+static uint8_t runAt(uint32_t now, uint32_t runUs) {
+  const uint8_t task = gScheduler.nextDue(now);
+  if (task != TaskScheduler::NO_TASK) {
+    gScheduler.finish(task, now, now + runUs);
+  }
+  return task;
+}
+
+void test_critical_task_goes_first_then_earliest_deadline() {
+  gScheduler.begin(kTasks, 4, 0);
+  TEST_ASSERT_TRUE(gScheduler.criticalDue(0));
+  TEST_ASSERT_EQUAL_UINT8(0, runAt(0, 10));
+  TEST_ASSERT_FALSE(gScheduler.criticalDue(10));
+  TEST_ASSERT_EQUAL_UINT8(1, runAt(10, 10));
+  TEST_ASSERT_EQUAL_UINT8(2, runAt(20, 10));
+  TEST_ASSERT_EQUAL_UINT8(3, runAt(30, 10));
+  TEST_ASSERT_EQUAL_UINT8(TaskScheduler::NO_TASK, runAt(40, 10));
+}
+
+void test_motion_preempts_pending_low_priority_work() {
+  gScheduler.begin(kTasks, 4, 0);
+  runAt(0, 10);
+  runAt(10, 10);
+  // keypad and rfid are still waiting; once motion is due again it jumps the
+  // queue, and rx's next release beats them on deadline too.
+  TEST_ASSERT_EQUAL_UINT8(0, runAt(1000, 10));
+  TEST_ASSERT_EQUAL_UINT8(1, runAt(1010, 10));
+  TEST_ASSERT_EQUAL_UINT8(2, runAt(1020, 10));
+}
+
+void test_periods_release_tasks_on_time() {
+  gScheduler.begin(kTasks, 1, 0);
+  runAt(0, 10);
+  TEST_ASSERT_EQUAL_UINT8(TaskScheduler::NO_TASK, runAt(999, 10));
+  TEST_ASSERT_EQUAL_UINT8(0, runAt(1000, 10));
+  TEST_ASSERT_EQUAL_UINT16(2, gScheduler.stats(0).runs);
+}
+
+void test_overruns_and_late_runs_are_counted() {
+  gScheduler.begin(kTasks, 4, 0);
+  runAt(0, 10);
+  runAt(10, 8000);  // rx blows its 5 ms budget and blocks everything
+  const TaskStats &rx = gScheduler.stats(1);
+  TEST_ASSERT_EQUAL_UINT32(8000, rx.lastRunUs);
+  TEST_ASSERT_EQUAL_UINT32(8000, rx.maxRunUs);
+  TEST_ASSERT_EQUAL_UINT16(1, rx.overruns);
+  TEST_ASSERT_EQUAL_UINT16(1, rx.late);
+
+  // Motion missed seven releases; it runs once, late, and is not replayed.
+  TEST_ASSERT_EQUAL_UINT8(0, runAt(8010, 10));
+  TEST_ASSERT_EQUAL_UINT16(1, gScheduler.stats(0).late);
+  TEST_ASSERT_FALSE(gScheduler.criticalDue(8020));
+  TEST_ASSERT_TRUE(gScheduler.criticalDue(9010));
+}
+
+void test_micros_wraparound() {
+  const uint32_t start = 0xFFFFFF00UL;
+  gScheduler.begin(kTasks, 1, start);
+  runAt(start, 10);
+  TEST_ASSERT_EQUAL_UINT8(TaskScheduler::NO_TASK, gScheduler.nextDue(start + 500));
+  TEST_ASSERT_EQUAL_UINT8(0, gScheduler.nextDue(start + 1000));
+  TEST_ASSERT_EQUAL_UINT16(0, gScheduler.stats(0).late);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_critical_task_goes_first_then_earliest_deadline);
+  RUN_TEST(test_motion_preempts_pending_low_priority_work);
+  RUN_TEST(test_periods_release_tasks_on_time);
+  RUN_TEST(test_overruns_and_late_runs_are_counted);
+  RUN_TEST(test_micros_wraparound);
+  return UNITY_END();
+}
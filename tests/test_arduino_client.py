@@ -0,0 +1,275 @@
+from __future__ import annotations
+
+from typing import Any
+
+from pi.arduino_client import ArduinoClient
+from pi.models import Pose, RouteSegment
+from pi.protocol import encode_compact_command
+
+
+class FakePipelineLink:
+    def __init__(self) -> None:
+        self.sent: list[bytes] = []
+        self.incoming: list[dict[str, Any]] = []
+
+    def send_raw_line(self, payload: bytes, debug_label: str) -> None:
+        self.sent.append(payload)
+
+    def send_control_byte(self, value: bytes, debug_label: str) -> None:
+        self.sent.append(value)
+
+    def read_message(self) -> dict[str, Any] | None:
+        if self.incoming:
+            return self.incoming.pop(0)
+        return None
+
+    def link_mode(self) -> str:
+        return "json"
+
+
+def ack(seq: int, command: str = "lcd_set_line") -> dict[str, Any]:
+    return {"type": "ack", "command": command, "seq": seq}
+
+
+def test_compact_command_carries_sequence_id() -> None:
+    assert encode_compact_command("lcd_set_line", 2, "Hi", seq=17) == b"@L#17|2|Hi\n"
+    assert encode_compact_command("stop", seq=0x10001) == b"@T#1\n"
+    assert encode_compact_command("stop") == b"@T\n"
+
+
+def test_lcd_update_is_sent_as_one_pipelined_burst() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    client.lcd_set(["a", "b", "c", "d"])
+
+    assert link.sent == [
+        b"@L#0|0|a\n",
+        b"@L#1|1|b\n",
+        b"@L#2|2|c\n",
+        b"@L#3|3|d\n",
+    ]
+    assert client.lcd_busy()
+
+    for seq in (2, 0, 3, 1):
+        client.handle_message(ack(seq))
+    assert client.in_flight() == 0
+    assert not client.lcd_busy()
+
+
+def test_acks_are_matched_by_sequence_not_by_name() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+    client.lcd_set(["a", "b", "", ""])
+
+    client.handle_message({"type": "ack", "command": "lcd_set_line", "line": 0})
+    assert client.in_flight() == 2
+
+    client.handle_message({"type": "error", "code": "lcd_write_failed", "seq": 1})
+    client.handle_message(ack(0))
+    assert client.in_flight() == 0
+
+
+def test_full_window_waits_for_an_ack_and_keeps_other_messages() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=2)  # type: ignore[arg-type]
+    client.ping()
+    client.get_state()
+    key_event = {"type": "event", "event": "key_event", "key": "1"}
+    link.incoming = [key_event, ack(0, "ping")]
+
+    client.servo_open(1)
+
+    assert link.sent[-1] == b"@O#2|1\n"
+    assert client.read_message() == key_event
+    assert client.read_message() == ack(0, "ping")
+
+
+def test_stop_bypasses_a_full_window() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=1)  # type: ignore[arg-type]
+    client.move("forward_cell")
+
+    client.stop()
+
+    assert link.sent == [b"@M#0|forward_cell\n", b"@T#1\n"]
+
+
+def test_emergency_stop_is_one_byte_outside_window_and_batch() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=1)  # type: ignore[arg-type]
+    client.handle_message({"type": "event", "event": "ready", "rx_window": 63})
+    client.move("forward_cell")
+
+    with client.batch():
+        client.servo_close(1)
+        client.emergency_stop()
+
+    assert link.sent == [b"@M#0|forward_cell\n", b"\x18", b"@X#1|1\n"]
+    assert client.credit_outstanding() == len(b"@M#0|forward_cell\n") + 1 + 7
+    assert client.in_flight() == 1
+
+
+def test_clear_emergency_stop_is_a_compact_command() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+    client.emergency_stop()
+
+    client.clear_emergency_stop()
+
+    assert link.sent == [b"\x18", b"@E#0\n"]
+    assert client.in_flight() == 1
+
+
+def test_unacknowledged_commands_expire_after_timeout() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4, ack_timeout_s=0.0)  # type: ignore[arg-type]
+    client.lcd_set(["a", "", "", ""])
+
+    assert not client.lcd_busy()
+
+
+def test_batch_block_sends_one_frame_with_escaped_fields() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    with client.batch():
+        client.servo_close(1)
+        client.lcd_set(["Moving; 2", "", "", ""])
+        client.move("forward_cell")
+
+    assert link.sent == [b"@B#0;X|1;L|0|Moving\\; 2;M|forward_cell\n"]
+    assert client.lcd_busy()
+    client.handle_message(
+        {"type": "ack", "command": "batch", "seq": 0, "status": ["ok", "ok", "ok"]}
+    )
+    assert client.in_flight() == 0
+
+
+def test_batch_splits_long_blocks_and_never_holds_stop() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    with client.batch():
+        for _ in range(7):
+            client.ping()
+        client.stop()
+
+    assert link.sent[0] == b"@T#0\n"
+    assert link.sent[1] == b"@B#1;P;P;P;P;P;P\n"
+    assert link.sent[2] == b"@P#2\n"
+
+
+class FakeBaudLink(FakePipelineLink):
+    def __init__(self, pong_at_new_rate: bool) -> None:
+        super().__init__()
+        self.rate = 115200
+        self.rates: list[int] = []
+        self.pong_at_new_rate = pong_at_new_rate
+
+    def baudrate(self) -> int:
+        return self.rate
+
+    def set_baudrate(self, baudrate: int) -> None:
+        self.rate = baudrate
+        self.rates.append(baudrate)
+
+    def send_raw_line(self, payload: bytes, debug_label: str) -> None:
+        super().send_raw_line(payload, debug_label)
+        seq = int(payload.split(b"#")[1].split(b"|")[0].rstrip(b"\n"))
+        if payload.startswith(b"@U"):
+            self.incoming.append(ack(seq, "set_baud"))
+        elif self.pong_at_new_rate:
+            self.incoming.append(ack(seq, "ping"))
+        else:
+            self.incoming.append({"type": "event", "event": "baud_fallback"})
+
+
+READY = {"type": "event", "event": "ready", "bauds": [115200, 250000, 500000]}
+
+
+def test_baud_upgrade_is_confirmed_with_a_ping() -> None:
+    link = FakeBaudLink(pong_at_new_rate=True)
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    assert client.negotiate_baud(500000, READY)
+
+    assert link.sent == [b"@U#0|500000\n", b"@P#1\n"]
+    assert link.rates == [500000]
+    assert client.in_flight() == 0
+
+
+def test_baud_upgrade_falls_back_without_a_pong() -> None:
+    link = FakeBaudLink(pong_at_new_rate=False)
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    assert not client.negotiate_baud(500000, READY, timeout_s=0.05)
+
+    assert link.rates == [500000, 115200]
+
+
+def test_unadvertised_baud_is_not_requested() -> None:
+    link = FakeBaudLink(pong_at_new_rate=True)
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    assert not client.negotiate_baud(1000000, READY)
+    assert link.sent == []
+
+
+def test_route_goes_out_as_one_compact_command() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    client.route(
+        [
+            RouteSegment("forward_cell", cells=3),
+            "forward_cell",
+            RouteSegment("turn_left", duration_ms=480),
+            "reverse_cell",
+            "arc_right",
+        ]
+    )
+
+    assert link.sent == [b"@Q#0|f*3,f,l:480,b,R\n"]
+
+
+def test_replacing_moves_carry_the_replace_flag() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    client.route(["forward_cell", "turn_left"])
+    client.route([RouteSegment("forward_cell", cells=2)], replace=True)
+    client.move("turn_right", replace=True)
+
+    assert link.sent == [
+        b"@Q#0|f,l\n",
+        b"@Q#1|f*2|1\n",
+        b"@M#2|turn_right|0|1\n",
+    ]
+
+
+def test_calibration_is_pushed_in_batches_and_saved_last() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    client.calibration("ramp_ms")
+    client.drift_trim("forward", -35, 1800)
+    client.apply_calibration(
+        {"forward_cell_ms": 880, "turn_pwm": 100, "ramp_profile": 1}, save=True
+    )
+
+    assert link.sent == [
+        b"@K#0|ramp_ms\n",
+        b"@K#1|forward_drift|-35|1800\n",
+        b"@B#2;K|forward_cell_ms|880;K|turn_pwm|100;K|ramp_profile|1;K|save\n",
+    ]
+
+
+def test_pose_is_read_and_reset_in_firmware_units() -> None:
+    link = FakePipelineLink()
+    client = ArduinoClient(link, window=4)  # type: ignore[arg-type]
+
+    client.pose()
+    client.set_pose(Pose(2, 3, "W"))
+
+    assert link.sent == [b"@W#0\n", b"@W#1|2000|3000|2700\n"]
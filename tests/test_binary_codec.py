@@ -0,0 +1,166 @@
+from __future__ import annotations
+
+import re
+from pathlib import Path
+from typing import Any
+
+import pytest
+
+from pi.arduino_client import ArduinoClient
+from pi.binary_codec import (
+    SYMBOLS,
+    BinaryFrameError,
+    cobs_decode,
+    cobs_encode,
+    crc16,
+    decode_frame,
+    encode_frame,
+)
+from pi.protocol import encode_message
+from pi.serial_link import SerialJsonLink
+
+ROOT = Path(__file__).resolve().parent.parent
+
+# Same vectors as test/test_host_protocol_05_binary_frames.
+GOLDEN: list[tuple[dict[str, Any], bytes]] = [
+    (
+        {"type": "event", "event": "key_event", "key": "5", "state": "pressed"},
+        bytes.fromhex("0C1A1A2B2AF001355044FF4700"),
+    ),
+    (
+        {
+            "type": "ack",
+            "command": "lcd_set_line",
+            "seq": 17,
+            "line": 2,
+            "text": 'Queue: 2 "ready"',
+        },
+        bytes.fromhex(
+            "011E0C324CF32234F30455F0105175657565"
+            "3A203220227265616479221D4100"
+        ),
+    ),
+    (
+        {
+            "type": "event",
+            "event": "state",
+            "drive_busy": True,
+            "drive_action": "forward_cell",
+            "switches": [True, False],
+            "locks": ["closed", "open"],
+            "rx_overflows": 0,
+            "tx_dropped": [0, 0, 3, 120],
+        },
+        bytes.fromhex(
+            "141A1A5016F1151E54F5F1F2F737F50A42F74BF30458F5F302F309F306F3F001F7803800"
+        ),
+    ),
+]
+
+
+def test_symbol_table_matches_firmware() -> None:
+    source = (ROOT / "src" / "binary_frame.cpp").read_text()
+    table = source[source.index("SYMBOLS[][SYMBOL_WIDTH]") :]
+    table = table[: table.index("};")]
+    assert tuple(re.findall(r'"([a-z_]+)"', table)) == SYMBOLS
+
+
+def test_crc_and_cobs_reference_values() -> None:
+    assert crc16(b"123456789") == 0x29B1
+    assert cobs_encode(b"\x11\x00\x00\x22") == b"\x02\x11\x01\x02\x22"
+    for data in (b"", b"\x00", b"\x01" * 300, bytes(range(256))):
+        assert cobs_decode(cobs_encode(data)) == data
+
+
+@pytest.mark.parametrize(("message", "frame"), GOLDEN)
+def test_golden_frames_round_trip(message: dict[str, Any], frame: bytes) -> None:
+    assert encode_frame(message) == frame
+    assert decode_frame(frame) == message
+
+
+def test_corrupted_frame_is_rejected() -> None:
+    frame = bytearray(GOLDEN[0][1])
+    frame[3] ^= 0x01
+    with pytest.raises(BinaryFrameError):
+        decode_frame(bytes(frame))
+
+
+class FakeByteSerial:
+    def __init__(self, data: bytes) -> None:
+        self.data = bytearray(data)
+        self.writes: list[bytes] = []
+
+    def _take(self, count: int) -> bytes:
+        chunk = bytes(self.data[:count])
+        del self.data[:count]
+        return chunk
+
+    def read(self, size: int = 1) -> bytes:
+        return self._take(size)
+
+    def readline(self) -> bytes:
+        end = self.data.find(b"\n")
+        return self._take(len(self.data) if end < 0 else end + 1)
+
+    def read_until(self, expected: bytes = b"\n") -> bytes:
+        end = self.data.find(expected)
+        return self._take(len(self.data) if end < 0 else end + 1)
+
+    def write(self, payload: bytes) -> None:
+        self.writes.append(payload)
+
+    def flush(self) -> None:
+        return None
+
+
+def test_link_switches_framing_after_handshake() -> None:
+    ack = {"type": "ack", "command": "link_mode", "mode": "binary", "seq": 0}
+    switched = {"type": "event", "event": "link_mode", "mode": "binary"}
+    key_event = GOLDEN[0][0]
+    serial = FakeByteSerial(
+        encode_message(ack) + encode_frame(switched) + GOLDEN[0][1]
+    )
+    link = SerialJsonLink("/dev/null", 115200)
+    link._serial = serial
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    ready = {"type": "event", "event": "ready", "modes": ["json", "binary"]}
+    assert client.negotiate_link_mode("binary", ready)
+    client.ping()
+
+    assert serial.writes[0] == b"@Y#0|binary\n"
+    assert serial.writes[1] == b"@P#1*%04X\n" % crc16(b"@P#1")
+    assert [link.read_message() for _ in range(3)] == [ack, switched, key_event]
+
+
+def test_emergency_stop_byte_carries_no_crc_in_binary_mode() -> None:
+    serial = FakeByteSerial(b"")
+    link = SerialJsonLink("/dev/null", 115200)
+    link._serial = serial
+    link.set_link_mode("binary")
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    client.emergency_stop()
+
+    assert serial.writes == [b"\x18"]
+
+
+def test_frame_split_by_read_timeout_is_reassembled() -> None:
+    frame = GOLDEN[2][1]
+    serial = FakeByteSerial(frame[:10])
+    link = SerialJsonLink("/dev/null", 115200)
+    link._serial = serial
+    link.set_link_mode("binary")
+
+    assert link.read_message() is None
+    serial.data += frame[10:]
+    assert link.read_message() == GOLDEN[2][0]
+
+
+def test_old_firmware_stays_on_json() -> None:
+    link = SerialJsonLink("/dev/null", 115200)
+    link._serial = FakeByteSerial(b"")
+    client = ArduinoClient(link)  # type: ignore[arg-type]
+
+    assert not client.negotiate_link_mode("binary", {"event": "ready"})
+    assert link.link_mode() == "json"
@@ -1,6 +1,6 @@
 from pi.cabinet_index import CabinetIndex
 from pi.card_registry import CardRegistry
-from pi.config import load_project_config
+from pi.config import calibration_from_motion_config, load_project_config
 from pi.map_loader import load_grid_map
 
 
@@ -15,6 +15,43 @@ def test_project_config_loads_expected_files() -> None:
     assert "commands" in config.protocol_config
 
 
+def test_motion_config_maps_onto_calibration_keys() -> None:
+    config = load_project_config()
+
+    values = calibration_from_motion_config(config.motion_config)
+
+    assert values == {
+        "forward_cell_ms": 900,
+        "reverse_cell_ms": 900,
+        "turn_left_ms": 500,
+        "turn_right_ms": 500,
+        "arc_left_ms": 1650,
+        "arc_right_ms": 1650,
+        "forward_pwm": 110,
+        "turn_pwm": 120,
+        "arc_pwm": 130,
+        "arc_inner_permille": 450,
+        "ramp_ms": 120,
+        "encoder_ticks_cell": 0,
+        "encoder_ticks_turn": 0,
+        "encoder_ticks_arc": 0,
+        "encoder_kp": 20,
+        "encoder_ki": 30,
+        "left_forward_trim": 1000,
+        "right_forward_trim": 1000,
+        "left_reverse_trim": 1000,
+        "right_reverse_trim": 1000,
+        "left_turn_left_trim": 1000,
+        "right_turn_left_trim": 1000,
+        "left_turn_right_trim": 1000,
+        "right_turn_right_trim": 1000,
+        "ramp_profile": 2,
+    }
+    assert calibration_from_motion_config({"drive": {"pwm": {"turn": 90}}}) == {
+        "turn_pwm": 90
+    }
+
+
 def test_cabinet_index_and_card_registry_match_demo_data() -> None:
     config = load_project_config()
 
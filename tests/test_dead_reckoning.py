@@ -0,0 +1,33 @@
+from __future__ import annotations
+
+from pi.dead_reckoning import parse_pose, pose_to_wire, snap_pose
+from pi.models import Pose, PoseEstimate
+
+
+def test_pose_round_trips_through_firmware_units() -> None:
+    assert pose_to_wire(Pose(4, 1, "S")) == (4000, 1000, 1800)
+
+    estimate = parse_pose([4000, 1000, 1800, 0, 0])
+
+    assert estimate == PoseEstimate(4.0, 1.0, 180.0, 0.0, 0.0)
+    assert estimate is not None and snap_pose(estimate) == Pose(4, 1, "S")
+
+
+def test_malformed_pose_is_ignored() -> None:
+    assert parse_pose(None) is None
+    assert parse_pose([1, 2, 3]) is None
+    assert parse_pose([1, 2, "3", 4, 5]) is None
+
+
+def test_snapping_needs_a_close_and_confident_estimate() -> None:
+    near = PoseEstimate(2.9, 1.05, 355.0, 0.05, 3.0)
+    assert snap_pose(near) == Pose(3, 1, "N")
+
+    between_cells = PoseEstimate(2.5, 1.0, 0.0, 0.0, 0.0)
+    assert snap_pose(between_cells) is None
+
+    uncertain = PoseEstimate(3.0, 1.0, 90.0, 0.4, 0.0)
+    assert snap_pose(uncertain) is None
+
+    half_turned = PoseEstimate(3.0, 1.0, 45.0, 0.0, 0.0)
+    assert snap_pose(half_turned) is None
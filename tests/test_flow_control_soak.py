@@ -0,0 +1,154 @@
+from __future__ import annotations
+
+import random
+import string
+from collections import deque
+from typing import Any
+
+import pytest
+
+from pi.arduino_client import ArduinoClient
+
+# Simulated-time soak of sustained LCD + motion traffic against a model of the
+# firmware's RX path: a 256-byte UART ring filled at 115200 baud, drained one
+# line at a time by a loop that blocks for LCD writes and for periodic RFID
+# recovery stalls. Acks follow SerialProtocol's "rx_bytes" reporting rule.
+
+BYTES_PER_MS = 115200 / 10 / 1000
+RX_RING_BYTES = 256
+RX_CREDIT_REPORT_BYTES = 64
+LCD_LINE_MS = 5.0
+COMMAND_MS = 0.2
+LOOP_MS = 0.5
+STALL_EVERY_MS = 2000.0
+STALL_MS = 400.0
+
+
+class SimulatedArduino:
+    def __init__(self) -> None:
+        self.now_ms = 0.0
+        self._wire: deque[tuple[float, int]] = deque()
+        self._wire_free_ms = 0.0
+        self._ring: deque[int] = deque()
+        self._line = bytearray()
+        self._busy_until_ms = 0.0
+        self._next_stall_ms = STALL_EVERY_MS
+        self._rx_bytes = 0
+        self._rx_reported = 0
+        self._outbox: deque[tuple[float, dict[str, Any]]] = deque()
+        self.overflows = 0
+        self.sent_seqs: set[int] = set()
+        self.acked_seqs: set[int] = set()
+
+    # SerialJsonLink surface used by ArduinoClient.
+    def link_mode(self) -> str:
+        return "json"
+
+    def send_raw_line(self, payload: bytes, debug_label: str) -> None:
+        self.sent_seqs.add(_sequence_of(payload))
+        for byte in payload:
+            self._wire_free_ms = max(self._wire_free_ms, self.now_ms) + 1 / BYTES_PER_MS
+            self._wire.append((self._wire_free_ms, byte))
+
+    def read_message(self) -> dict[str, Any] | None:
+        if self._outbox and self._outbox[0][0] <= self.now_ms:
+            return self._outbox.popleft()[1]
+        return None
+
+    # Stand-in for the time module inside pi.arduino_client.
+    def monotonic(self) -> float:
+        return self.now_ms / 1000.0
+
+    def sleep(self, seconds: float) -> None:
+        self.advance(seconds * 1000.0)
+
+    def advance(self, ms: float) -> None:
+        end = self.now_ms + ms
+        while self.now_ms < end:
+            self.now_ms = min(end, self.now_ms + 0.1)
+            while self._wire and self._wire[0][0] <= self.now_ms:
+                byte = self._wire.popleft()[1]
+                if len(self._ring) >= RX_RING_BYTES - 1:
+                    self.overflows += 1
+                else:
+                    self._ring.append(byte)
+            if self.now_ms >= self._busy_until_ms:
+                self._update()
+
+    def _update(self) -> None:
+        if self.now_ms >= self._next_stall_ms:
+            self._next_stall_ms += STALL_EVERY_MS
+            self._busy_until_ms = self.now_ms + STALL_MS
+            return
+        while self._ring:
+            byte = self._ring.popleft()
+            self._rx_bytes = (self._rx_bytes + 1) % 0x10000
+            if byte != ord("\n"):
+                self._line.append(byte)
+                continue
+            line, self._line = bytes(self._line), bytearray()
+            self._busy_until_ms = self.now_ms + self._handle(line)
+            return
+        self._busy_until_ms = self.now_ms + LOOP_MS
+
+    def _handle(self, line: bytes) -> float:
+        commands = line.decode("utf-8", errors="replace").split(";")
+        head = commands[0].split("|")[0]
+        if not head.startswith("@") or "#" not in head:
+            return COMMAND_MS
+        opcode, _, seq_text = head[1:].partition("#")
+        if not seq_text.isdigit():
+            return COMMAND_MS
+        body = commands[1:] if opcode == "B" else [opcode]
+        cost = sum(LCD_LINE_MS if part.startswith("L") else COMMAND_MS for part in body)
+        ack: dict[str, Any] = {"type": "ack", "command": opcode, "seq": int(seq_text)}
+        unreported = (self._rx_bytes - self._rx_reported) % 0x10000
+        if unreported >= RX_CREDIT_REPORT_BYTES or (unreported and not self._ring):
+            ack["rx_bytes"] = self._rx_bytes
+            self._rx_reported = self._rx_bytes
+        self.acked_seqs.add(int(seq_text))
+        self._outbox.append((self.now_ms + cost, ack))
+        return cost
+
+
+def _sequence_of(payload: bytes) -> int:
+    return int(payload.split(b"#")[1].split(b"|")[0].split(b";")[0].rstrip(b"\n"))
+
+
+def run_soak(
+    monkeypatch: pytest.MonkeyPatch, rx_window: int | None
+) -> SimulatedArduino:
+    arduino = SimulatedArduino()
+    monkeypatch.setattr("pi.arduino_client.time", arduino)
+    client = ArduinoClient(
+        arduino, window=4, ack_timeout_s=0.25  # type: ignore[arg-type]
+    )
+    ready: dict[str, Any] = {"type": "event", "event": "ready"}
+    if rx_window is not None:
+        ready["rx_window"] = rx_window
+    client.handle_message(ready)
+
+    rng = random.Random(7)
+    for _ in range(400):
+        lines = ["".join(rng.choices(string.ascii_letters, k=20)) for _ in range(4)]
+        with client.batch():
+            client.lcd_set(lines)
+            client.move("forward_cell")
+        while client.read_message() is not None:
+            pass
+        arduino.advance(20.0)
+    arduino.advance(5000.0)
+    return arduino
+
+
+def test_without_credits_the_rx_ring_overflows(monkeypatch: pytest.MonkeyPatch) -> None:
+    arduino = run_soak(monkeypatch, rx_window=None)
+    assert arduino.overflows > 0
+    assert arduino.acked_seqs != arduino.sent_seqs
+
+
+def test_credits_deliver_every_command(monkeypatch: pytest.MonkeyPatch) -> None:
+    arduino = run_soak(monkeypatch, rx_window=RX_RING_BYTES - 1)
+    assert arduino.overflows == 0
+    assert arduino.acked_seqs == arduino.sent_seqs
+    assert len(arduino.sent_seqs) == 400
@@ -1,8 +1,8 @@
 from pi.cabinet_index import CabinetIndex
 from pi.config import load_project_config
 from pi.map_loader import load_grid_map
-from pi.models import Pose
-from pi.pathfinding import plan_route
+from pi.models import Pose, RouteSegment
+from pi.pathfinding import compact_actions, plan_route
 
 
 def test_route_to_cabinet_2_exists_and_ends_at_goal_pose() -> None:
@@ -41,3 +41,56 @@ def test_route_prefers_reverse_when_goal_is_directly_behind() -> None:
     assert route.actions == ["reverse_cell"]
     assert route.turns == 0
     assert route.steps == 1
+
+
+def test_runs_of_identical_actions_fold_into_segments() -> None:
+    actions = ["forward_cell"] * 5 + ["turn_left", "turn_left", "forward_cell"]
+
+    assert compact_actions(actions) == [
+        RouteSegment("forward_cell", 5),
+        RouteSegment("turn_left", 2),
+        RouteSegment("forward_cell", 1),
+    ]
+    assert compact_actions([]) == []
+
+
+def test_planned_route_carries_its_compacted_segments() -> None:
+    config = load_project_config()
+    grid_map = load_grid_map(config.map_config)
+    cabinets = CabinetIndex(config.cabinets_config)
+
+    route = plan_route(grid_map, grid_map.home, cabinets.get_pose("2"))
+
+    assert sum(segment.cells for segment in route.segments) == len(route.actions)
+    assert len(route.segments) <= len(route.actions)
+    for first, second in zip(route.segments, route.segments[1:]):
+        assert first.action != second.action
+
+
+def test_arcs_replace_a_corner_when_the_grid_allows() -> None:
+    config = load_project_config()
+    grid_map = load_grid_map(config.map_config)
+    start = Pose(x=0, y=0, heading="E")
+    goal = Pose(x=1, y=1, heading="S")
+
+    assert plan_route(grid_map, start, goal).actions == [
+        "forward_cell",
+        "turn_right",
+        "forward_cell",
+    ]
+    route = plan_route(grid_map, start, goal, prefer_arcs=True)
+    assert route.actions == ["arc_right"]
+    assert route.final_pose == goal
+
+
+def test_arcs_need_the_whole_corner_block_free() -> None:
+    config = load_project_config()
+    grid_map = load_grid_map(config.map_config)
+    # The arc from (1, 2) north to (2, 1) east would sweep the wall at (2, 2).
+    start = Pose(x=1, y=2, heading="N")
+    goal = Pose(x=2, y=1, heading="E")
+
+    route = plan_route(grid_map, start, goal, prefer_arcs=True)
+
+    assert "arc_right" not in route.actions
+    assert route.actions == ["forward_cell", "turn_right", "forward_cell"]
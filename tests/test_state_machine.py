@@ -1,7 +1,11 @@
+from contextlib import nullcontext
+from typing import ContextManager
+
 from pi.cabinet_index import CabinetIndex
 from pi.card_registry import CardRegistry
 from pi.config import load_project_config
 from pi.map_loader import load_grid_map
+from pi.models import Pose
 from pi.state_machine import BOX_CLOSE_SETTLE_S, RobotMode, RobotStateMachine
 
 
@@ -19,6 +23,12 @@ class FakeArduinoClient:
     def stop(self) -> None:
         self.commands.append(("stop", None))
 
+    def emergency_stop(self) -> None:
+        self.commands.append(("emergency_stop", None))
+
+    def clear_emergency_stop(self) -> None:
+        self.commands.append(("clear_emergency_stop", None))
+
     def lcd_set(self, lines: list[str]) -> None:
         self.commands.append(("lcd_set", lines))
         self._lcd_busy = False
@@ -26,9 +36,15 @@ class FakeArduinoClient:
     def lcd_busy(self) -> bool:
         return self._lcd_busy
 
+    def batch(self) -> ContextManager[None]:
+        return nullcontext()
+
     def move(self, action: str, duration_ms: int | None = None) -> None:
         self.commands.append(("move", (action, duration_ms)))
 
+    def route(self, steps: list[str]) -> None:
+        self.commands.append(("route", steps))
+
     def get_state(self) -> None:
         self.commands.append(("get_state", None))
 
@@ -38,6 +54,9 @@ class FakeArduinoClient:
     def servo_close(self, box: int) -> None:
         self.commands.append(("servo_close", box))
 
+    def set_pose(self, pose: Pose) -> None:
+        self.commands.append(("set_pose", pose))
+
 
 def build_machine() -> tuple[RobotStateMachine, FakeArduinoClient]:
     config = load_project_config()
@@ -113,7 +132,7 @@ def test_valid_input_starts_first_job_and_motion() -> None:
     assert machine.next_action_due_s is not None
     scheduled_at = machine.next_action_due_s
     machine.tick(now_s=scheduled_at - 0.1)
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
 
     flush_scheduled_actions(machine)
 
@@ -122,9 +141,9 @@ def test_valid_input_starts_first_job_and_motion() -> None:
     assert machine.active_job.cabinet_id == "2"
     assert ("servo_close", 2) in fake.commands
     assert fake.commands.index(("servo_close", 2)) < next(
-        index for index, command in enumerate(fake.commands) if command[0] == "move"
+        index for index, command in enumerate(fake.commands) if command[0] == "route"
     )
-    assert any(command == "move" for command, _ in fake.commands)
+    assert any(command == "route" for command, _ in fake.commands)
 
 
 def test_job_opens_target_box_while_waiting_for_load() -> None:
@@ -136,7 +155,7 @@ def test_job_opens_target_box_while_waiting_for_load() -> None:
     assert machine.mode == RobotMode.WAITING_FOR_BOX
     assert ("servo_open", 1) in fake.commands
     assert ("get_state", None) in fake.commands
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
 
 
 def test_multi_box_queue_opens_both_boxes_at_home() -> None:
@@ -154,7 +173,7 @@ def test_multi_box_queue_opens_both_boxes_at_home() -> None:
     assert fake.commands.index(("servo_open", 2)) < fake.commands.index(
         ("get_state", None)
     )
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
 
 
 def test_zero_key_resets_state_and_restarts_handshake() -> None:
@@ -175,7 +194,10 @@ def test_zero_key_resets_state_and_restarts_handshake() -> None:
     assert machine.pending_actions == []
     assert len(machine.queue) == 0
     assert machine.keypad_parser.buffer == ""
-    assert ("stop", None) in fake.commands
+    assert ("emergency_stop", None) in fake.commands
+    assert fake.commands.index(("clear_emergency_stop", None)) > fake.commands.index(
+        ("emergency_stop", None)
+    )
     assert ("ping", None) in fake.commands
     assert ("rfid_reset", None) in fake.commands
     assert fake.commands.count(("get_state", None)) >= 2
@@ -259,10 +281,10 @@ def test_box_close_waits_before_first_move() -> None:
     scheduled_at = machine.next_action_due_s
 
     machine.tick(now_s=scheduled_at - 0.01)
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
 
     machine.tick(now_s=scheduled_at + 0.01)
-    assert any(command == "move" for command, _ in fake.commands)
+    assert any(command == "route" for command, _ in fake.commands)
     assert BOX_CLOSE_SETTLE_S == 2.5
 
 
@@ -437,7 +459,7 @@ def test_job_waits_for_target_box_before_moving() -> None:
     flush_scheduled_actions(machine)
 
     assert machine.mode == RobotMode.WAITING_FOR_BOX
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
     assert ("get_state", None) in fake.commands
     assert ("servo_open", 2) in fake.commands
 
@@ -445,7 +467,7 @@ def test_job_waits_for_target_box_before_moving() -> None:
 
     assert machine.mode == RobotMode.MOVING_TO_CABINET
     assert ("servo_close", 2) in fake.commands
-    assert any(command == "move" for command, _ in fake.commands)
+    assert any(command == "route" for command, _ in fake.commands)
 
 
 def test_job_recovers_from_unknown_initial_box_state_after_state_refresh() -> None:
@@ -455,11 +477,103 @@ def test_job_recovers_from_unknown_initial_box_state_after_state_refresh() -> No
 
     assert machine.mode == RobotMode.WAITING_FOR_BOX
     assert ("get_state", None) in fake.commands
-    assert not any(command == "move" for command, _ in fake.commands)
+    assert not any(command == "route" for command, _ in fake.commands)
 
     set_switch_state(machine, False, True)
     finish_loading_and_flush(machine, 2)
 
     assert machine.mode == RobotMode.MOVING_TO_CABINET
     assert ("servo_close", 2) in fake.commands
-    assert any(command == "move" for command, _ in fake.commands)
+    assert any(command == "route" for command, _ in fake.commands)
+
+
+def test_route_is_sent_once_and_progress_events_do_not_advance() -> None:
+    machine, fake = build_machine()
+    machine.start()
+    set_switch_state(machine, False, True)
+    enter_job(machine, "2#2##")
+    finish_loading_and_flush(machine, 2)
+
+    routes = [steps for command, steps in fake.commands if command == "route"]
+    assert len(routes) == 1
+    assert machine.pending_actions == []
+
+    machine.process_message(
+        {"type": "event", "event": "motion_done", "step": 0, "remaining": 1}
+    )
+    assert machine.next_action_due_s is None
+    assert machine.mode == RobotMode.MOVING_TO_CABINET
+
+    machine.process_message(
+        {"type": "event", "event": "motion_done", "step": 1, "remaining": 0}
+    )
+    flush_scheduled_actions(machine)
+    assert machine.mode == RobotMode.WAITING_FOR_CARD
+
+
+def test_pose_is_synced_at_start_and_at_each_arrival() -> None:
+    machine, fake = build_machine()
+    logs: list[str] = []
+    machine.logger = logs.append
+    machine.start()
+    assert ("set_pose", machine.grid_map.home) in fake.commands
+
+    set_switch_state(machine, False, True)
+    enter_job(machine, "2#2##")
+    finish_loading_and_flush(machine, 2)
+    cabinet = machine.cabinet_index.get_pose("2")
+    machine.process_message(
+        {
+            "type": "event",
+            "event": "motion_done",
+            "remaining": 0,
+            "pose": [cabinet.x * 1000 + 600, cabinet.y * 1000, 0, 40, 20],
+        }
+    )
+    assert machine.pose_estimate is not None
+    flush_scheduled_actions(machine)
+
+    assert machine.mode == RobotMode.WAITING_FOR_CARD
+    assert ("set_pose", cabinet) in fake.commands
+    assert machine.pose_estimate is None
+    assert any("pose_mismatch" in line for line in logs)
+
+
+def test_telemetry_event_updates_the_pose_estimate() -> None:
+    machine, _ = build_machine()
+    machine.start()
+
+    machine.process_message(
+        {
+            "type": "event",
+            "event": "telemetry",
+            "mv": 7820,
+            "pwm_scale": 1036,
+            "pose": [2000, 1000, 1800, 50, 20],
+        }
+    )
+
+    assert machine.pose_estimate is not None
+    assert machine.pose_estimate.y == 1.0
+
+
+def test_estop_event_is_logged_and_keeps_the_pose_estimate() -> None:
+    machine, _ = build_machine()
+    logs: list[str] = []
+    machine.logger = logs.append
+    machine.start()
+
+    machine.process_message(
+        {
+            "type": "event",
+            "event": "estop",
+            "dropped": 2,
+            "latency_us": 180,
+            "max_latency_us": 950,
+            "pose": [1500, 2000, 900, 60, 30],
+        }
+    )
+
+    assert machine.pose_estimate is not None
+    assert machine.pose_estimate.x == 1.5
+    assert any("estop dropped=2 latency_us=180" in line for line in logs)